@@ -4,7 +4,8 @@
 #include <iostream>
 
 GTEST_API_ int main(int argc, char** argv) {
-  MPI_Init(nullptr, nullptr);
+  int thread_level;
+  MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &thread_level);
   int proc_id;
   MPI_Comm_rank(MPI_COMM_WORLD, &proc_id);
   char filename[16];
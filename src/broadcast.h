@@ -1,52 +1,70 @@
 #ifndef BLAZE_BROADCAST_H_
 #define BLAZE_BROADCAST_H_
 
+#include <cstring>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
-#include "../vendor/hps/src/hps.h"
 #include "internal/mpi_type.h"
 #include "internal/mpi_util.h"
+#include "internal/node_comm.h"
+#include "internal/object_transport.h"
+#include "internal/shared_window.h"
+#include "internal/transport.h"
+#include "shared_array.h"
 
 namespace blaze {
 
-// Broadcast objects of any type and any size.
+// Broadcast objects of any type and any size. Trivially copyable objects and vectors of them are
+// broadcast straight from their storage without serializing.
 template <class T>
 void broadcast(T& t, const int root = 0) {
   const int n_procs = internal::MpiUtil::get_n_procs();
   if (n_procs == 1) return;
 
-  size_t msg_size;
-  const int BUF_SIZE = 1 << 20;
-  char msg_buf_char[BUF_SIZE];
-  std::string msg_buf;
+  internal::ObjectTransport::broadcast(t, root, internal::NodeComm::get_instance());
+}
+
+// Broadcasts the values of the root into a single copy per node, which the leader of each node
+// receives and all procs of the node read.
+template <class T>
+SharedArray<T> broadcast_shared(
+    const std::vector<T>& values, const int root, const internal::NodeComm& nodes) {
+  static_assert(std::is_trivially_copyable<T>::value, "values must be trivially copyable");
   const int proc_id = internal::MpiUtil::get_proc_id();
-  const bool is_master = (proc_id == root);
-
-  // Broadcast size.
-  size_t pos = 0;
-  if (is_master) {
-    hps::to_string(t, msg_buf);
-    msg_size = msg_buf.size();
-    MPI_Bcast(&msg_size, 1, internal::MpiType<size_t>::value, root, MPI_COMM_WORLD);
-    while (pos + BUF_SIZE <= msg_size) {
-      msg_buf.copy(msg_buf_char, BUF_SIZE, pos);
-      MPI_Bcast(msg_buf_char, BUF_SIZE, MPI_CHAR, root, MPI_COMM_WORLD);
-      pos += BUF_SIZE;
+  size_t n_values = values.size();
+  MPI_Bcast(&n_values, 1, internal::MpiType<size_t>::value, root, MPI_COMM_WORLD);
+  const size_t size = n_values * sizeof(T);
+  auto window = std::make_shared<internal::SharedWindow>(size, nodes);
+
+  // The root hands the values to its leader, which passes them on to the other leaders.
+  const int root_node_id = nodes.get_node_id(root);
+  const int root_node_rank = nodes.get_node_rank(root);
+  MPI_Comm node_comm = nodes.get_node_comm();
+  const char* values_data = reinterpret_cast<const char*>(values.data());
+  if (proc_id == root && !nodes.is_leader()) {
+    internal::Transport::send(values_data, size, 0, node_comm);
+  }
+  if (nodes.is_leader()) {
+    char* data = window->get_data();
+    if (proc_id == root) {
+      if (size > 0) std::memcpy(data, values_data, size);
+    } else if (nodes.get_node_id() == root_node_id) {
+      internal::Transport::recv(data, size, root_node_rank, node_comm);
     }
-    msg_buf.copy(msg_buf_char, msg_size - pos, pos);
-    MPI_Bcast(msg_buf_char, msg_size - pos, MPI_CHAR, root, MPI_COMM_WORLD);
-  } else {
-    MPI_Bcast(&msg_size, 1, internal::MpiType<size_t>::value, root, MPI_COMM_WORLD);
-    msg_buf.reserve(msg_size);
-    while (pos + BUF_SIZE <= msg_size) {
-      MPI_Bcast(msg_buf_char, BUF_SIZE, MPI_CHAR, root, MPI_COMM_WORLD);
-      msg_buf.append(msg_buf_char, BUF_SIZE);
-      pos += BUF_SIZE;
+    if (nodes.get_n_nodes() > 1) {
+      internal::Transport::broadcast(data, size, root_node_id, nodes.get_leader_comm());
     }
-    MPI_Bcast(msg_buf_char, msg_size - pos, MPI_CHAR, root, MPI_COMM_WORLD);
-    msg_buf.append(msg_buf_char, msg_size - pos);
-    hps::from_string(msg_buf, t);
   }
+  window->fence();
+  return SharedArray<T>(window, n_values);
+}
+
+template <class T>
+SharedArray<T> broadcast_shared(const std::vector<T>& values, const int root = 0) {
+  return broadcast_shared(values, root, internal::NodeComm::get_instance());
 }
 }  // namespace blaze
 
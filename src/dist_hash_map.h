@@ -8,10 +8,8 @@ namespace blaze {
 template <class K, class V, class H = std::hash<K>>
 class DistHashMap : public internal::hash::DistHashMap<K, V, H> {
  public:
-  void async_set(
-      const K& key,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite) {
+  template <class R = void (*)(V&, const V&)>
+  void async_set(const K& key, const V& value, const R& reducer = Reducer<V>::overwrite) {
     internal::hash::DistHashMap<K, V, H>::async_set(key, hasher(key), value, reducer);
   }
 
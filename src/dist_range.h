@@ -22,7 +22,9 @@ class DistRange {
   DistRange(const T start = 0, const T end = 0, const T inc = 1)
       : start(start), end(end), inc(inc) {}
 
-  void for_each(const std::function<void(const T)>& handler, const bool verbose = false) {
+  // Handler: void(const T value).
+  template <class F>
+  void for_each(const F& handler, const bool verbose = false) {
     const int n_procs = internal::MpiUtil::get_n_procs();
     const int proc_id = internal::MpiUtil::get_proc_id();
     double target_progress = 0.1;
@@ -19,103 +19,79 @@
 
 namespace blaze {
 
-template <class VS>
+// Also maps other sources of single values such as DistTextStream, as S.
+template <class VS, class S = DistRange<VS>>
 class DistRangeMapreducer {
  public:
-  template <class VD>
-  static void mapreduce(
-      DistRange<VS>& source,
-      const std::function<
-          void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::string& reducer,
-      std::vector<VD>& dest);
+  // Mapper: void(const VS value, const auto& emit).
+  // Emit: void(const size_t key, const VD& value) or void(const KD& key, const VD& value).
+  // Templated on the mapper and reducer types so that emits and reductions can be inlined.
+  template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+  static void mapreduce(S& source, const M& mapper, const R& reducer, std::vector<VD>& dest);
 
-  template <class VD>
+  template <class VD, class M>
   static void mapreduce(
-      DistRange<VS>& source,
-      const std::function<
-          void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      std::vector<VD>& dest);
+      S& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest);
 
-  template <class VD>
-  static void mapreduce(
-      DistRange<VS>& source,
-      const std::function<
-          void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      DistVector<VD>& dest);
+  template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+  static void mapreduce(S& source, const M& mapper, const R& reducer, DistVector<VD>& dest);
 
-  template <class KD, class VD, class HD = std::hash<KD>>
+  template <class KD,
+            class VD,
+            class HD,
+            class M,
+            class R,
+            class = internal::EnableIfReducerFunc<R>>
   static void mapreduce(
-      DistRange<VS>& source,
-      const std::function<
-          void(const VS value, const std::function<void(const KD&, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      DistHashMap<KD, VD, HD>& dest);
+      S& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest);
 };
 
-template <class VS>
-template <class VD>
-void DistRangeMapreducer<VS>::mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    std::vector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M, class R, class>
+void DistRangeMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
   internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
   const auto& emit = [&](const size_t key, const VD& value) {
     dest_wrapper.async_set(key, value, reducer);
   };
-  const auto& handler = [&](const VS& value) { mapper(value, emit); };
+  const auto& handler = [&](const VS value) { mapper(value, emit); };
   source.for_each(handler);
   dest_wrapper.sync(reducer);
 }
 
-template <class VS>
-template <class VD>
-void DistRangeMapreducer<VS>::mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::string& reducer,
-    std::vector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M>
+void DistRangeMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
   internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  const auto& emit = [&](const size_t key, const VD& value) {
-    dest_wrapper.async_set(key, value, reducer_func);
-  };
-  const auto& handler = [&](const VS& value) { mapper(value, emit); };
-  source.for_each(handler);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    const auto& emit = [&](const size_t key, const VD& value) {
+      dest_wrapper.async_set(key, value, reducer_func);
+    };
+    const auto& handler = [&](const VS value) { mapper(value, emit); };
+    source.for_each(handler);
+  });
   dest_wrapper.sync(reducer);
 }
 
-template <class VS>
-template <class VD>
-void DistRangeMapreducer<VS>::mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    DistVector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M, class R, class>
+void DistRangeMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
   const auto& emit = [&](const size_t key, const VD& value) {
     dest.async_set(key, value, reducer);
   };
-  const auto& handler = [&](const VS& value) { mapper(value, emit); };
+  const auto& handler = [&](const VS value) { mapper(value, emit); };
   source.for_each(handler);
   dest.sync(reducer);
 }
 
-template <class VS>
-template <class KD, class VD, class HD>
-void DistRangeMapreducer<VS>::mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const KD&, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    DistHashMap<KD, VD, HD>& dest) {
+template <class VS, class S>
+template <class KD, class VD, class HD, class M, class R, class>
+void DistRangeMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
   const auto& emit = [&](const KD& key, const VD& value) { dest.async_set(key, value, reducer); };
-  const auto& handler = [&](const VS& value) { mapper(value, emit); };
+  const auto& handler = [&](const VS value) { mapper(value, emit); };
   source.for_each(handler);
   dest.sync(reducer);
 }
@@ -0,0 +1,178 @@
+#ifndef BLAZE_DIST_TEXT_FILE_H_
+#define BLAZE_DIST_TEXT_FILE_H_
+
+#include <fcntl.h>
+#include <mpi.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "internal/char_scanner.h"
+#include "internal/file_range.h"
+#include "internal/mpi_type.h"
+#include "internal/mpi_util.h"
+#include "string_view.h"
+
+namespace blaze {
+
+// The lines of a text file as a source for mapreduce, without copying them. Each proc maps its own
+// byte range of the file into memory, and passes its lines to the mapper as views into the mapped
+// bytes, like the values of a DistVector<std::string> keyed by line number. Unlike a DistVector,
+// the lines of each proc are consecutive.
+class DistTextFile {
+ public:
+  // Lines are scanned in parallel in blocks of about this many bytes.
+  constexpr static size_t BLOCK_SIZE = 1 << 20;
+
+  // Collective. Throws on all procs if any proc cannot open or map the file.
+  explicit DistTextFile(const std::string& filename);
+
+  DistTextFile(const DistTextFile&) = delete;
+
+  DistTextFile& operator=(const DistTextFile&) = delete;
+
+  ~DistTextFile();
+
+  // The number of lines of the file.
+  size_t size() const { return n_lines; }
+
+  size_t get_n_local_lines() const { return n_local_lines; }
+
+  // Handler: void(const size_t line_id, const StringView& line). Called from several threads.
+  template <class F>
+  void for_each(const F& handler) const;
+
+ private:
+  // Complete lines that start at begin and end before end.
+  struct Block {
+    const char* begin;
+
+    const char* end;
+
+    size_t first_line_id;
+  };
+
+  int fd;
+
+  char* map_data;
+
+  size_t map_size;
+
+  std::vector<Block> blocks;
+
+  // The last line of this proc, which ends on a later proc or lacks a newline, as a copy.
+  std::string last_line;
+
+  bool has_last_line;
+
+  size_t last_line_id;
+
+  size_t n_local_lines;
+
+  size_t n_lines;
+};
+
+inline DistTextFile::DistTextFile(const std::string& filename)
+    : fd(-1), map_data(nullptr), map_size(0), has_last_line(false) {
+  fd = open(filename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  int error = fd < 0 || fstat(fd, &file_stat) != 0;
+  size_t begin = 0;
+  size_t end = 0;
+  if (!error) internal::FileRange::get_range(file_stat.st_size, begin, end);
+
+  // Maps start at a page boundary.
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t map_begin = begin / page_size * page_size;
+  if (!error && end > begin) {
+    map_size = end - map_begin;
+    void* map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, map_begin);
+    if (map == MAP_FAILED) {
+      error = 1;
+      map_size = 0;
+    } else {
+      map_data = static_cast<char*>(map);
+      madvise(map_data, map_size, MADV_SEQUENTIAL);
+    }
+  }
+  int any_error;
+  MPI_Allreduce(&error, &any_error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (any_error) {
+    if (map_data != nullptr) munmap(map_data, map_size);
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("Cannot open file");
+  }
+
+  const char* data = map_data == nullptr ? nullptr : map_data + (begin - map_begin);
+  const size_t size = end - begin;
+  size_t head_size;
+  std::string tail;
+  internal::FileRange::exchange_boundaries(data, size, head_size, tail);
+
+  // The blocks end after the last newline of the range, and the rest goes into the last line.
+  size_t body_end = size;
+  while (body_end > head_size && data[body_end - 1] != '\n') body_end--;
+  last_line.assign(data + body_end, size - body_end);
+  last_line.append(tail);
+  has_last_line = !last_line.empty();
+  if (has_last_line && last_line.back() == '\n') last_line.pop_back();
+  const char* block_begin = data + head_size;
+  while (block_begin < data + body_end) {
+    const char* block_end = data + body_end;
+    if (block_end - block_begin > static_cast<std::ptrdiff_t>(BLOCK_SIZE)) {
+      block_end = internal::CharScanner::find(block_begin + BLOCK_SIZE - 1, block_end, '\n') + 1;
+    }
+    blocks.push_back({block_begin, block_end, 0});
+    block_begin = block_end;
+  }
+  const int n_blocks = blocks.size();
+  std::vector<size_t> block_n_lines(n_blocks);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_blocks; i++) {
+    block_n_lines[i] = internal::CharScanner::count(blocks[i].begin, blocks[i].end, '\n');
+  }
+
+  // Number the lines with a prefix sum of the line counts.
+  n_local_lines = has_last_line ? 1 : 0;
+  for (int i = 0; i < n_blocks; i++) n_local_lines += block_n_lines[i];
+  size_t line_offset = 0;
+  const MPI_Datatype size_t_mpi = internal::MpiType<size_t>::value;
+  MPI_Exscan(&n_local_lines, &line_offset, 1, size_t_mpi, MPI_SUM, MPI_COMM_WORLD);
+  if (internal::MpiUtil::is_master()) line_offset = 0;
+  MPI_Allreduce(&n_local_lines, &n_lines, 1, size_t_mpi, MPI_SUM, MPI_COMM_WORLD);
+  for (int i = 0; i < n_blocks; i++) {
+    blocks[i].first_line_id = line_offset;
+    line_offset += block_n_lines[i];
+  }
+  last_line_id = line_offset;
+}
+
+inline DistTextFile::~DistTextFile() {
+  if (map_data != nullptr) munmap(map_data, map_size);
+  if (fd >= 0) close(fd);
+}
+
+template <class F>
+void DistTextFile::for_each(const F& handler) const {
+  const int n_blocks = blocks.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_blocks; i++) {
+    const Block& block = blocks[i];
+    size_t line_id = block.first_line_id;
+    const char* line_begin = block.begin;
+    while (line_begin < block.end) {
+      const char* line_end = internal::CharScanner::find(line_begin, block.end, '\n');
+      handler(line_id, StringView(line_begin, line_end - line_begin));
+      line_id++;
+      line_begin = line_end + 1;
+    }
+  }
+  if (has_last_line) handler(last_line_id, StringView(last_line));
+}
+
+}  // namespace blaze
+
+#endif
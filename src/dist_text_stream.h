@@ -0,0 +1,221 @@
+#ifndef BLAZE_DIST_TEXT_STREAM_H_
+#define BLAZE_DIST_TEXT_STREAM_H_
+
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broadcast.h"
+#include "internal/char_scanner.h"
+#include "internal/file_range.h"
+#include "internal/mpi_util.h"
+#include "string_view.h"
+
+namespace blaze {
+
+// The lines of one or more text files as a source for mapreduce, read in chunks of a bounded size,
+// so that memory use depends on the chunk size and not on the size of the files. Each proc reads
+// its own byte range of each file, and maps the lines that start in it while the next chunk is
+// read in the background. A line that starts in the range and ends beyond it is read from the
+// next range, so the procs need not talk to each other. Lines have no ids, since numbering them
+// would take a pass over the files.
+class DistTextStream {
+ public:
+  constexpr static size_t DEFAULT_CHUNK_SIZE = static_cast<size_t>(1) << 26;
+
+  // Lines are mapped in parallel in blocks of about this many bytes.
+  constexpr static size_t BLOCK_SIZE = 1 << 20;
+
+  // Bytes read at a time for the end of a line beyond the range of a proc.
+  constexpr static size_t TAIL_READ_SIZE = 1 << 16;
+
+  // Collective. The patterns are file names or globs, which proc 0 expands. Throws on all procs if
+  // a pattern matches no file.
+  explicit DistTextStream(
+      const std::vector<std::string>& patterns, const size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+  explicit DistTextStream(
+      const std::string& pattern, const size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : DistTextStream(std::vector<std::string>(1, pattern), chunk_size) {}
+
+  const std::vector<std::string>& get_filenames() const { return filenames; }
+
+  // Handler: void(const StringView& line). Called from several threads. The line is valid for the
+  // duration of the call only.
+  template <class F>
+  void for_each(const F& handler) const;
+
+ private:
+  std::vector<std::string> filenames;
+
+  std::vector<size_t> file_sizes;
+
+  size_t chunk_size;
+
+  template <class F>
+  void for_each(const size_t file_id, const F& handler) const;
+
+  // Maps the complete lines in [begin, end) in parallel.
+  template <class F>
+  static void for_each_line(const char* begin, const char* end, const F& handler);
+};
+
+inline DistTextStream::DistTextStream(
+    const std::vector<std::string>& patterns, const size_t chunk_size)
+    : chunk_size(chunk_size) {
+  if (chunk_size == 0) throw std::invalid_argument("chunk size must be positive");
+  std::string error;
+  if (internal::MpiUtil::is_master()) {
+    for (const auto& pattern : patterns) {
+      glob_t matches;
+      if (glob(pattern.c_str(), 0, nullptr, &matches) != 0) {
+        error = "No file matches " + pattern;
+      } else {
+        for (size_t i = 0; i < matches.gl_pathc; i++) filenames.push_back(matches.gl_pathv[i]);
+      }
+      globfree(&matches);
+    }
+    for (const auto& filename : filenames) {
+      struct stat file_stat;
+      if (stat(filename.c_str(), &file_stat) != 0) error = "Cannot open file " + filename;
+      file_sizes.push_back(error.empty() ? file_stat.st_size : 0);
+    }
+  }
+  broadcast(error);
+  if (!error.empty()) throw std::runtime_error(error);
+  broadcast(filenames);
+  broadcast(file_sizes);
+}
+
+template <class F>
+void DistTextStream::for_each(const F& handler) const {
+  for (size_t i = 0; i < filenames.size(); i++) for_each(i, handler);
+}
+
+template <class F>
+void DistTextStream::for_each(const size_t file_id, const F& handler) const {
+  const size_t file_size = file_sizes[file_id];
+  size_t begin;
+  size_t end;
+  internal::FileRange::get_range(file_size, begin, end);
+  if (begin == end) return;
+  const int fd = open(filenames[file_id].c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Cannot open file " + filenames[file_id]);
+
+  // Read from the byte before the range, so that skipping up to the first newline skips exactly
+  // the line that started on an earlier proc. Past the range, only the end of the last line is
+  // left to read, in smaller chunks and without prefetching.
+  size_t chunk_pos = begin > 0 ? begin - 1 : 0;
+  const size_t buf_size = std::min(chunk_size, file_size - chunk_pos);
+  const auto& get_read_size = [&](const size_t pos) {
+    const size_t read_size = std::min(buf_size, file_size - pos);
+    return pos < end ? read_size : std::min(read_size, TAIL_READ_SIZE);
+  };
+  std::vector<char> bufs[2] = {std::vector<char>(buf_size), std::vector<char>(buf_size)};
+  size_t read_sizes[2] = {0, 0};
+  const auto& read_chunk = [&](const int buf_id, const size_t pos) {
+    const size_t read_size = get_read_size(pos);
+    size_t n_read = 0;
+    while (n_read < read_size) {
+      const ssize_t n = pread(fd, bufs[buf_id].data() + n_read, read_size - n_read, pos + n_read);
+      if (n <= 0) break;
+      n_read += n;
+    }
+    read_sizes[buf_id] = n_read;
+  };
+  bool is_skipping = begin > 0;
+  bool is_done = false;
+  std::string carry;
+  int buf_id = 0;
+  std::thread prefetch_thread;
+  while (!is_done) {
+    if (prefetch_thread.joinable()) {
+      prefetch_thread.join();
+    } else {
+      read_chunk(buf_id, chunk_pos);
+    }
+    const char* data = bufs[buf_id].data();
+    const size_t n = read_sizes[buf_id];
+    if (n < get_read_size(chunk_pos)) {
+      close(fd);
+      throw std::runtime_error("Cannot read file " + filenames[file_id]);
+    }
+    const bool is_last_chunk = chunk_pos + n >= file_size;
+    if (!is_last_chunk && chunk_pos + n < end) {
+      prefetch_thread = std::thread(read_chunk, 1 - buf_id, chunk_pos + n);
+    }
+
+    // The lines of this proc are those that start before end. The rest of the chunk starts at p.
+    size_t p = 0;
+    if (is_skipping) {
+      p = internal::CharScanner::find(data, data + n, '\n') - data;
+      if (p < n) {
+        is_skipping = false;
+        p++;
+      }
+      is_done = chunk_pos + p >= end;
+    } else if (!carry.empty()) {
+      p = internal::CharScanner::find(data, data + n, '\n') - data;
+      carry.append(data, p);
+      if (p < n) {
+        handler(StringView(carry));
+        carry.clear();
+        p++;
+        is_done = chunk_pos + p >= end;
+      }
+    }
+
+    if (!is_skipping && !is_done && p < n) {
+      size_t lines_end = n;
+      while (lines_end > p && data[lines_end - 1] != '\n') lines_end--;
+      if (chunk_pos + lines_end > end) {
+        const char* last_byte = data + (end - chunk_pos - 1);
+        lines_end = internal::CharScanner::find(last_byte, data + n, '\n') - data + 1;
+      }
+      for_each_line(data + p, data + lines_end, handler);
+      carry.assign(data + lines_end, n - lines_end);
+      is_done = chunk_pos + lines_end >= end;
+    }
+
+    if (is_last_chunk) {
+      if (!is_done && !is_skipping && !carry.empty()) handler(StringView(carry));
+      is_done = true;
+    }
+    chunk_pos += n;
+    buf_id = 1 - buf_id;
+  }
+  if (prefetch_thread.joinable()) prefetch_thread.join();
+  close(fd);
+}
+
+template <class F>
+void DistTextStream::for_each_line(const char* begin, const char* end, const F& handler) {
+  std::vector<const char*> block_begins;
+  while (begin < end) {
+    block_begins.push_back(begin);
+    if (end - begin <= static_cast<std::ptrdiff_t>(BLOCK_SIZE)) break;
+    begin = internal::CharScanner::find(begin + BLOCK_SIZE - 1, end, '\n') + 1;
+  }
+  block_begins.push_back(end);
+  const int n_blocks = block_begins.size() - 1;
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_blocks; i++) {
+    const char* line_begin = block_begins[i];
+    const char* block_end = block_begins[i + 1];
+    while (line_begin < block_end) {
+      const char* line_end = internal::CharScanner::find(line_begin, block_end, '\n');
+      handler(StringView(line_begin, line_end - line_begin));
+      line_begin = line_end + 1;
+    }
+  }
+}
+
+}  // namespace blaze
+
+#endif
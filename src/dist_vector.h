@@ -1,21 +1,34 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "../vendor/hps/src/hps.h"
 #include "broadcast.h"
+#include "internal/append_buffer.h"
+#include "internal/checkpoint.h"
 #include "internal/concurrent_vector.h"
+#include "internal/exchange_util.h"
 #include "internal/hash/concurrent_hash_map.h"
 #include "internal/mpi_type.h"
 #include "internal/mpi_util.h"
+#include "internal/object_transport.h"
+#include "internal/shuffle_plan.h"
+#include "internal/spill_buffer.h"
+#include "internal/stream_shuffler.h"
+#include "internal/transport.h"
 #include "reducer.h"
+#include "sync_handle.h"
 
 namespace blaze {
 
 template <class V>
 class DistVector {
  public:
+  using ShufflePlan = internal::ShufflePlan<V>;
+
   DistVector();
 
   DistVector(const size_t n, const V& value = V());
@@ -26,13 +39,64 @@ class DistVector {
 
   size_t size() const { return n; }
 
-  void async_set(
-      const size_t key,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
+  template <class R = void (*)(V&, const V&)>
+  void async_set(const size_t key, const V& value, const R& reducer = Reducer<V>::overwrite);
 
   void sync(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
 
+  // Collective. Starts the exchange of sync and returns while it is in flight, so that other work
+  // can overlap it. The merge happens once the handle completes. With the streaming shuffle, the
+  // exchange happens when the handle is first tested or waited for.
+  SyncHandle sync_async(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
+
+  // Collective. Send remote values in chunks of n_chunk_keys keys while async_set is still being
+  // called, instead of all at once in sync. Requires MPI_THREAD_FUNNELED to overlap the transfer.
+  void enable_streaming_shuffle(
+      const size_t n_chunk_keys = internal::StreamShuffler<size_t, V>::DEFAULT_N_CHUNK_KEYS);
+
+  void disable_streaming_shuffle();
+
+  // Keep at most about max_n_keys remote keys in memory and spill the rest to temp files in
+  // spill_dir, which are exchanged in bounded rounds at sync.
+  void enable_spill(const size_t max_n_keys, const std::string& spill_dir = "/tmp");
+
+  void disable_spill();
+
+  // The runs spilled to temp files since the last sync.
+  size_t get_n_spilled_runs() const {
+    return spill_buffer ? spill_buffer->get_n_spilled_runs() : 0;
+  }
+
+  // Collective. Append remote pairs to per-thread buffers for each destination instead of hashing
+  // them into per-destination maps, and leave the reduction to the receiver, which pays off when
+  // keys rarely repeat. A thread goes back to the maps for the rest of a round once more than
+  // max_repeat_rate of the keys it samples are repeats. With 1.0, remote pairs are always appended.
+  void enable_append_shuffle(
+      const double max_repeat_rate = internal::AppendBuffer<size_t, V>::DEFAULT_MAX_REPEAT_RATE);
+
+  void disable_append_shuffle();
+
+  // Record the routes of the remote keys of the next sync into the plan, and replay them in later
+  // syncs of DistVectors of the same size that use the same plan, e.g. in each iteration of an
+  // iterative job. Remote keys not on the plan take the regular path, and planned keys that are
+  // not set in a round are left as they are.
+  void set_shuffle_plan(const std::shared_ptr<ShufflePlan>& plan);
+
+  // Collective. Assert that every key set from now on is owned by the proc that sets it, e.g. when
+  // the mapper emits the keys of a source DistVector. Sync then skips the exchange without checking
+  // the other procs, and throws if a remote key was set.
+  void set_co_partitioned(const bool co_partitioned) { this->co_partitioned = co_partitioned; }
+
+  bool is_co_partitioned() const { return co_partitioned; }
+
+  // The two halves of sync around the exchange, so that several containers can share one round.
+  // The bufs are indexed by proc id.
+  void get_send_bufs(
+      const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& send_bufs);
+
+  void merge_recv_bufs(
+      const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& recv_bufs);
+
   DistVector<V>& operator+=(const DistVector<V>& rhs) {
     local_data += rhs.local_data;
     return *this;
@@ -53,10 +117,20 @@ class DistVector {
     return *this;
   }
 
-  void for_each(const std::function<void(const size_t key, V& value)>& handler);
+  // Handler: void(const size_t key, V& value).
+  template <class F>
+  void for_each(const F& handler);
 
   std::vector<V> top_k(const size_t k, const std::function<bool(const V&, const V&)>& compare);
 
+  // Collective. Writes the values to a binary checkpoint at path with MPI-IO, a block per proc.
+  void save(const std::string& path);
+
+  // Collective. Replaces the contents with those of the checkpoint at path. With as many procs as
+  // saved it, each proc reads its own block back in place. Otherwise each proc reads a share of
+  // the blocks and sends the values to their owners in one sync.
+  void load(const std::string& path);
+
  private:
   size_t n;
 
@@ -64,13 +138,31 @@ class DistVector {
 
   int proc_id;
 
+  bool co_partitioned;
+
   std::hash<size_t> hasher;
 
   internal::ConcurrentVector<V> local_data;
 
   std::vector<internal::hash::ConcurrentHashMap<size_t, V, std::hash<size_t>>> remote_data;
 
+  std::shared_ptr<internal::StreamShuffler<size_t, V>> shuffler;
+
+  std::shared_ptr<internal::SpillBuffer<size_t, V>> spill_buffer;
+
+  std::shared_ptr<internal::AppendBuffer<size_t, V>> append_buffer;
+
+  std::shared_ptr<ShufflePlan> shuffle_plan;
+
   void init();
+
+  // The number of keys proc_id_u of n_procs_u owns.
+  size_t get_n_local(const size_t n_procs_u, const size_t proc_id_u) const {
+    return n / n_procs_u + (n % n_procs_u > proc_id_u ? 1 : 0);
+  }
+
+  // Records the keys in the remote buffers into the shuffle plan.
+  void record_shuffle_plan();
 };
 
 template <class V>
@@ -95,6 +187,7 @@ template <class V>
 void DistVector<V>::init() {
   n_procs = internal::MpiUtil::get_n_procs();
   proc_id = internal::MpiUtil::get_proc_id();
+  co_partitioned = false;
   remote_data.resize(n_procs);
 }
 
@@ -104,21 +197,68 @@ void DistVector<V>::resize(const size_t n, const V& value) {
 
   static size_t n_procs_u = internal::MpiUtil::get_n_procs();
   static size_t proc_id_u = internal::MpiUtil::get_proc_id();
-  size_t n_local = n / n_procs_u;
-  if (n % n_procs_u > proc_id_u) n_local++;
+  local_data.resize(get_n_local(n_procs_u, proc_id_u), value);
+}
+
+template <class V>
+void DistVector<V>::enable_streaming_shuffle(const size_t n_chunk_keys) {
+  shuffler = std::make_shared<internal::StreamShuffler<size_t, V>>(n_chunk_keys);
+}
+
+template <class V>
+void DistVector<V>::disable_streaming_shuffle() {
+  shuffler.reset();
+}
+
+template <class V>
+void DistVector<V>::enable_spill(const size_t max_n_keys, const std::string& spill_dir) {
+  spill_buffer = std::make_shared<internal::SpillBuffer<size_t, V>>(max_n_keys, spill_dir);
+}
 
-  local_data.resize(n_local, value);
+template <class V>
+void DistVector<V>::disable_spill() {
+  spill_buffer.reset();
+}
+
+template <class V>
+void DistVector<V>::enable_append_shuffle(const double max_repeat_rate) {
+  append_buffer = std::make_shared<internal::AppendBuffer<size_t, V>>(max_repeat_rate);
+}
+
+template <class V>
+void DistVector<V>::disable_append_shuffle() {
+  append_buffer.reset();
+}
+
+template <class V>
+void DistVector<V>::set_shuffle_plan(const std::shared_ptr<ShufflePlan>& plan) {
+  if (plan && plan->is_recorded() && plan->get_n_keys_recorded() != n) {
+    throw std::invalid_argument("shuffle plan recorded for a different size");
+  }
+  shuffle_plan = plan;
 }
 
 template <class V>
-void DistVector<V>::async_set(
-    const size_t key, const V& value, const std::function<void(V&, const V&)>& reducer) {
+template <class R>
+void DistVector<V>::async_set(const size_t key, const V& value, const R& reducer) {
   const size_t n_procs_u = n_procs;
   const size_t proc_id_u = proc_id;
   const size_t dest_proc_id = key % n_procs_u;
   const size_t dest_key = key / n_procs_u;
   if (dest_proc_id == proc_id_u) {
     local_data.async_set(dest_key, value, reducer);
+  } else if (shuffle_plan && shuffle_plan->async_set(dest_proc_id, dest_key, value, reducer)) {
+    return;
+  } else if (shuffler) {
+    const auto& merger = [&](const size_t recv_key, const size_t, const V& recv_value) {
+      local_data.async_set(recv_key, recv_value, reducer);
+    };
+    shuffler->async_set(dest_proc_id, dest_key, hasher(dest_key), value, reducer, merger);
+  } else if (spill_buffer) {
+    spill_buffer->async_set(dest_proc_id, dest_key, hasher(dest_key), value, reducer);
+  } else if (append_buffer &&
+             append_buffer->async_set(dest_proc_id, dest_key, hasher(dest_key), value)) {
+    return;
   } else {
     remote_data[dest_proc_id].async_set(dest_key, hasher(dest_key), value, reducer);
   }
@@ -126,87 +266,121 @@ void DistVector<V>::async_set(
 
 template <class V>
 void DistVector<V>::sync(const std::function<void(V&, const V&)>& reducer) {
-  const auto& node_handler = [&](const size_t key, const size_t, const V& value) {
-    local_data.async_set(key, value, reducer);
-  };
+  std::vector<std::string> send_bufs;
+  std::vector<std::string> recv_bufs;
+  get_send_bufs(reducer, send_bufs);
+  // Keys that all stay local, e.g. from a co-partitioned source or on a replayed shuffle plan,
+  // need no exchange.
+  if (!shuffler) internal::ExchangeUtil::all_to_all_if_any(send_bufs, recv_bufs, co_partitioned);
+  merge_recv_bufs(reducer, recv_bufs);
+}
+
+template <class V>
+SyncHandle DistVector<V>::sync_async(const std::function<void(V&, const V&)>& reducer) {
+  std::vector<std::string> send_bufs;
+  get_send_bufs(reducer, send_bufs);
+  std::unique_ptr<internal::AsyncExchange> exchange;
+  if (!shuffler && !co_partitioned) exchange.reset(new internal::AsyncExchange(send_bufs));
+  return SyncHandle(std::move(exchange), [this, reducer](std::vector<std::string>& recv_bufs) {
+    merge_recv_bufs(reducer, recv_bufs);
+  });
+}
 
-  // Accelerate overall network transfer through randomization.
-  const auto& shuffled_procs = internal::MpiUtil::generate_shuffled_procs();
-  const int shuffled_id = internal::MpiUtil::get_shuffled_id(shuffled_procs);
-
-  std::vector<std::string> send_bufs(n_procs);
-  std::vector<std::string> recv_bufs(n_procs);
-  const size_t BUF_SIZE = 1 << 20;
-  char send_buf_char[BUF_SIZE];
-  char recv_buf_char[BUF_SIZE];
-  MPI_Request reqs[2];
-  MPI_Status stats[2];
-
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    remote_data[dest_proc_id].sync(reducer);
+template <class V>
+void DistVector<V>::get_send_bufs(
+    const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& send_bufs) {
+  send_bufs.assign(n_procs, std::string());
+  if (shuffler) return;
+
+  if (spill_buffer) {
+    spill_buffer->sync_spilled([&](const size_t key, const size_t, const V& value) {
+      local_data.async_set(key, value, reducer);
+    });
+    spill_buffer->flush(
+        [&](const int dest_proc_id, const size_t key, const size_t hash_value, const V& value) {
+          remote_data[dest_proc_id].set(key, hash_value, value, reducer);
+        });
   }
 
-#pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    hps::to_string(remote_data[dest_proc_id], send_bufs[i]);
-    remote_data[dest_proc_id].clear();
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) remote_data[i].sync(reducer);
   }
 
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    const int src_proc_id = shuffled_procs[(shuffled_id + n_procs - i) % n_procs];
-    const auto& send_buf = send_bufs[i];
-    auto& recv_buf = recv_bufs[i];
-    size_t send_cnt = send_buf.size();
-    size_t recv_cnt = 0;
-    MPI_Irecv(
-        &recv_cnt, 1, internal::MpiType<size_t>::value, src_proc_id, 0, MPI_COMM_WORLD, &reqs[0]);
-    MPI_Isend(
-        &send_cnt, 1, internal::MpiType<size_t>::value, dest_proc_id, 0, MPI_COMM_WORLD, &reqs[1]);
-    MPI_Waitall(2, reqs, stats);
-    size_t send_pos = 0;
-    size_t recv_pos = 0;
-    recv_buf.clear();
-    recv_buf.reserve(recv_cnt);
-    while (send_pos < send_cnt || recv_pos < recv_cnt) {
-      const int recv_trunk_cnt = (recv_cnt - recv_pos >= BUF_SIZE) ? BUF_SIZE : recv_cnt - recv_pos;
-      const int send_trunk_cnt = (send_cnt - send_pos >= BUF_SIZE) ? BUF_SIZE : send_cnt - send_pos;
-      if (recv_trunk_cnt > 0) {
-        MPI_Irecv(
-            recv_buf_char, recv_trunk_cnt, MPI_CHAR, src_proc_id, 1, MPI_COMM_WORLD, &reqs[0]);
-        recv_pos += recv_trunk_cnt;
-      }
-      if (send_trunk_cnt > 0) {
-        send_buf.copy(send_buf_char, send_trunk_cnt, send_pos);
-        MPI_Issend(
-            send_buf_char, send_trunk_cnt, MPI_CHAR, dest_proc_id, 1, MPI_COMM_WORLD, &reqs[1]);
-        send_pos += send_trunk_cnt;
-      }
-      MPI_Waitall(2, reqs, stats);
-      recv_buf.append(recv_buf_char, recv_trunk_cnt);
-    }
+  if (append_buffer) {
+    // Appended pairs join the hashed keys of the same destination, or the plan being recorded.
+    const bool records_shuffle_plan = shuffle_plan && !shuffle_plan->is_recorded();
+    append_buffer->flush(
+        [&](const int i) {
+          return i != proc_id && (records_shuffle_plan || remote_data[i].get_n_keys() > 0);
+        },
+        [&](const int dest_proc_id, const size_t key, const size_t hash_value, const V& value) {
+          remote_data[dest_proc_id].set(key, hash_value, value, reducer);
+        });
+  }
+
+  if (shuffle_plan && shuffle_plan->is_recorded()) {
+    shuffle_plan->sync(reducer, [&](const size_t key, const V& value) {
+      local_data.async_set(key, value, reducer);
+    });
+  } else if (shuffle_plan) {
+    record_shuffle_plan();
   }
 
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    hps::from_string(recv_bufs[i], remote_data[dest_proc_id]);
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id || remote_data[i].get_n_keys() == 0) continue;
+    hps::to_string(remote_data[i], send_bufs[i]);
+    remote_data[i].clear();
   }
 
+  if (append_buffer) append_buffer->get_send_bufs(send_bufs);
+
+  if (co_partitioned) internal::ExchangeUtil::check_co_partitioned(send_bufs);
+}
+
+template <class V>
+void DistVector<V>::record_shuffle_plan() {
+  std::vector<std::vector<size_t>> send_keys(n_procs);
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    remote_data[dest_proc_id].for_each_serial(node_handler);
-    remote_data[dest_proc_id].clear();
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) continue;
+    send_keys[i].reserve(remote_data[i].get_n_keys());
+    remote_data[i].for_each_serial(
+        [&](const size_t key, const size_t, const V&) { send_keys[i].push_back(key); });
+  }
+  shuffle_plan->record(n, send_keys);
+}
+
+template <class V>
+void DistVector<V>::merge_recv_bufs(
+    const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& recv_bufs) {
+  const auto& node_handler = [&](const size_t key, const size_t, const V& value) {
+    local_data.async_set(key, value, reducer);
+  };
+
+  if (shuffler) {
+    shuffler->sync(node_handler);
+    local_data.sync(reducer);
+    return;
+  }
+
+  if (append_buffer) append_buffer->merge_recv_bufs(recv_bufs, node_handler);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id || recv_bufs[i].empty()) continue;
+    hps::from_string(recv_bufs[i], remote_data[i]);
+    recv_bufs[i].clear();
+    remote_data[i].for_each_serial(node_handler);
+    remote_data[i].clear();
   }
 
   local_data.sync(reducer);
 }
 
 template <class V>
-void DistVector<V>::for_each(const std::function<void(const size_t key, V& value)>& handler) {
+template <class F>
+void DistVector<V>::for_each(const F& handler) {
   const size_t n_procs_u = n_procs;
   const size_t proc_id_u = proc_id;
 
@@ -224,54 +398,17 @@ std::vector<V> DistVector<V>::top_k(
     const size_t k, const std::function<bool(const V&, const V&)>& compare) {
   std::vector<V> local_top_k = local_data.top_k(k, compare);
 
-  std::string msg_buf;
   std::vector<V> partner_top_k;
 
   int step = 1;
-  const int BUF_SIZE = 1 << 20;
-  char msg_buf_char[BUF_SIZE];
-  size_t msg_size = 0;
   while (step < n_procs) {
     if ((proc_id & (step >> 1)) != 0) break;
 
     bool is_receiver = (proc_id & step) == 0;
-    size_t pos = 0;
     partner_top_k.clear();
-    msg_buf.clear();
 
     if (is_receiver && proc_id + step < n_procs) {
-      // Get size.
-      MPI_Recv(
-          &msg_size,
-          1,
-          internal::MpiType<size_t>::value,
-          proc_id + step,
-          0,
-          MPI_COMM_WORLD,
-          MPI_STATUS_IGNORE);
-      msg_buf.reserve(msg_size);
-
-      // Get data.
-      while (pos + BUF_SIZE <= msg_size) {
-        MPI_Recv(
-            msg_buf_char, BUF_SIZE, MPI_CHAR, proc_id + step, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        msg_buf.append(msg_buf_char, BUF_SIZE);
-        pos += BUF_SIZE;
-      }
-      if (pos < msg_size) {
-        MPI_Recv(
-            msg_buf_char,
-            msg_size - pos,
-            MPI_CHAR,
-            proc_id + step,
-            0,
-            MPI_COMM_WORLD,
-            MPI_STATUS_IGNORE);
-        msg_buf.append(msg_buf_char, msg_size - pos);
-      }
-
-      // Parse data.
-      hps::from_string(msg_buf, partner_top_k);
+      internal::ObjectTransport::recv(partner_top_k, proc_id + step);
 
       // Merge.
       std::vector<V> local_top_k_new;
@@ -301,23 +438,7 @@ std::vector<V> DistVector<V>::top_k(
       }
       local_top_k = local_top_k_new;
     } else if (!is_receiver) {
-      // Serialize data.
-      hps::to_string(local_top_k, msg_buf);
-
-      // Send size.
-      msg_size = msg_buf.size();
-      MPI_Send(&msg_size, 1, internal::MpiType<size_t>::value, proc_id - step, 0, MPI_COMM_WORLD);
-
-      // Send data.
-      while (pos + BUF_SIZE <= msg_size) {
-        msg_buf.copy(msg_buf_char, BUF_SIZE, pos);
-        MPI_Send(msg_buf_char, BUF_SIZE, MPI_CHAR, proc_id - step, 0, MPI_COMM_WORLD);
-        pos += BUF_SIZE;
-      }
-      if (pos < msg_size) {
-        msg_buf.copy(msg_buf_char, msg_size - pos, pos);
-        MPI_Send(msg_buf_char, msg_size - pos, MPI_CHAR, proc_id - step, 0, MPI_COMM_WORLD);
-      }
+      internal::ObjectTransport::send(local_top_k, proc_id - step);
     }
 
     step <<= 1;
@@ -328,4 +449,53 @@ std::vector<V> DistVector<V>::top_k(
   return local_top_k;
 }
 
+template <class V>
+void DistVector<V>::save(const std::string& path) {
+  std::vector<V> values(get_n_local(n_procs, proc_id));
+  local_data.for_each([&](const size_t local_key, V& value) { values[local_key] = value; });
+  internal::Checkpoint::save(path, internal::Checkpoint::DIST_VECTOR, n, 0, values);
+}
+
+template <class V>
+void DistVector<V>::load(const std::string& path) {
+  internal::Checkpoint::Header header;
+  std::string data;
+  std::vector<size_t> block_offsets;
+  size_t first_block_id;
+  internal::Checkpoint::load(
+      path, internal::Checkpoint::DIST_VECTOR, header, data, block_offsets, first_block_id);
+  const size_t n_blocks = block_offsets.size() - 1;
+  resize(header.n);
+
+  // Block i holds the values of the local keys of the proc that saved it, in order.
+  std::vector<std::vector<V>> blocks(n_blocks);
+  int error = 0;
+  for (size_t i = 0; i < n_blocks; i++) {
+    const size_t size = block_offsets[i + 1] - block_offsets[i];
+    internal::Checkpoint::decode(data.data() + block_offsets[i], size, blocks[i]);
+    if (blocks[i].size() != get_n_local(header.n_procs, first_block_id + i)) error = 1;
+  }
+  data.clear();
+  data.shrink_to_fit();
+  MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (error) throw std::runtime_error("corrupt checkpoint " + path);
+
+  if (header.n_procs == static_cast<size_t>(n_procs)) {
+    const auto& values = blocks[0];
+    local_data.for_each([&](const size_t local_key, V& value) { value = values[local_key]; });
+    return;
+  }
+  const size_t n_saved_procs = header.n_procs;
+  for (size_t i = 0; i < n_blocks; i++) {
+    const size_t saved_proc_id = first_block_id + i;
+    const auto& values = blocks[i];
+    const size_t n_values = values.size();
+#pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < n_values; j++) {
+      async_set(j * n_saved_procs + saved_proc_id, values[j]);
+    }
+  }
+  sync();
+}
+
 }  // namespace blaze
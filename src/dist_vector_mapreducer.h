@@ -16,60 +16,37 @@
 
 namespace blaze {
 
-template <class VS>
+// Also maps other sources of (key, value) records such as DistTextFile, as S.
+template <class VS, class S = DistVector<VS>>
 class DistVectorMapreducer {
  public:
-  template <class VD>
-  static void mapreduce(
-      blaze::DistVector<VS>& source,
-      const std::function<void(
-          const size_t key,
-          const VS& value,
-          const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      std::vector<VD>& dest);
+  // Mapper: void(const size_t key, const VS& value, const auto& emit).
+  // Emit: void(const size_t key, const VD& value) or void(const KD& key, const VD& value).
+  // Templated on the mapper and reducer types so that emits and reductions can be inlined.
+  template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+  static void mapreduce(S& source, const M& mapper, const R& reducer, std::vector<VD>& dest);
 
-  template <class VD>
+  template <class VD, class M>
   static void mapreduce(
-      blaze::DistVector<VS>& source,
-      const std::function<void(
-          const size_t key,
-          const VS& value,
-          const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::string& reducer,
-      std::vector<VD>& dest);
+      S& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest);
 
-  template <class VD>
-  static void mapreduce(
-      blaze::DistVector<VS>& source,
-      const std::function<void(
-          const size_t key,
-          const VS& value,
-          const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      blaze::DistVector<VD>& dest);
+  template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+  static void mapreduce(S& source, const M& mapper, const R& reducer, DistVector<VD>& dest);
 
-  template <class KD, class VD, class HD = std::hash<KD>>
+  template <class KD,
+            class VD,
+            class HD,
+            class M,
+            class R,
+            class = internal::EnableIfReducerFunc<R>>
   static void mapreduce(
-      blaze::DistVector<VS>& source,
-      const std::function<void(
-          const size_t key,
-          const VS& value,
-          const std::function<void(const KD&, const VD&)>& emit)>& mapper,
-      const std::function<void(VD&, const VD&)>& reducer,
-      blaze::DistHashMap<KD, VD, HD>& dest);
+      S& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest);
 };
 
-template <class VS>
-template <class VD>
-void DistVectorMapreducer<VS>::mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    std::vector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M, class R, class>
+void DistVectorMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
   internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
   const auto& emit = [&](const size_t key, const VD& value) {
     dest_wrapper.async_set(key, value, reducer);
@@ -79,36 +56,25 @@ void DistVectorMapreducer<VS>::mapreduce(
   dest_wrapper.sync(reducer);
 }
 
-template <class VS>
-template <class VD>
-void DistVectorMapreducer<VS>::mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::string& reducer,
-    std::vector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M>
+void DistVectorMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
   internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  const auto& emit = [&](const size_t key, const VD& value) {
-    dest_wrapper.async_set(key, value, reducer_func);
-  };
-  const auto& handler = [&](const size_t key, const VS& value) { mapper(key, value, emit); };
-  source.for_each(handler);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    const auto& emit = [&](const size_t key, const VD& value) {
+      dest_wrapper.async_set(key, value, reducer_func);
+    };
+    const auto& handler = [&](const size_t key, const VS& value) { mapper(key, value, emit); };
+    source.for_each(handler);
+  });
   dest_wrapper.sync(reducer);
 }
 
-template <class VS>
-template <class VD>
-void DistVectorMapreducer<VS>::mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    blaze::DistVector<VD>& dest) {
+template <class VS, class S>
+template <class VD, class M, class R, class>
+void DistVectorMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
   const auto& emit = [&](const size_t key, const VD& value) {
     dest.async_set(key, value, reducer);
   };
@@ -117,15 +83,10 @@ void DistVectorMapreducer<VS>::mapreduce(
   dest.sync(reducer);
 }
 
-template <class VS>
-template <class KD, class VD, class HD>
-void DistVectorMapreducer<VS>::mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key, const VS& value, const std::function<void(const KD&, const VD&)>& emit)>&
-        mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    blaze::DistHashMap<KD, VD, HD>& dest) {
+template <class VS, class S>
+template <class KD, class VD, class HD, class M, class R, class>
+void DistVectorMapreducer<VS, S>::mapreduce(
+    S& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
   const auto& emit = [&](const KD& key, const VD& value) { dest.async_set(key, value, reducer); };
   const auto& handler = [&](const size_t key, const VS& value) { mapper(key, value, emit); };
   source.for_each(handler);
@@ -0,0 +1,203 @@
+#ifndef BLAZE_INTERNAL_APPEND_BUFFER_H_
+#define BLAZE_INTERNAL_APPEND_BUFFER_H_
+
+#include <omp.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "hash/hash_set.h"
+#include "mpi_util.h"
+
+namespace blaze {
+namespace internal {
+
+// Appends remote key value pairs to per-thread, per-destination buffers without hashing or
+// reducing them, and leaves the reduction to the receiver, which is cheaper than the hashed remote
+// maps when keys rarely repeat. Each thread samples about one in SAMPLE_INTERVAL keys by hash. Once
+// more than max_repeat_rate of its samples are repeats, it leaves the rest of the round to the
+// hashed maps, into which the pairs already appended for the same destinations are then merged.
+template <class K, class V, class H = std::hash<K>>
+class AppendBuffer {
+ public:
+  constexpr static double DEFAULT_MAX_REPEAT_RATE = 0.5;
+
+  constexpr static size_t SAMPLE_INTERVAL = 16;
+
+  constexpr static size_t MIN_N_SAMPLES = 1 << 8;
+
+  constexpr static size_t MAX_N_SAMPLED_KEYS = 1 << 12;
+
+  // A send buf ends with one of these to tell the receiver how to parse it.
+  constexpr static char APPENDED = 'A';
+
+  constexpr static char HASHED = 'H';
+
+  AppendBuffer(const double max_repeat_rate);
+
+  // Returns whether the pair was appended. Otherwise the caller takes the hashed path.
+  bool async_set(const int dest_proc_id, const K& key, const size_t hash_value, const V& value);
+
+  // Hands the appended pairs of the destinations the filter picks to the handler and clears them.
+  // Filter: bool(const int dest_proc_id).
+  // Handler: void(const int dest_proc_id, const K& key, const size_t hash_value, const V& value).
+  template <class P, class F>
+  void flush(const P& filter, const F& handler);
+
+  // Tags the hashed send bufs and serializes the appended pairs into the empty ones.
+  void get_send_bufs(std::vector<std::string>& send_bufs);
+
+  // Merges the appended recv bufs through the merger and strips the tags of the hashed ones.
+  // Merger: void(const K& key, const size_t hash_value, const V& value), must be thread safe.
+  template <class M>
+  void merge_recv_bufs(std::vector<std::string>& recv_bufs, const M& merger);
+
+  void clear();
+
+ private:
+  int n_procs;
+
+  int proc_id;
+
+  double max_repeat_rate;
+
+  H hasher;
+
+  std::vector<std::vector<std::vector<std::pair<K, V>>>> thread_bufs;
+
+  std::vector<int> thread_is_hashing;
+
+  std::vector<size_t> thread_n_samples;
+
+  // Fingerprints of the sampled destination and key pairs.
+  std::vector<hash::HashSet<size_t>> thread_sampled_keys;
+
+  void sample(const int thread_id, const int dest_proc_id, const size_t hash_value);
+
+  static bool is_sampled(const size_t hash_value) {
+    return ((hash_value * 0x9E3779B97F4A7C15ULL) >> 32) % SAMPLE_INTERVAL == 0;
+  }
+};
+
+template <class K, class V, class H>
+AppendBuffer<K, V, H>::AppendBuffer(const double max_repeat_rate)
+    : max_repeat_rate(max_repeat_rate) {
+  n_procs = MpiUtil::get_n_procs();
+  proc_id = MpiUtil::get_proc_id();
+  const int n_threads = omp_get_max_threads();
+  thread_bufs.resize(n_threads);
+  for (auto& bufs : thread_bufs) bufs.resize(n_procs);
+  thread_is_hashing.assign(n_threads, 0);
+  thread_n_samples.assign(n_threads, 0);
+  thread_sampled_keys.resize(n_threads);
+}
+
+template <class K, class V, class H>
+bool AppendBuffer<K, V, H>::async_set(
+    const int dest_proc_id, const K& key, const size_t hash_value, const V& value) {
+  const int thread_id = omp_get_thread_num();
+  if (thread_is_hashing[thread_id]) return false;
+  if (max_repeat_rate < 1.0 && is_sampled(hash_value)) sample(thread_id, dest_proc_id, hash_value);
+  thread_bufs[thread_id][dest_proc_id].emplace_back(key, value);
+  return true;
+}
+
+template <class K, class V, class H>
+void AppendBuffer<K, V, H>::sample(
+    const int thread_id, const int dest_proc_id, const size_t hash_value) {
+  auto& sampled_keys = thread_sampled_keys[thread_id];
+  if (sampled_keys.get_n_keys() >= MAX_N_SAMPLED_KEYS) return;
+  const size_t fingerprint = hash_value * n_procs + dest_proc_id;
+  sampled_keys.set(fingerprint, fingerprint);
+  const size_t n_samples = ++thread_n_samples[thread_id];
+  if (n_samples < MIN_N_SAMPLES) return;
+  const double repeat_rate = 1.0 - static_cast<double>(sampled_keys.get_n_keys()) / n_samples;
+  if (repeat_rate > max_repeat_rate) thread_is_hashing[thread_id] = 1;
+}
+
+template <class K, class V, class H>
+template <class P, class F>
+void AppendBuffer<K, V, H>::flush(const P& filter, const F& handler) {
+  const int n_threads = thread_bufs.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+    if (!filter(dest_proc_id)) continue;
+    for (int i = 0; i < n_threads; i++) {
+      auto& buf = thread_bufs[i][dest_proc_id];
+      for (const auto& pair : buf) {
+        handler(dest_proc_id, pair.first, hasher(pair.first), pair.second);
+      }
+      buf.clear();
+    }
+  }
+}
+
+template <class K, class V, class H>
+void AppendBuffer<K, V, H>::get_send_bufs(std::vector<std::string>& send_bufs) {
+  const int n_threads = thread_bufs.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+    if (dest_proc_id == proc_id) continue;
+    auto& send_buf = send_bufs[dest_proc_id];
+    if (!send_buf.empty()) {
+      send_buf += HASHED;
+      continue;
+    }
+    std::vector<std::vector<std::pair<K, V>>> parts;
+    for (int i = 0; i < n_threads; i++) {
+      auto& buf = thread_bufs[i][dest_proc_id];
+      if (buf.empty()) continue;
+      parts.push_back(std::move(buf));
+      buf.clear();
+    }
+    if (parts.empty()) continue;
+    hps::to_string(parts, send_buf);
+    send_buf += APPENDED;
+  }
+  thread_is_hashing.assign(n_threads, 0);
+  thread_n_samples.assign(n_threads, 0);
+  for (auto& sampled_keys : thread_sampled_keys) sampled_keys.clear();
+}
+
+template <class K, class V, class H>
+template <class M>
+void AppendBuffer<K, V, H>::merge_recv_bufs(std::vector<std::string>& recv_bufs, const M& merger) {
+  std::vector<std::vector<std::vector<std::pair<K, V>>>> proc_parts(n_procs);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_procs; i++) {
+    auto& recv_buf = recv_bufs[i];
+    if (i == proc_id || recv_buf.empty()) continue;
+    const char tag = recv_buf.back();
+    recv_buf.pop_back();
+    if (tag != APPENDED) continue;
+    hps::from_string(recv_buf, proc_parts[i]);
+    recv_buf.clear();
+  }
+
+  // Merge part by part, so that the threads share the work of busy senders.
+  std::vector<std::vector<std::pair<K, V>>*> parts;
+  for (auto& proc_part : proc_parts) {
+    for (auto& part : proc_part) parts.push_back(&part);
+  }
+  const int n_parts = parts.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_parts; i++) {
+    for (const auto& pair : *parts[i]) merger(pair.first, hasher(pair.first), pair.second);
+  }
+}
+
+template <class K, class V, class H>
+void AppendBuffer<K, V, H>::clear() {
+  for (auto& bufs : thread_bufs) {
+    for (auto& buf : bufs) buf.clear();
+  }
+  thread_is_hashing.assign(thread_is_hashing.size(), 0);
+  thread_n_samples.assign(thread_n_samples.size(), 0);
+  for (auto& sampled_keys : thread_sampled_keys) sampled_keys.clear();
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
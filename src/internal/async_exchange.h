@@ -0,0 +1,144 @@
+#ifndef BLAZE_INTERNAL_ASYNC_EXCHANGE_H_
+#define BLAZE_INTERNAL_ASYNC_EXCHANGE_H_
+
+#include <mpi.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "transport.h"
+
+namespace blaze {
+namespace internal {
+
+// Sends send_bufs[i] to proc i and receives recv_bufs[i] from proc i like ExchangeUtil::all_to_all,
+// but over nonblocking requests on a comm of its own, so that the caller may go on with other work
+// and other exchanges while it is in flight. Under MPI_THREAD_MULTIPLE a progress thread drives the
+// requests. Otherwise they progress whenever test is called, which must be from the thread that
+// calls MPI, as with MPI_THREAD_FUNNELED.
+class AsyncExchange {
+ public:
+  // Collective. Takes over the send bufs, which are kept until the sends complete.
+  AsyncExchange(std::vector<std::string>& send_bufs);
+
+  AsyncExchange(const AsyncExchange&) = delete;
+
+  AsyncExchange& operator=(const AsyncExchange&) = delete;
+
+  // Waits for the exchange.
+  ~AsyncExchange();
+
+  // Whether the exchange is complete.
+  bool test();
+
+  void wait();
+
+  // Complete once test returns true or wait returns.
+  std::vector<std::string>& get_recv_bufs() { return recv_bufs; }
+
+ private:
+  int n_procs;
+
+  int proc_id;
+
+  MPI_Comm comm;
+
+  std::vector<std::string> send_bufs;
+
+  std::vector<std::string> recv_bufs;
+
+  std::vector<size_t> send_sizes;
+
+  std::vector<size_t> recv_sizes;
+
+  std::vector<MPI_Request> reqs;
+
+  bool is_sizes_exchanged;
+
+  std::atomic<bool> is_done;
+
+  std::thread progress_thread;
+
+  // Tests the pending requests, and posts the transfers once the sizes are known.
+  bool progress();
+};
+
+inline AsyncExchange::AsyncExchange(std::vector<std::string>& send_bufs) : is_done(false) {
+  n_procs = MpiUtil::get_n_procs();
+  proc_id = MpiUtil::get_proc_id();
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  this->send_bufs.swap(send_bufs);
+  recv_bufs.assign(n_procs, std::string());
+  send_sizes.assign(n_procs, 0);
+  recv_sizes.assign(n_procs, 0);
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) send_sizes[i] = this->send_bufs[i].size();
+  }
+  reqs.emplace_back();
+  const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+  MPI_Ialltoall(
+      send_sizes.data(), 1, size_t_mpi, recv_sizes.data(), 1, size_t_mpi, comm, &reqs.back());
+  is_sizes_exchanged = false;
+
+  int thread_level;
+  MPI_Query_thread(&thread_level);
+  if (thread_level == MPI_THREAD_MULTIPLE) {
+    progress_thread = std::thread([this]() {
+      while (!progress()) std::this_thread::yield();
+    });
+  }
+}
+
+inline AsyncExchange::~AsyncExchange() {
+  wait();
+  int is_finalized;
+  MPI_Finalized(&is_finalized);
+  if (!is_finalized) MPI_Comm_free(&comm);
+}
+
+inline bool AsyncExchange::test() {
+  if (progress_thread.joinable()) return is_done;
+  return progress();
+}
+
+inline void AsyncExchange::wait() {
+  if (progress_thread.joinable()) {
+    progress_thread.join();
+    return;
+  }
+  while (!progress()) continue;
+}
+
+inline bool AsyncExchange::progress() {
+  if (is_done) return true;
+  int is_complete;
+  MPI_Testall(reqs.size(), reqs.data(), &is_complete, MPI_STATUSES_IGNORE);
+  if (!is_complete) return false;
+  reqs.clear();
+  if (is_sizes_exchanged) {
+    std::vector<std::string>().swap(send_bufs);
+    is_done = true;
+    return true;
+  }
+
+  // Post all transfers of the round at once, as the sizes are known now.
+  is_sizes_exchanged = true;
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) continue;
+    recv_bufs[i].resize(recv_sizes[i]);
+    Transport::irecv(&recv_bufs[i][0], recv_sizes[i], i, comm, Transport::MAX_CHUNK_SIZE, reqs);
+  }
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) continue;
+    Transport::isend(send_bufs[i].data(), send_sizes[i], i, comm, Transport::MAX_CHUNK_SIZE, reqs);
+  }
+  return false;
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
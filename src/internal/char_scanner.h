@@ -0,0 +1,80 @@
+#ifndef BLAZE_INTERNAL_CHAR_SCANNER_H_
+#define BLAZE_INTERNAL_CHAR_SCANNER_H_
+
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace blaze {
+namespace internal {
+
+// Scans chars 16 at a time with SSE2 where available, and one at a time otherwise.
+class CharScanner {
+ public:
+  // The first c in [begin, end), or end.
+  static const char* find(const char* begin, const char* end, const char c);
+
+  // The number of c in [begin, end).
+  static size_t count(const char* begin, const char* end, const char c);
+
+  // Whitespace, other control chars, and commas separate the fields of a line.
+  static bool is_delimiter(const char c) {
+    return static_cast<unsigned char>(c) <= ' ' || c == ',';
+  }
+
+  // The first char in [begin, end) that is not a delimiter, or end.
+  static const char* skip_delimiters(const char* begin, const char* end);
+};
+
+inline const char* CharScanner::find(const char* begin, const char* end, const char c) {
+#ifdef __SSE2__
+  const __m128i target = _mm_set1_epi8(c);
+  while (end - begin >= 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target));
+    if (mask != 0) return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+#endif
+  while (begin < end && *begin != c) begin++;
+  return begin;
+}
+
+inline size_t CharScanner::count(const char* begin, const char* end, const char c) {
+  size_t n = 0;
+#ifdef __SSE2__
+  const __m128i target = _mm_set1_epi8(c);
+  while (end - begin >= 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    n += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target)));
+    begin += 16;
+  }
+#endif
+  for (; begin < end; begin++) n += *begin == c;
+  return n;
+}
+
+inline const char* CharScanner::skip_delimiters(const char* begin, const char* end) {
+#ifdef __SSE2__
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i comma = _mm_set1_epi8(',');
+  while (end - begin >= 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    // Chars up to the space as unsigned are those whose min with the space is themselves.
+    const __m128i is_space = _mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk);
+    const __m128i is_delimiter = _mm_or_si128(is_space, _mm_cmpeq_epi8(chunk, comma));
+    const int mask = ~_mm_movemask_epi8(is_delimiter) & 0xFFFF;
+    if (mask != 0) return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+#endif
+  while (begin < end && is_delimiter(*begin)) begin++;
+  return begin;
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef BLAZE_INTERNAL_CHECKPOINT_H_
+#define BLAZE_INTERNAL_CHECKPOINT_H_
+
+#include <mpi.h>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "file_range.h"
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "object_transport.h"
+
+namespace blaze {
+namespace internal {
+
+// The binary file a distributed container is saved to: a header, the size of the block of each
+// proc that saved it, and the blocks in proc order. Each proc writes its own block and reads its
+// own share of the blocks with collective MPI-IO, so no proc holds more than its share.
+class Checkpoint {
+ public:
+  enum Kind : uint64_t { DIST_VECTOR = 1, DIST_HASH_MAP = 2 };
+
+  struct Header {
+    char magic[8];
+
+    uint64_t kind;
+
+    // The number of values of a DistVector or keys of a DistHashMap.
+    uint64_t n;
+
+    uint64_t n_procs;
+
+    // The hasher that placed the keys, whose saved hash values are only valid for the same hasher.
+    uint64_t hasher_id;
+  };
+
+  // The block of a DistHashMap is the hps of a part per thread: the pairs of the thread, with the
+  // hash values under which the local map holds them.
+  template <class K, class V>
+  using MapPart = std::pair<std::vector<size_t>, std::vector<std::pair<K, V>>>;
+
+  // Bytes written or read with one collective call, so that MPI counts fit in an int.
+  constexpr static size_t MAX_IO_SIZE = static_cast<size_t>(1) << 30;
+
+  template <class H>
+  static uint64_t get_hasher_id() {
+    return std::hash<std::string>()(typeid(H).name());
+  }
+
+  // Collective. Saves t as the block of this proc. Objects with a PodLayout are saved as is, and
+  // all others through hps.
+  template <class T>
+  static void save(
+      const std::string& path,
+      const Kind kind,
+      const size_t n,
+      const uint64_t hasher_id,
+      const T& t) {
+    save(path, kind, n, hasher_id, t, IsPod<T>());
+  }
+
+  // Collective. Reads the header and the blocks this proc loads into data, the i-th of which is
+  // block first_block_id + i at [block_offsets[i], block_offsets[i + 1]). With as many procs as
+  // saved the file, that is the block of the same proc. Otherwise it is a balanced share of
+  // consecutive blocks, possibly none. Throws on all procs if the file is not a checkpoint of kind.
+  static void load(
+      const std::string& path,
+      const Kind kind,
+      Header& header,
+      std::string& data,
+      std::vector<size_t>& block_offsets,
+      size_t& first_block_id);
+
+  template <class T>
+  static void decode(const char* data, const size_t size, T& t) {
+    decode(data, size, t, IsPod<T>());
+  }
+
+ private:
+  template <class T>
+  using IsPod = std::integral_constant<bool, PodLayout<T>::IS_POD>;
+
+  static const char* get_magic() { return "BLZCKPT1"; }
+
+  template <class T>
+  static void save(
+      const std::string& path,
+      const Kind kind,
+      const size_t n,
+      const uint64_t hasher_id,
+      const T& t,
+      std::true_type) {
+    save_block(path, kind, n, hasher_id, PodLayout<T>::get_data(t), PodLayout<T>::get_size(t));
+  }
+
+  template <class T>
+  static void save(
+      const std::string& path,
+      const Kind kind,
+      const size_t n,
+      const uint64_t hasher_id,
+      const T& t,
+      std::false_type) {
+    const std::string block = hps::to_string(t);
+    save_block(path, kind, n, hasher_id, block.data(), block.size());
+  }
+
+  static void save_block(
+      const std::string& path,
+      const Kind kind,
+      const size_t n,
+      const uint64_t hasher_id,
+      const char* data,
+      const size_t size);
+
+  template <class T>
+  static void decode(const char* data, const size_t size, T& t, std::true_type);
+
+  template <class T>
+  static void decode(const char* data, const size_t, T& t, std::false_type) {
+    hps::from_char_array(data, t);
+  }
+
+  // Collective. Calls io(pos, io_size) for the chunks of size bytes, as many times on each proc as
+  // the largest size of any proc takes, and returns whether any call failed on any proc.
+  template <class F>
+  static bool io_all(const size_t size, const F& io);
+};
+
+inline void Checkpoint::save_block(
+    const std::string& path,
+    const Kind kind,
+    const size_t n,
+    const uint64_t hasher_id,
+    const char* data,
+    const size_t size) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  const MPI_Datatype uint64_t_mpi = MpiType<uint64_t>::value;
+  const uint64_t block_size = size;
+  std::vector<uint64_t> block_sizes(n_procs);
+  MPI_Allgather(&block_size, 1, uint64_t_mpi, block_sizes.data(), 1, uint64_t_mpi, MPI_COMM_WORLD);
+  size_t offset = sizeof(Header) + n_procs * sizeof(uint64_t);
+  for (int i = 0; i < proc_id; i++) offset += block_sizes[i];
+
+  MPI_File file;
+  const int open_error = MPI_File_open(
+      MPI_COMM_WORLD, path.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+  if (open_error) throw std::runtime_error("Cannot open file " + path);
+  // Drop the rest of an earlier, larger file.
+  bool error = MPI_File_set_size(file, 0) != MPI_SUCCESS;
+  if (MpiUtil::is_master()) {
+    Header header;
+    std::memcpy(header.magic, get_magic(), sizeof(header.magic));
+    header.kind = kind;
+    header.n = n;
+    header.n_procs = n_procs;
+    header.hasher_id = hasher_id;
+    error |= MPI_File_write_at(file, 0, &header, sizeof(Header), MPI_CHAR, MPI_STATUS_IGNORE) !=
+             MPI_SUCCESS;
+    error |= MPI_File_write_at(
+                 file,
+                 sizeof(Header),
+                 block_sizes.data(),
+                 n_procs,
+                 uint64_t_mpi,
+                 MPI_STATUS_IGNORE) != MPI_SUCCESS;
+  }
+  error |= io_all(size, [&](const size_t pos, const size_t io_size) {
+    return MPI_File_write_at_all(
+        file, offset + pos, data + pos, io_size, MPI_CHAR, MPI_STATUS_IGNORE);
+  });
+  MPI_File_close(&file);
+  int any_error = error;
+  MPI_Allreduce(MPI_IN_PLACE, &any_error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (any_error) throw std::runtime_error("Cannot write file " + path);
+}
+
+inline void Checkpoint::load(
+    const std::string& path,
+    const Kind kind,
+    Header& header,
+    std::string& data,
+    std::vector<size_t>& block_offsets,
+    size_t& first_block_id) {
+  MPI_File file;
+  const int open_error =
+      MPI_File_open(MPI_COMM_WORLD, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+  if (open_error) throw std::runtime_error("Cannot open file " + path);
+
+  // All procs read the header and the block sizes, so that they agree on whether they are valid.
+  MPI_Offset file_size_mpi;
+  MPI_File_get_size(file, &file_size_mpi);
+  const size_t file_size = file_size_mpi;
+  bool is_valid = file_size >= sizeof(Header);
+  if (is_valid) {
+    MPI_File_read_at_all(file, 0, &header, sizeof(Header), MPI_CHAR, MPI_STATUS_IGNORE);
+    const size_t max_n_procs = (file_size - sizeof(Header)) / sizeof(uint64_t);
+    is_valid = std::memcmp(header.magic, get_magic(), sizeof(header.magic)) == 0 &&
+               header.n_procs > 0 && header.n_procs <= max_n_procs;
+  }
+  std::vector<uint64_t> block_sizes;
+  size_t data_begin = 0;
+  if (is_valid) {
+    data_begin = sizeof(Header) + header.n_procs * sizeof(uint64_t);
+    block_sizes.resize(header.n_procs);
+    MPI_File_read_at_all(
+        file,
+        sizeof(Header),
+        block_sizes.data(),
+        header.n_procs,
+        MpiType<uint64_t>::value,
+        MPI_STATUS_IGNORE);
+    size_t total_size = data_begin;
+    for (const uint64_t block_size : block_sizes) total_size += block_size;
+    is_valid = total_size == file_size;
+  }
+  if (!is_valid || header.kind != kind) {
+    MPI_File_close(&file);
+    throw std::runtime_error(
+        is_valid ? "Checkpoint of another container " + path : "Not a checkpoint " + path);
+  }
+
+  size_t end_block_id;
+  FileRange::get_range(header.n_procs, first_block_id, end_block_id);
+  size_t offset = data_begin;
+  for (size_t i = 0; i < first_block_id; i++) offset += block_sizes[i];
+  block_offsets.assign(1, 0);
+  for (size_t i = first_block_id; i < end_block_id; i++) {
+    block_offsets.push_back(block_offsets.back() + block_sizes[i]);
+  }
+  data.resize(block_offsets.back());
+  const bool any_error = io_all(data.size(), [&](const size_t pos, const size_t io_size) {
+    return MPI_File_read_at_all(
+        file, offset + pos, &data[0] + pos, io_size, MPI_CHAR, MPI_STATUS_IGNORE);
+  });
+  MPI_File_close(&file);
+  if (any_error) throw std::runtime_error("Cannot read file " + path);
+}
+
+template <class T>
+void Checkpoint::decode(const char* data, const size_t size, T& t, std::true_type) {
+  using Layout = PodLayout<T>;
+  Layout::resize(t, size);
+  if (Layout::get_size(t) != size) throw std::runtime_error("corrupt checkpoint block");
+  if (size > 0) std::memcpy(Layout::get_data(t), data, size);
+}
+
+template <class F>
+bool Checkpoint::io_all(const size_t size, const F& io) {
+  size_t max_size;
+  MPI_Allreduce(&size, &max_size, 1, MpiType<size_t>::value, MPI_MAX, MPI_COMM_WORLD);
+  int error = 0;
+  for (size_t pos = 0; pos < max_size; pos += MAX_IO_SIZE) {
+    // Procs with fewer bytes left take part in the collective call with none.
+    size_t io_size = 0;
+    if (pos < size) io_size = size - pos < MAX_IO_SIZE ? size - pos : MAX_IO_SIZE;
+    if (io(io_size > 0 ? pos : 0, io_size) != MPI_SUCCESS) error = 1;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  return error != 0;
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
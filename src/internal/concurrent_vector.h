@@ -21,15 +21,11 @@ class ConcurrentVector {
 
   void resize(const size_t n, const V& value = V());
 
-  void set(
-      const size_t key,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
+  template <class R = void (*)(V&, const V&)>
+  void set(const size_t key, const V& value, const R& reducer = Reducer<V>::overwrite);
 
-  void async_set(
-      const size_t key,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
+  template <class R = void (*)(V&, const V&)>
+  void async_set(const size_t key, const V& value, const R& reducer = Reducer<V>::overwrite);
 
   void sync(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
 
@@ -37,7 +33,9 @@ class ConcurrentVector {
 
   void for_each_serial(const std::function<void(const size_t i, const V& value)>& handler) const;
 
-  void for_each(const std::function<void(const size_t key, V& value)>& handler);
+  // Handler: void(const size_t key, V& value).
+  template <class F>
+  void for_each(const F& handler);
 
   std::vector<V> top_k(const size_t k, const std::function<bool(const V&, const V&)>& compare);
 
@@ -99,8 +97,8 @@ void ConcurrentVector<V>::resize(const size_t n, const V& value) {
 }
 
 template <class V>
-void ConcurrentVector<V>::set(
-    const size_t key, const V& value, const std::function<void(V&, const V&)>& reducer) {
+template <class R>
+void ConcurrentVector<V>::set(const size_t key, const V& value, const R& reducer) {
   const size_t segment_id = key & n_segments_filter;
   const size_t elem_id = key >> n_segments_shift;
   auto& lock = segment_locks[segment_id];
@@ -110,8 +108,8 @@ void ConcurrentVector<V>::set(
 }
 
 template <class V>
-void ConcurrentVector<V>::async_set(
-    const size_t key, const V& value, const std::function<void(V&, const V&)>& reducer) {
+template <class R>
+void ConcurrentVector<V>::async_set(const size_t key, const V& value, const R& reducer) {
   const size_t segment_id = key & n_segments_filter;
   const size_t elem_id = key >> n_segments_shift;
   auto& lock = segment_locks[segment_id];
@@ -143,7 +141,8 @@ void ConcurrentVector<V>::sync(const std::function<void(V&, const V&)>& reducer)
 }
 
 template <class V>
-void ConcurrentVector<V>::for_each(const std::function<void(const size_t key, V& value)>& handler) {
+template <class F>
+void ConcurrentVector<V>::for_each(const F& handler) {
 #pragma omp parallel for schedule(static, 1)
   for (size_t segment_id = 0; segment_id < n_segments; segment_id++) {
     auto& segment = segments[segment_id];
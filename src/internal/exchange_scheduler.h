@@ -0,0 +1,313 @@
+#ifndef BLAZE_INTERNAL_EXCHANGE_SCHEDULER_H_
+#define BLAZE_INTERNAL_EXCHANGE_SCHEDULER_H_
+
+#include <mpi.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "transport.h"
+
+namespace blaze {
+namespace internal {
+
+// Runs an all-to-all exchange on the plan that suits the sizes of its messages. All procs gather
+// the full matrix of message sizes first, so that they pick the same plan:
+// - ALLTOALLV, native MPI_Alltoallv, when all messages are small and latency dominates.
+// - PAIRWISE, n_procs - 1 rounds of one send and one receive each, when the sizes are balanced.
+// - WINDOWED, when a few messages are much larger than the rest. All receives are posted up
+//   front, and the sends go out largest first with N_WINDOW_PEERS peers in flight, so that the
+//   large messages start early and do not stall the small ones.
+class ExchangeScheduler {
+ public:
+  enum class Plan { ALLTOALLV, PAIRWISE, WINDOWED };
+
+  constexpr static size_t MAX_ALLTOALLV_MSG_SIZE = 1 << 16;
+
+  // The largest message may be at most this many times the mean nonempty one for PAIRWISE.
+  constexpr static double MAX_PAIRWISE_SKEW = 4.0;
+
+  constexpr static int N_WINDOW_PEERS = 4;
+
+  // Collective. Sends send_bufs[i] to proc i and receives recv_bufs[i] from proc i.
+  static void all_to_all(
+      const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs) {
+    std::vector<size_t> size_matrix;
+    gather_size_matrix(send_bufs, size_matrix);
+    const Plan plan = get_plan(size_matrix);
+    if (is_verbose() && MpiUtil::is_master()) print_plan(plan, size_matrix);
+    all_to_all(send_bufs, recv_bufs, plan, size_matrix);
+  }
+
+  // Collective. Same, on the given plan.
+  static void all_to_all(
+      const std::vector<std::string>& send_bufs,
+      std::vector<std::string>& recv_bufs,
+      const Plan plan,
+      const std::vector<size_t>& size_matrix);
+
+  // The sizes of the messages from proc i to proc j at i * n_procs + j.
+  static void gather_size_matrix(
+      const std::vector<std::string>& send_bufs, std::vector<size_t>& size_matrix);
+
+  static Plan get_plan(const std::vector<size_t>& size_matrix);
+
+  static const char* get_plan_name(const Plan plan) {
+    switch (plan) {
+      case Plan::ALLTOALLV:
+        return "alltoallv";
+      case Plan::PAIRWISE:
+        return "pairwise";
+      default:
+        return "windowed";
+    }
+  }
+
+  // Print the plan of each exchange and the sizes it was chosen for on proc 0.
+  static void set_verbose(const bool verbose) { is_verbose() = verbose; }
+
+ private:
+  static bool& is_verbose() {
+    static bool verbose = false;
+    return verbose;
+  }
+
+  static void print_plan(const Plan plan, const std::vector<size_t>& size_matrix);
+
+  static void alltoallv(
+      const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs);
+
+  static void pairwise(
+      const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs);
+
+  static void windowed(
+      const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs);
+};
+
+inline void ExchangeScheduler::gather_size_matrix(
+    const std::vector<std::string>& send_bufs, std::vector<size_t>& size_matrix) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  std::vector<size_t> send_sizes(n_procs, 0);
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) send_sizes[i] = send_bufs[i].size();
+  }
+  size_matrix.resize(static_cast<size_t>(n_procs) * n_procs);
+  const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+  MPI_Allgather(
+      send_sizes.data(),
+      n_procs,
+      size_t_mpi,
+      size_matrix.data(),
+      n_procs,
+      size_t_mpi,
+      MPI_COMM_WORLD);
+}
+
+inline ExchangeScheduler::Plan ExchangeScheduler::get_plan(const std::vector<size_t>& size_matrix) {
+  size_t n_procs = 0;
+  while (n_procs * n_procs < size_matrix.size()) n_procs++;
+  size_t max_size = 0;
+  size_t total_size = 0;
+  size_t n_msgs = 0;
+  // The bytes each proc sends and receives must fit the int displacements of MPI_Alltoallv.
+  size_t max_proc_size = 0;
+  std::vector<size_t> recv_totals(n_procs, 0);
+  for (size_t i = 0; i < n_procs; i++) {
+    size_t send_total = 0;
+    for (size_t j = 0; j < n_procs; j++) {
+      const size_t size = size_matrix[i * n_procs + j];
+      if (size == 0) continue;
+      max_size = std::max(max_size, size);
+      total_size += size;
+      n_msgs++;
+      send_total += size;
+      recv_totals[j] += size;
+    }
+    max_proc_size = std::max(max_proc_size, send_total);
+  }
+  for (const size_t recv_total : recv_totals) max_proc_size = std::max(max_proc_size, recv_total);
+
+  if (max_size <= MAX_ALLTOALLV_MSG_SIZE && max_proc_size <= INT_MAX) return Plan::ALLTOALLV;
+  const double mean_size = static_cast<double>(total_size) / n_msgs;
+  if (max_size <= MAX_PAIRWISE_SKEW * mean_size) return Plan::PAIRWISE;
+  return Plan::WINDOWED;
+}
+
+inline void ExchangeScheduler::print_plan(const Plan plan, const std::vector<size_t>& size_matrix) {
+  size_t max_size = 0;
+  size_t total_size = 0;
+  for (const size_t size : size_matrix) {
+    max_size = std::max(max_size, size);
+    total_size += size;
+  }
+  fprintf(
+      stderr,
+      "Exchange: %s plan for %zu bytes, largest message %zu bytes\n",
+      get_plan_name(plan),
+      total_size,
+      max_size);
+}
+
+inline void ExchangeScheduler::all_to_all(
+    const std::vector<std::string>& send_bufs,
+    std::vector<std::string>& recv_bufs,
+    const Plan plan,
+    const std::vector<size_t>& size_matrix) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  recv_bufs.assign(n_procs, std::string());
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) recv_bufs[i].resize(size_matrix[static_cast<size_t>(i) * n_procs + proc_id]);
+  }
+  if (n_procs == 1) return;
+
+  switch (plan) {
+    case Plan::ALLTOALLV:
+      alltoallv(send_bufs, recv_bufs);
+      break;
+    case Plan::PAIRWISE:
+      pairwise(send_bufs, recv_bufs);
+      break;
+    default:
+      windowed(send_bufs, recv_bufs);
+  }
+}
+
+inline void ExchangeScheduler::alltoallv(
+    const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  std::vector<int> send_counts(n_procs, 0);
+  std::vector<int> send_displs(n_procs, 0);
+  std::vector<int> recv_counts(n_procs, 0);
+  std::vector<int> recv_displs(n_procs, 0);
+  std::string send_buf;
+  for (int i = 0; i < n_procs; i++) {
+    send_displs[i] = send_buf.size();
+    if (i == proc_id) continue;
+    send_counts[i] = send_bufs[i].size();
+    send_buf.append(send_bufs[i]);
+  }
+  int recv_size = 0;
+  for (int i = 0; i < n_procs; i++) {
+    recv_displs[i] = recv_size;
+    recv_counts[i] = recv_bufs[i].size();
+    recv_size += recv_counts[i];
+  }
+  std::string recv_buf(recv_size, 0);
+  MPI_Alltoallv(
+      send_buf.data(),
+      send_counts.data(),
+      send_displs.data(),
+      MPI_CHAR,
+      &recv_buf[0],
+      recv_counts.data(),
+      recv_displs.data(),
+      MPI_CHAR,
+      MPI_COMM_WORLD);
+  for (int i = 0; i < n_procs; i++) {
+    std::copy(
+        recv_buf.begin() + recv_displs[i],
+        recv_buf.begin() + recv_displs[i] + recv_counts[i],
+        recv_bufs[i].begin());
+  }
+}
+
+inline void ExchangeScheduler::pairwise(
+    const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  std::vector<MPI_Request> reqs;
+  for (int step = 1; step < n_procs; step++) {
+    const int dest_proc_id = (proc_id + step) % n_procs;
+    const int src_proc_id = (proc_id + n_procs - step) % n_procs;
+    auto& recv_buf = recv_bufs[src_proc_id];
+    const auto& send_buf = send_bufs[dest_proc_id];
+    reqs.clear();
+    Transport::irecv(
+        &recv_buf[0],
+        recv_buf.size(),
+        src_proc_id,
+        MPI_COMM_WORLD,
+        Transport::MAX_CHUNK_SIZE,
+        reqs);
+    Transport::isend(
+        send_buf.data(),
+        send_buf.size(),
+        dest_proc_id,
+        MPI_COMM_WORLD,
+        Transport::MAX_CHUNK_SIZE,
+        reqs);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+}
+
+inline void ExchangeScheduler::windowed(
+    const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  std::vector<MPI_Request> recv_reqs;
+  for (int i = 1; i < n_procs; i++) {
+    const int src_proc_id = (proc_id + n_procs - i) % n_procs;
+    auto& recv_buf = recv_bufs[src_proc_id];
+    Transport::irecv(
+        &recv_buf[0],
+        recv_buf.size(),
+        src_proc_id,
+        MPI_COMM_WORLD,
+        Transport::MAX_CHUNK_SIZE,
+        recv_reqs);
+  }
+
+  // Largest first, and among equal sizes staggered by proc, so that the procs spread their sends.
+  std::vector<int> dest_proc_ids;
+  for (int i = 1; i < n_procs; i++) {
+    const int dest_proc_id = (proc_id + i) % n_procs;
+    if (!send_bufs[dest_proc_id].empty()) dest_proc_ids.push_back(dest_proc_id);
+  }
+  std::stable_sort(dest_proc_ids.begin(), dest_proc_ids.end(), [&](const int a, const int b) {
+    return send_bufs[a].size() > send_bufs[b].size();
+  });
+
+  // Each request belongs to a peer, which leaves the window once all its requests are done.
+  std::vector<MPI_Request> send_reqs;
+  std::vector<int> req_peers;
+  std::vector<int> n_peer_reqs(dest_proc_ids.size(), 0);
+  size_t n_posted = 0;
+  int n_in_flight = 0;
+  const auto& post_next = [&]() {
+    const size_t peer = n_posted++;
+    const auto& send_buf = send_bufs[dest_proc_ids[peer]];
+    const size_t n_reqs_before = send_reqs.size();
+    Transport::isend(
+        send_buf.data(),
+        send_buf.size(),
+        dest_proc_ids[peer],
+        MPI_COMM_WORLD,
+        Transport::MAX_CHUNK_SIZE,
+        send_reqs);
+    n_peer_reqs[peer] = send_reqs.size() - n_reqs_before;
+    req_peers.resize(send_reqs.size(), peer);
+    n_in_flight++;
+  };
+  while (n_in_flight < N_WINDOW_PEERS && n_posted < dest_proc_ids.size()) post_next();
+  while (n_in_flight > 0) {
+    int index;
+    MPI_Waitany(send_reqs.size(), send_reqs.data(), &index, MPI_STATUS_IGNORE);
+    if (--n_peer_reqs[req_peers[index]] > 0) continue;
+    n_in_flight--;
+    if (n_posted < dest_proc_ids.size()) post_next();
+  }
+
+  MPI_Waitall(recv_reqs.size(), recv_reqs.data(), MPI_STATUSES_IGNORE);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef BLAZE_INTERNAL_EXCHANGE_UTIL_H_
+#define BLAZE_INTERNAL_EXCHANGE_UTIL_H_
+
+#include <mpi.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "exchange_scheduler.h"
+#include "mpi_util.h"
+#include "transport.h"
+
+namespace blaze {
+namespace internal {
+
+class ExchangeUtil {
+ public:
+  // Sends send_bufs[i] to proc i and receives recv_bufs[i] from proc i, on the plan the
+  // ExchangeScheduler picks for the sizes of the messages.
+  static void all_to_all(
+      const std::vector<std::string>& send_bufs, std::vector<std::string>& recv_bufs) {
+    ExchangeScheduler::all_to_all(send_bufs, recv_bufs);
+  }
+
+  // Collective. Like all_to_all, but skips the exchange when no proc has anything to send, e.g.
+  // when every key was emitted on the proc that owns it. If co_partitioned, check_co_partitioned has
+  // already made sure of that on all procs.
+  static void all_to_all_if_any(
+      const std::vector<std::string>& send_bufs,
+      std::vector<std::string>& recv_bufs,
+      const bool co_partitioned = false) {
+    if (!co_partitioned && has_any(send_bufs)) {
+      all_to_all(send_bufs, recv_bufs);
+    } else {
+      recv_bufs.assign(MpiUtil::get_n_procs(), std::string());
+    }
+  }
+
+  // Collective. Throws on all procs if a container asserted to be co-partitioned has remote keys
+  // to send on any proc, so that no proc goes on into the exchange alone.
+  static void check_co_partitioned(const std::vector<std::string>& send_bufs) {
+    if (has_any(send_bufs)) throw std::runtime_error("remote key set on co-partitioned container");
+  }
+
+  // Collective. Whether any proc has a non-empty buf.
+  static bool has_any(const std::vector<std::string>& bufs) {
+    int has_bufs = 0;
+    for (const auto& buf : bufs) has_bufs |= !buf.empty();
+    int has_any_bufs = 0;
+    MPI_Allreduce(&has_bufs, &has_any_bufs, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    return has_any_bufs != 0;
+  }
+
+  // Reduces msg over all procs with a binomial tree into msg on the root.
+  // Merge: void(std::string& msg, const std::string& remote_msg).
+  template <class F>
+  static void reduce(std::string& msg, const F& merge, const int root) {
+    const int n_procs = MpiUtil::get_n_procs();
+    const int rank = (MpiUtil::get_proc_id() + n_procs - root) % n_procs;
+    std::string remote_msg;
+    int step = 1;
+    while (step < n_procs) {
+      if ((rank & (step >> 1)) != 0) break;
+      const bool is_receiver = (rank & step) == 0;
+      if (is_receiver && rank + step < n_procs) {
+        Transport::recv(remote_msg, (rank + step + root) % n_procs);
+        merge(msg, remote_msg);
+      } else if (!is_receiver) {
+        Transport::send(msg, (rank - step + root) % n_procs);
+      }
+      step <<= 1;
+    }
+  }
+
+  // Reduces msg over all procs and broadcasts the result back into msg.
+  template <class F>
+  static void allreduce(std::string& msg, const F& merge) {
+    reduce(msg, merge, 0);
+    Transport::broadcast(msg, 0);
+  }
+};
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef BLAZE_INTERNAL_FILE_RANGE_H_
+#define BLAZE_INTERNAL_FILE_RANGE_H_
+
+#include <mpi.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "transport.h"
+
+namespace blaze {
+namespace internal {
+
+// Splits a file into one byte range per proc, so that each proc reads its own range only. Each
+// line belongs to the proc whose range holds the newline before it, and the first line to proc 0.
+// The bytes at the front of a range that end a line started on an earlier proc go to that proc.
+class FileRange {
+ public:
+  // Bytes read with one collective call, so that MPI counts fit in an int.
+  constexpr static size_t MAX_READ_SIZE = static_cast<size_t>(1) << 30;
+
+  // The range [begin, end) of this proc out of size bytes.
+  static void get_range(const size_t size, size_t& begin, size_t& end) {
+    const size_t n_procs_u = MpiUtil::get_n_procs();
+    const size_t proc_id_u = MpiUtil::get_proc_id();
+    begin = size / n_procs_u * proc_id_u + std::min(size % n_procs_u, proc_id_u);
+    end = begin + size / n_procs_u + (size % n_procs_u > proc_id_u ? 1 : 0);
+  }
+
+  // Collective. Reads the range of this proc into buf with MPI-IO.
+  static void read(const std::string& filename, std::string& buf);
+
+  // Collective. Sends the bytes of data up to its first newline, the head, to the previous proc,
+  // and receives the bytes that end the last line of this proc, the tail, from the next one. The
+  // lines of this proc are data[head_size, size) followed by tail. Without a newline in data, the
+  // whole of data is the head and goes on to the previous proc with the tail from the next one.
+  static void exchange_boundaries(
+      const char* data, const size_t size, size_t& head_size, std::string& tail);
+};
+
+inline void FileRange::read(const std::string& filename, std::string& buf) {
+  MPI_File file;
+  const int error =
+      MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+  if (error) throw std::runtime_error("Cannot open file");
+  MPI_Offset file_size;
+  MPI_File_get_size(file, &file_size);
+  const size_t size = file_size;
+  size_t begin;
+  size_t end;
+  get_range(size, begin, end);
+  buf.resize(end - begin);
+
+  // All procs take part in each collective read, so those with fewer bytes left read none.
+  const size_t n_procs_u = MpiUtil::get_n_procs();
+  const size_t max_range_size = (size + n_procs_u - 1) / n_procs_u;
+  for (size_t pos = 0; pos < max_range_size; pos += MAX_READ_SIZE) {
+    size_t read_size = 0;
+    if (pos < buf.size()) {
+      read_size = buf.size() - pos < MAX_READ_SIZE ? buf.size() - pos : MAX_READ_SIZE;
+    }
+    char* read_ptr = &buf[0] + (read_size > 0 ? pos : 0);
+    MPI_File_read_at_all(file, begin + pos, read_ptr, read_size, MPI_CHAR, MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&file);
+}
+
+inline void FileRange::exchange_boundaries(
+    const char* data, const size_t size, size_t& head_size, std::string& tail) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  const char* newline =
+      size > 0 ? static_cast<const char*>(std::memchr(data, '\n', size)) : nullptr;
+  head_size = proc_id == 0 ? 0 : newline == nullptr ? size : newline - data + 1;
+  tail.clear();
+
+  // A head that ends in a newline goes out right away. Otherwise it waits for the tail, so that
+  // a line across several ranges travels down to the proc where it starts.
+  const bool sends_now = proc_id > 0 && newline != nullptr;
+  size_t head_msg_size = head_size;
+  std::vector<MPI_Request> reqs;
+  if (sends_now) {
+    reqs.emplace_back();
+    MPI_Isend(
+        &head_msg_size, 1, MpiType<size_t>::value, proc_id - 1, 0, MPI_COMM_WORLD, &reqs.back());
+    Transport::isend(
+        data, head_size, proc_id - 1, MPI_COMM_WORLD, Transport::MAX_CHUNK_SIZE, reqs);
+  }
+  if (proc_id < n_procs - 1) Transport::recv(tail, proc_id + 1);
+  if (proc_id > 0 && !sends_now) {
+    std::string head_msg(data, size);
+    head_msg.append(tail);
+    tail.clear();
+    Transport::send(head_msg, proc_id - 1);
+  }
+  MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
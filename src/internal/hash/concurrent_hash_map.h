@@ -12,24 +12,19 @@ namespace hash {
 template <class K, class V, class H = std::hash<K>>
 class ConcurrentHashMap : public ConcurrentHashBase<K, V, HashMap<K, V, H>, H> {
  public:
-  void set(
-      const K& key,
-      const size_t hash_value,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer);
-
-  void async_set(
-      const K& key,
-      const size_t hash_value,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer);
+  template <class R>
+  void set(const K& key, const size_t hash_value, const V& value, const R& reducer);
+
+  template <class R>
+  void async_set(const K& key, const size_t hash_value, const V& value, const R& reducer);
 
   V get(const K& key, const size_t hash_value, const V& default_value) const;
 
   void sync(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
 
-  void for_each(const std::function<void(const K& key, const size_t hash_value, const V& value)>&
-                    handler) const;
+  // Handler: void(const K& key, const size_t hash_value, const V& value).
+  template <class F>
+  void for_each(const F& handler) const;
 
   void for_each_serial(
       const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler)
@@ -58,11 +53,9 @@ class ConcurrentHashMap : public ConcurrentHashBase<K, V, HashMap<K, V, H>, H> {
 };
 
 template <class K, class V, class H>
+template <class R>
 void ConcurrentHashMap<K, V, H>::set(
-    const K& key,
-    const size_t hash_value,
-    const V& value,
-    const std::function<void(V&, const V&)>& reducer) {
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
   const size_t segment_id = hash_value % n_segments;
   auto& lock = segment_locks[segment_id];
   HashMap<K, V, H>* segment_ptr = &segments[segment_id];
@@ -72,11 +65,9 @@ void ConcurrentHashMap<K, V, H>::set(
 }
 
 template <class K, class V, class H>
+template <class R>
 void ConcurrentHashMap<K, V, H>::async_set(
-    const K& key,
-    const size_t hash_value,
-    const V& value,
-    const std::function<void(V&, const V&)>& reducer) {
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
   const size_t segment_id = hash_value % n_segments;
   auto& lock = segment_locks[segment_id];
   HashMap<K, V, H>* segment_ptr = &segments[segment_id];
@@ -115,9 +106,8 @@ void ConcurrentHashMap<K, V, H>::sync(const std::function<void(V&, const V&)>& r
 }
 
 template <class K, class V, class H>
-void ConcurrentHashMap<K, V, H>::for_each(
-    const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler)
-    const {
+template <class F>
+void ConcurrentHashMap<K, V, H>::for_each(const F& handler) const {
 #pragma omp parallel for schedule(dynamic, 1)
   for (size_t segment_id = 0; segment_id < n_segments; segment_id++) {
     segments[segment_id].for_each(handler);
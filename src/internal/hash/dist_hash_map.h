@@ -1,12 +1,27 @@
 #ifndef BLAZE_INTERNAL_HASH_DIST_HASH_MAP_H_
 #define BLAZE_INTERNAL_HASH_DIST_HASH_MAP_H_
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "../../../vendor/hps/src/hps.h"
 #include "../../gather.h"
 #include "../../reducer.h"
+#include "../../sync_handle.h"
+#include "../append_buffer.h"
+#include "../checkpoint.h"
+#include "../exchange_util.h"
 #include "../mpi_util.h"
+#include "../node_comm.h"
+#include "../shuffle_codec.h"
+#include "../spill_buffer.h"
+#include "../stream_shuffler.h"
 #include "concurrent_hash_map.h"
 #include "dist_hash_base.h"
+#include "hash_map.h"
+#include "hot_key_cache.h"
 
 namespace blaze {
 namespace internal {
@@ -15,19 +30,90 @@ namespace hash {
 template <class K, class V, class H = std::hash<K>>
 class DistHashMap : public DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H> {
  public:
-  void async_set(
-      const K& key,
-      const size_t hash_value,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer);
+  constexpr static size_t DEFAULT_N_COMBINER_KEYS = 1 << 12;
+
+  DistHashMap();
+
+  // Pre-reduce emitted values in a bounded per-thread table before they reach the shared maps.
+  // A thread's table is flushed when it holds max_n_keys keys and at sync.
+  void enable_combiner(const size_t max_n_keys = DEFAULT_N_COMBINER_KEYS);
+
+  void disable_combiner();
+
+  // Sample the emitted keys on each thread and reduce the values of keys that make up at least
+  // min_hot_fraction of the samples locally, so that each hot key sends one value per thread.
+  void enable_hot_key_detection(const double min_hot_fraction = 0.01);
+
+  void disable_hot_key_detection();
+
+  // Collective. Send remote values in chunks of n_chunk_keys keys while async_set is still being
+  // called, instead of all at once in sync. Requires MPI_THREAD_FUNNELED to overlap the transfer.
+  void enable_streaming_shuffle(
+      const size_t n_chunk_keys = StreamShuffler<K, V, DistHasher<K, H>>::DEFAULT_N_CHUNK_KEYS);
+
+  void disable_streaming_shuffle();
+
+  // Keep at most about max_n_keys remote keys in memory and spill the rest to temp files in
+  // spill_dir, which are exchanged in bounded rounds at sync.
+  void enable_spill(const size_t max_n_keys, const std::string& spill_dir = "/tmp");
+
+  void disable_spill();
+
+  // The runs spilled to temp files since the last sync.
+  size_t get_n_spilled_runs() const {
+    return spill_buffer ? spill_buffer->get_n_spilled_runs() : 0;
+  }
+
+  // Collective. Append remote pairs to per-thread buffers for each destination instead of hashing
+  // them into per-destination maps, and leave the reduction to the receiver, which pays off when
+  // keys rarely repeat. A thread goes back to the maps for the rest of a round once more than
+  // max_repeat_rate of the keys it samples are repeats. With 1.0, remote pairs are always appended.
+  void enable_append_shuffle(
+      const double max_repeat_rate = AppendBuffer<K, V>::DEFAULT_MAX_REPEAT_RATE);
+
+  void disable_append_shuffle();
+
+  // Collective. Encode the remote pairs column by column, with prefix encoding for sorted string
+  // keys and XOR encoding for floating point values, and compress each send buf with a fast LZ
+  // codec when the time the saved bytes take on the network exceeds the time the codec takes, as
+  // measured on a sample of the buf. Each node has network_bytes_per_sec, which its procs share.
+  // With 0, compress whenever that saves bytes.
+  void enable_compression(
+      const double network_bytes_per_sec = ShuffleCompressor::DEFAULT_NETWORK_BYTES_PER_SEC);
+
+  void disable_compression();
+
+  // Collective. Assert that every key set from now on is owned by the proc that sets it, e.g. when
+  // the mapper emits the keys of a source with the same key type and hasher. Values then go
+  // straight into the local map past the combiner and the hot key caches, and sync skips the
+  // exchange without checking the other procs, and throws if a remote key was set.
+  void set_co_partitioned(const bool co_partitioned) { this->co_partitioned = co_partitioned; }
+
+  bool is_co_partitioned() const { return co_partitioned; }
+
+  template <class R>
+  void async_set(const K& key, const size_t hash_value, const V& value, const R& reducer);
 
   void sync(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
 
+  // Collective. Starts the exchange of sync and returns while it is in flight, so that other work
+  // can overlap it. The merge happens once the handle completes. With the streaming shuffle, the
+  // exchange happens when the handle is first tested or waited for.
+  SyncHandle sync_async(const std::function<void(V&, const V&)>& reducer = Reducer<V>::overwrite);
+
+  // The two halves of sync around the exchange, so that several containers can share one round.
+  // The bufs are indexed by proc id.
+  void get_send_bufs(
+      const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& send_bufs);
+
+  void merge_recv_bufs(
+      const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& recv_bufs);
+
   double get_local(const K& key, const size_t hash_value, const V& default_value) const;
 
-  void for_each(
-      const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler)
-      const;
+  // Handler: void(const K& key, const size_t hash_value, const V& value).
+  template <class F>
+  void for_each(const F& handler) const;
 
   void for_each_serial(
       const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler);
@@ -38,9 +124,45 @@ class DistHashMap : public DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher
       const std::function<void(V2&, const V2&)>& reducer,
       const V2& default_value);
 
+  void clear();
+
+  void clear_and_shrink();
+
+  // Collective. Writes the synced pairs and their hash values to a binary checkpoint at path with
+  // MPI-IO, a block per proc.
+  void save(const std::string& path);
+
+  // Collective. Replaces the contents with those of the checkpoint at path. With as many procs and
+  // the same hasher as saved it, each proc puts the pairs of its own block into its map under the
+  // saved hash values. Otherwise each proc reads a share of the blocks and sends the pairs to their
+  // owners in one sync, by the saved hash values under the same hasher and by rehashing otherwise.
+  void load(const std::string& path);
+
  private:
   DistHasher<K, H> dist_hasher;
 
+  size_t max_n_combiner_keys;
+
+  bool co_partitioned;
+
+  std::vector<HashMap<K, V, H>> thread_combiners;
+
+  std::vector<HotKeyCache<K, V, H>> thread_hot_key_caches;
+
+  std::shared_ptr<StreamShuffler<K, V, DistHasher<K, H>>> shuffler;
+
+  std::shared_ptr<SpillBuffer<K, V, DistHasher<K, H>>> spill_buffer;
+
+  std::shared_ptr<AppendBuffer<K, V, DistHasher<K, H>>> append_buffer;
+
+  std::shared_ptr<ShuffleCompressor> compressor;
+
+  template <class R>
+  void async_set_direct(const K& key, const size_t hash_value, const V& value, const R& reducer);
+
+  template <class R>
+  void flush_combiner(HashMap<K, V, H>& combiner, const R& reducer);
+
   using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::hasher;
 
   using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::n_procs;
@@ -50,24 +172,131 @@ class DistHashMap : public DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher
   using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::local_data;
 
   using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::remote_data;
+};
 
-  using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::generate_shuffled_procs;
+template <class K, class V, class H>
+DistHashMap<K, V, H>::DistHashMap() {
+  max_n_combiner_keys = 0;
+  co_partitioned = false;
+}
 
-  using DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::get_shuffled_id;
-};
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_combiner(const size_t max_n_keys) {
+  max_n_combiner_keys = max_n_keys;
+  thread_combiners.resize(omp_get_max_threads());
+  for (auto& combiner : thread_combiners) combiner.reserve(max_n_keys);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_combiner() {
+  for (const auto& combiner : thread_combiners) {
+    if (combiner.get_n_keys() > 0) throw std::runtime_error("combiner not synced before disabled");
+  }
+  max_n_combiner_keys = 0;
+  thread_combiners.clear();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_hot_key_detection(const double min_hot_fraction) {
+  thread_hot_key_caches.assign(omp_get_max_threads(), HotKeyCache<K, V, H>(min_hot_fraction));
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_hot_key_detection() {
+  thread_hot_key_caches.clear();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_streaming_shuffle(const size_t n_chunk_keys) {
+  shuffler = std::make_shared<StreamShuffler<K, V, DistHasher<K, H>>>(n_chunk_keys);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_streaming_shuffle() {
+  shuffler.reset();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_spill(const size_t max_n_keys, const std::string& spill_dir) {
+  spill_buffer = std::make_shared<SpillBuffer<K, V, DistHasher<K, H>>>(max_n_keys, spill_dir);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_spill() {
+  spill_buffer.reset();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_append_shuffle(const double max_repeat_rate) {
+  append_buffer = std::make_shared<AppendBuffer<K, V, DistHasher<K, H>>>(max_repeat_rate);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_append_shuffle() {
+  append_buffer.reset();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::enable_compression(const double network_bytes_per_sec) {
+  const int n_node_procs = MpiUtil::get_n_procs(NodeComm::get_instance().get_node_comm());
+  compressor = std::make_shared<ShuffleCompressor>(network_bytes_per_sec / n_node_procs);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::disable_compression() {
+  compressor.reset();
+}
 
 template <class K, class V, class H>
+template <class R>
 void DistHashMap<K, V, H>::async_set(
-    const K& key,
-    const size_t hash_value,
-    const V& value,
-    const std::function<void(V&, const V&)>& reducer) {
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
+  if (co_partitioned) {
+    async_set_direct(key, hash_value, value, reducer);
+    return;
+  }
+  if (!thread_hot_key_caches.empty() &&
+      thread_hot_key_caches[omp_get_thread_num()].async_set(key, hash_value, value, reducer)) {
+    return;
+  }
+  if (max_n_combiner_keys == 0) {
+    async_set_direct(key, hash_value, value, reducer);
+    return;
+  }
+  auto& combiner = thread_combiners[omp_get_thread_num()];
+  combiner.set(key, hash_value, value, reducer);
+  if (combiner.get_n_keys() >= max_n_combiner_keys) flush_combiner(combiner, reducer);
+}
+
+template <class K, class V, class H>
+template <class R>
+void DistHashMap<K, V, H>::flush_combiner(HashMap<K, V, H>& combiner, const R& reducer) {
+  const auto& handler = [&](const K& key, const size_t hash_value, const V& value) {
+    async_set_direct(key, hash_value, value, reducer);
+  };
+  combiner.for_each(handler);
+  combiner.clear();
+}
+
+template <class K, class V, class H>
+template <class R>
+void DistHashMap<K, V, H>::async_set_direct(
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
   const size_t n_procs_u = n_procs;
   const size_t proc_id_u = proc_id;
   const size_t dest_proc_id = hash_value % n_procs_u;
   const size_t dist_hash_value = hash_value / n_procs_u;
   if (dest_proc_id == proc_id_u) {
     local_data.async_set(key, dist_hash_value, value, reducer);
+  } else if (shuffler) {
+    const auto& merger = [&](const K& recv_key, const size_t recv_hash_value, const V& recv_value) {
+      local_data.async_set(recv_key, recv_hash_value, recv_value, reducer);
+    };
+    shuffler->async_set(dest_proc_id, key, dist_hash_value, value, reducer, merger);
+  } else if (spill_buffer) {
+    spill_buffer->async_set(dest_proc_id, key, dist_hash_value, value, reducer);
+  } else if (append_buffer && append_buffer->async_set(dest_proc_id, key, hash_value, value)) {
+    return;
   } else {
     remote_data[dest_proc_id].async_set(key, dist_hash_value, value, reducer);
   }
@@ -89,88 +318,151 @@ double DistHashMap<K, V, H>::get_local(
 
 template <class K, class V, class H>
 void DistHashMap<K, V, H>::sync(const std::function<void(V&, const V&)>& reducer) {
+  std::vector<std::string> send_bufs;
+  std::vector<std::string> recv_bufs;
+  get_send_bufs(reducer, send_bufs);
+  if (!shuffler) ExchangeUtil::all_to_all_if_any(send_bufs, recv_bufs, co_partitioned);
+  merge_recv_bufs(reducer, recv_bufs);
+}
+
+template <class K, class V, class H>
+SyncHandle DistHashMap<K, V, H>::sync_async(const std::function<void(V&, const V&)>& reducer) {
+  std::vector<std::string> send_bufs;
+  get_send_bufs(reducer, send_bufs);
+  std::unique_ptr<AsyncExchange> exchange;
+  if (!shuffler && !co_partitioned) exchange.reset(new AsyncExchange(send_bufs));
+  return SyncHandle(std::move(exchange), [this, reducer](std::vector<std::string>& recv_bufs) {
+    merge_recv_bufs(reducer, recv_bufs);
+  });
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::get_send_bufs(
+    const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& send_bufs) {
+  const int n_hot_key_caches = thread_hot_key_caches.size();
+#pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < n_hot_key_caches; i++) {
+    thread_hot_key_caches[i].flush([&](const K& key, const size_t hash_value, const V& value) {
+      async_set_direct(key, hash_value, value, reducer);
+    });
+  }
+
+  const int n_combiners = thread_combiners.size();
+#pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < n_combiners; i++) {
+    flush_combiner(thread_combiners[i], reducer);
+  }
+
+  send_bufs.assign(n_procs, std::string());
+  if (shuffler) return;
+
+  if (spill_buffer) {
+    spill_buffer->sync_spilled([&](const K& key, const size_t hash_value, const V& value) {
+      local_data.set(key, hash_value, value, reducer);
+    });
+    spill_buffer->flush(
+        [&](const int dest_proc_id, const K& key, const size_t hash_value, const V& value) {
+          remote_data[dest_proc_id].set(key, hash_value, value, reducer);
+        });
+  }
+
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) remote_data[i].sync(reducer);
+  }
+
+  if (append_buffer) {
+    // Appended pairs join the hashed keys of the same destination.
+    append_buffer->flush(
+        [&](const int i) { return i != proc_id && remote_data[i].get_n_keys() > 0; },
+        [&](const int dest_proc_id, const K& key, const size_t hash_value, const V& value) {
+          remote_data[dest_proc_id].set(key, hash_value, value, reducer);
+        });
+  }
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id || remote_data[i].get_n_keys() == 0) continue;
+    if (compressor) {
+      std::vector<std::pair<const K*, const V*>> pairs;
+      pairs.reserve(remote_data[i].get_n_keys());
+      remote_data[i].for_each_serial([&](const K& key, const size_t, const V& value) {
+        pairs.emplace_back(&key, &value);
+      });
+      PairCodec<K, V>::encode(pairs, send_bufs[i]);
+    } else {
+      hps::to_string(remote_data[i], send_bufs[i]);
+    }
+    remote_data[i].clear();
+  }
+
+  if (append_buffer) append_buffer->get_send_bufs(send_bufs);
+
+  if (co_partitioned) ExchangeUtil::check_co_partitioned(send_bufs);
+
+  if (compressor) {
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n_procs; i++) {
+      if (!send_bufs[i].empty()) compressor->compress(send_bufs[i]);
+    }
+  }
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::merge_recv_bufs(
+    const std::function<void(V&, const V&)>& reducer, std::vector<std::string>& recv_bufs) {
   const auto& node_handler = [&](const K& key, const size_t hash_value, const V& value) {
     local_data.set(key, hash_value, value, reducer);
   };
 
-  // Accelerate overall network transfer through randomization.
-  const auto& shuffled_procs = generate_shuffled_procs();
-  const int shuffled_id = get_shuffled_id(shuffled_procs);
-
-  std::vector<std::string> send_bufs(n_procs);
-  std::vector<std::string> recv_bufs(n_procs);
-  const size_t BUF_SIZE = 1 << 20;
-  char send_buf_char[BUF_SIZE];
-  char recv_buf_char[BUF_SIZE];
-  MPI_Request reqs[2];
-  MPI_Status stats[2];
+  if (shuffler) {
+    shuffler->sync(node_handler);
+    local_data.sync(reducer);
+    return;
+  }
 
+  if (compressor) {
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    hps::to_string(remote_data[dest_proc_id], send_bufs[i]);
-  }
-
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    const int src_proc_id = shuffled_procs[(shuffled_id + n_procs - i) % n_procs];
-    remote_data[dest_proc_id].sync(reducer);
-    const auto& send_buf = send_bufs[i];
-    auto& recv_buf = recv_bufs[i];
-    remote_data[dest_proc_id].clear();
-    size_t send_cnt = send_buf.size();
-    size_t recv_cnt = 0;
-    MPI_Irecv(&recv_cnt, 1, MpiType<size_t>::value, src_proc_id, 0, MPI_COMM_WORLD, &reqs[0]);
-    MPI_Isend(&send_cnt, 1, MpiType<size_t>::value, dest_proc_id, 0, MPI_COMM_WORLD, &reqs[1]);
-    MPI_Waitall(2, reqs, stats);
-    size_t send_pos = 0;
-    size_t recv_pos = 0;
-    recv_buf.clear();
-    recv_buf.reserve(recv_cnt);
-    while (send_pos < send_cnt || recv_pos < recv_cnt) {
-      const int recv_trunk_cnt = (recv_cnt - recv_pos >= BUF_SIZE) ? BUF_SIZE : recv_cnt - recv_pos;
-      const int send_trunk_cnt = (send_cnt - send_pos >= BUF_SIZE) ? BUF_SIZE : send_cnt - send_pos;
-      if (recv_trunk_cnt > 0) {
-        MPI_Irecv(
-            recv_buf_char, recv_trunk_cnt, MPI_CHAR, src_proc_id, 1, MPI_COMM_WORLD, &reqs[0]);
-        recv_pos += recv_trunk_cnt;
-      }
-      if (send_trunk_cnt > 0) {
-        send_buf.copy(send_buf_char, send_trunk_cnt, send_pos);
-        MPI_Issend(
-            send_buf_char, send_trunk_cnt, MPI_CHAR, dest_proc_id, 1, MPI_COMM_WORLD, &reqs[1]);
-        send_pos += send_trunk_cnt;
-      }
-      MPI_Waitall(2, reqs, stats);
-      recv_buf.append(recv_buf_char, recv_trunk_cnt);
+    for (int i = 0; i < n_procs; i++) {
+      if (i != proc_id && !recv_bufs[i].empty()) compressor->decompress(recv_bufs[i]);
     }
   }
 
+  if (append_buffer) append_buffer->merge_recv_bufs(recv_bufs, node_handler);
+
+  const size_t n_procs_u = n_procs;
   size_t n_keys = local_data.get_n_keys();
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    hps::from_string(recv_bufs[i], remote_data[dest_proc_id]);
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id || recv_bufs[i].empty()) continue;
+    if (compressor) {
+      auto& remote_map = remote_data[i];
+      PairCodec<K, V>::decode(
+          recv_bufs[i].data(), recv_bufs[i].size(), [&](const K& key, const V& value) {
+            remote_map.set(key, hasher(key) / n_procs_u, value, reducer);
+          });
+    } else {
+      hps::from_string(recv_bufs[i], remote_data[i]);
+    }
+    recv_bufs[i].clear();
 #pragma omp atomic
-    n_keys += remote_data[dest_proc_id].get_n_keys();
+    n_keys += remote_data[i].get_n_keys();
   }
 
   local_data.reserve(n_keys);
 
 #pragma omp parallel for schedule(dynamic, 1)
-  for (int i = 1; i < n_procs; i++) {
-    const int dest_proc_id = shuffled_procs[(shuffled_id + i) % n_procs];
-    remote_data[dest_proc_id].for_each_serial(node_handler);
-    remote_data[dest_proc_id].clear();
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) continue;
+    remote_data[i].for_each_serial(node_handler);
+    remote_data[i].clear();
   }
 
   local_data.sync(reducer);
 }
 
 template <class K, class V, class H>
-void DistHashMap<K, V, H>::for_each(
-    const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler)
-    const {
+template <class F>
+void DistHashMap<K, V, H>::for_each(const F& handler) const {
   local_data.for_each(handler);
 }
 
@@ -183,6 +475,27 @@ void DistHashMap<K, V, H>::for_each_serial(
   }
 }
 
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::clear() {
+  DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::clear();
+  for (auto& combiner : thread_combiners) combiner.clear();
+  for (auto& hot_key_cache : thread_hot_key_caches) hot_key_cache.clear();
+  if (spill_buffer) spill_buffer->clear();
+  if (append_buffer) append_buffer->clear();
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::clear_and_shrink() {
+  DistHashBase<K, V, ConcurrentHashMap<K, V, DistHasher<K, H>>, H>::clear_and_shrink();
+  for (auto& combiner : thread_combiners) {
+    combiner.clear_and_shrink();
+    combiner.reserve(max_n_combiner_keys);
+  }
+  for (auto& hot_key_cache : thread_hot_key_caches) hot_key_cache.clear();
+  if (spill_buffer) spill_buffer->clear();
+  if (append_buffer) append_buffer->clear();
+}
+
 template <class K, class V, class H>
 template <class V2>
 V2 DistHashMap<K, V, H>::mapreduce(
@@ -206,6 +519,78 @@ V2 DistHashMap<K, V, H>::mapreduce(
   return res;
 }
 
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::save(const std::string& path) {
+  const int n_threads = omp_get_max_threads();
+  std::vector<Checkpoint::MapPart<K, V>> parts(n_threads);
+  local_data.for_each([&](const K& key, const size_t hash_value, const V& value) {
+    auto& part = parts[omp_get_thread_num()];
+    part.first.push_back(hash_value);
+    part.second.emplace_back(key, value);
+  });
+  std::vector<std::string> part_bufs(n_threads);
+#pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < n_threads; i++) {
+    hps::to_string(parts[i], part_bufs[i]);
+    parts[i] = Checkpoint::MapPart<K, V>();
+  }
+  const size_t n_keys = this->get_n_keys();
+  Checkpoint::save(
+      path, Checkpoint::DIST_HASH_MAP, n_keys, Checkpoint::get_hasher_id<H>(), part_bufs);
+}
+
+template <class K, class V, class H>
+void DistHashMap<K, V, H>::load(const std::string& path) {
+  Checkpoint::Header header;
+  std::string data;
+  std::vector<size_t> block_offsets;
+  size_t first_block_id;
+  Checkpoint::load(path, Checkpoint::DIST_HASH_MAP, header, data, block_offsets, first_block_id);
+  clear();
+  const bool is_same_hasher = header.hasher_id == Checkpoint::get_hasher_id<H>();
+  const bool is_direct = is_same_hasher && header.n_procs == static_cast<size_t>(n_procs);
+  std::vector<std::string> part_bufs;
+  std::vector<size_t> part_proc_ids;
+  for (size_t i = 0; i + 1 < block_offsets.size(); i++) {
+    std::vector<std::string> block_part_bufs;
+    const size_t size = block_offsets[i + 1] - block_offsets[i];
+    Checkpoint::decode(data.data() + block_offsets[i], size, block_part_bufs);
+    for (auto& part_buf : block_part_bufs) {
+      part_bufs.push_back(std::move(part_buf));
+      part_proc_ids.push_back(first_block_id + i);
+    }
+  }
+  data.clear();
+  data.shrink_to_fit();
+  if (is_direct) local_data.reserve(header.n / n_procs);
+
+  // A saved hash value is the full hash value divided by the number of procs that saved it, and
+  // the remainder is the proc that saved it.
+  const size_t n_saved_procs = header.n_procs;
+  const int n_parts = part_bufs.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_parts; i++) {
+    Checkpoint::MapPart<K, V> part;
+    hps::from_string(part_bufs[i], part);
+    std::string().swap(part_bufs[i]);
+    const auto& hash_values = part.first;
+    const auto& pairs = part.second;
+    for (size_t j = 0; j < pairs.size(); j++) {
+      const K& key = pairs[j].first;
+      const V& value = pairs[j].second;
+      if (is_direct) {
+        local_data.set(key, hash_values[j], value, Reducer<V>::overwrite);
+      } else if (is_same_hasher) {
+        const size_t hash_value = hash_values[j] * n_saved_procs + part_proc_ids[i];
+        async_set_direct(key, hash_value, value, Reducer<V>::overwrite);
+      } else {
+        async_set_direct(key, hasher(key), value, Reducer<V>::overwrite);
+      }
+    }
+  }
+  if (!is_direct) sync(Reducer<V>::overwrite);
+}
+
 }  // namespace hash
 }  // namespace internal
 }  // namespace blaze
@@ -14,16 +14,14 @@ namespace hash {
 template <class K, class V, class H = std::hash<K>>
 class HashMap : public HashBase<K, V, H> {
  public:
-  void set(
-      const K& key,
-      const size_t hash_value,
-      const V& value,
-      const std::function<void(V&, const V&)>& reducer);
+  template <class R>
+  void set(const K& key, const size_t hash_value, const V& value, const R& reducer);
 
   V get(const K& key, const size_t hash_value, const V& default_value) const;
 
-  void for_each(const std::function<void(const K& key, const size_t hash_value, const V& value)>&
-                    handler) const;
+  // Handler: void(const K& key, const size_t hash_value, const V& value).
+  template <class F>
+  void for_each(const F& handler) const;
 
   using HashBase<K, V, H>::max_load_factor;
 
@@ -50,11 +48,9 @@ class HashMap : public HashBase<K, V, H> {
 };
 
 template <class K, class V, class H>
+template <class R>
 void HashMap<K, V, H>::set(
-    const K& key,
-    const size_t hash_value,
-    const V& value,
-    const std::function<void(V&, const V&)>& reducer) {
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
   size_t bucket_id = hash_value % n_buckets;
   size_t n_probes = 0;
   while (n_probes < n_buckets) {
@@ -94,9 +90,8 @@ V HashMap<K, V, H>::get(const K& key, const size_t hash_value, const V& default_
 }
 
 template <class K, class V, class H>
-void HashMap<K, V, H>::for_each(
-    const std::function<void(const K& key, const size_t hash_value, const V& value)>& handler)
-    const {
+template <class F>
+void HashMap<K, V, H>::for_each(const F& handler) const {
   if (n_keys == 0) return;
   for (size_t i = 0; i < n_buckets; i++) {
     if (buckets.at(i).filled) {
@@ -0,0 +1,123 @@
+#ifndef BLAZE_INTERNAL_HASH_HOT_KEY_CACHE_H_
+#define BLAZE_INTERNAL_HASH_HOT_KEY_CACHE_H_
+
+#include <cstdint>
+
+#include "../../reducer.h"
+#include "hash_map.h"
+#include "hash_set.h"
+
+namespace blaze {
+namespace internal {
+namespace hash {
+
+// Detects heavy hitters among the keys one thread emits and reduces their values locally.
+// Every SAMPLE_INTERVAL-th key is sampled. After N_SAMPLES_PER_ROUND samples, keys that make up at
+// least min_hot_fraction of the samples become hot. Hot keys stay hot until the cache is cleared.
+template <class K, class V, class H = std::hash<K>>
+class HotKeyCache {
+ public:
+  constexpr static size_t SAMPLE_INTERVAL = 16;
+
+  constexpr static size_t N_SAMPLES_PER_ROUND = 1 << 12;
+
+  constexpr static size_t MAX_N_HOT_KEYS = 1 << 10;
+
+  HotKeyCache(const double min_hot_fraction = 0.01);
+
+  // Returns whether the key is hot, in which case the value is reduced into the cache.
+  template <class R>
+  bool async_set(const K& key, const size_t hash_value, const V& value, const R& reducer);
+
+  // Handler: void(const K& key, const size_t hash_value, const V& value).
+  // Passes out the reduced values of the hot keys and clears them.
+  template <class F>
+  void flush(const F& handler);
+
+  size_t get_n_hot_keys() const { return hot_keys.get_n_keys(); }
+
+  void clear();
+
+ private:
+  double min_hot_fraction;
+
+  size_t n_calls;
+
+  size_t n_samples;
+
+  // One bit per hot key hash, so that most cold keys skip the probe into hot_keys.
+  uint64_t hot_hash_bits;
+
+  HashMap<K, size_t, H> sample_counts;
+
+  HashSet<K, H> hot_keys;
+
+  HashMap<K, V, H> hot_values;
+
+  void sample(const K& key, const size_t hash_value);
+
+  static uint64_t get_hash_bit(const size_t hash_value) {
+    return 1ULL << ((hash_value * 0x9E3779B97F4A7C15ULL) >> 58);
+  }
+};
+
+template <class K, class V, class H>
+HotKeyCache<K, V, H>::HotKeyCache(const double min_hot_fraction)
+    : min_hot_fraction(min_hot_fraction) {
+  n_calls = 0;
+  n_samples = 0;
+  hot_hash_bits = 0;
+}
+
+template <class K, class V, class H>
+template <class R>
+bool HotKeyCache<K, V, H>::async_set(
+    const K& key, const size_t hash_value, const V& value, const R& reducer) {
+  if ((hot_hash_bits & get_hash_bit(hash_value)) != 0 && hot_keys.has(key, hash_value)) {
+    hot_values.set(key, hash_value, value, reducer);
+    return true;
+  }
+  n_calls++;
+  if (n_calls % SAMPLE_INTERVAL == 0) sample(key, hash_value);
+  return false;
+}
+
+template <class K, class V, class H>
+void HotKeyCache<K, V, H>::sample(const K& key, const size_t hash_value) {
+  sample_counts.set(key, hash_value, 1, Reducer<size_t>::sum);
+  n_samples++;
+  if (n_samples < N_SAMPLES_PER_ROUND) return;
+  const size_t min_count = static_cast<size_t>(min_hot_fraction * n_samples) + 1;
+  const auto& handler = [&](
+      const K& sampled_key, const size_t sampled_hash_value, const size_t count) {
+    if (count < min_count || hot_keys.get_n_keys() >= MAX_N_HOT_KEYS) return;
+    hot_keys.set(sampled_key, sampled_hash_value);
+    hot_hash_bits |= get_hash_bit(sampled_hash_value);
+  };
+  sample_counts.for_each(handler);
+  sample_counts.clear();
+  n_samples = 0;
+}
+
+template <class K, class V, class H>
+template <class F>
+void HotKeyCache<K, V, H>::flush(const F& handler) {
+  hot_values.for_each(handler);
+  hot_values.clear();
+}
+
+template <class K, class V, class H>
+void HotKeyCache<K, V, H>::clear() {
+  n_calls = 0;
+  n_samples = 0;
+  hot_hash_bits = 0;
+  sample_counts.clear();
+  hot_keys.clear();
+  hot_values.clear();
+}
+
+}  // namespace hash
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -2,30 +2,58 @@
 #define BLAZE_INTERNAL_MAPREDUCE_UTIL_H_
 
 #include <mpi.h>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include "../reducer.h"
+#include "mpi_type.h"
+#include "reducer_registry.h"
 
 namespace blaze {
 namespace internal {
+
+// Wraps a reducer function into its own type so that calls to it can be inlined.
+template <class V, void (*F)(V&, const V&)>
+class ReducerFunctor {
+ public:
+  void operator()(V& t1, const V& t2) const { F(t1, t2); }
+};
+
+// Excludes reducer names such as "sum" from the overloads that take reducer functions.
+template <class R>
+using EnableIfReducerFunc =
+    typename std::enable_if<!std::is_convertible<R, std::string>::value>::type;
+
 class MapreduceUtil {
  public:
-  template <class V>
-  static std::function<void(V&, const V&)> get_reducer_func(const std::string& reducer) {
+  // Calls handler with the inlinable functor of the named reducer.
+  template <class V, class F>
+  static void visit_reducer_func(const std::string& reducer, const F& handler) {
     if (reducer == "sum") {
-      return Reducer<V>::sum;
+      visit_sum<V>(handler, HasSum<V>());
     } else if (reducer == "prod") {
-      return Reducer<V>::prod;
+      visit_prod<V>(handler, HasProd<V>());
     } else if (reducer == "max") {
-      return Reducer<V>::max;
+      visit_max<V>(handler, HasOrder<V>());
     } else if (reducer == "min") {
-      return Reducer<V>::min;
+      visit_min<V>(handler, HasOrder<V>());
     } else if (reducer == "overwrite") {
-      return Reducer<V>::overwrite;
+      handler(ReducerFunctor<V, Reducer<V>::overwrite>());
     } else if (reducer == "keep") {
-      return Reducer<V>::keep;
+      handler(ReducerFunctor<V, Reducer<V>::keep>());
+    } else {
+      handler(ReducerRegistry<V>::get_func(reducer));
     }
+  }
 
-    throw std::invalid_argument("invalid reducer: ");
+  template <class V>
+  static std::function<void(V&, const V&)> get_reducer_func(const std::string& reducer) {
+    std::function<void(V&, const V&)> reducer_func;
+    visit_reducer_func<V>(reducer, [&](const auto& func) { reducer_func = func; });
+    return reducer_func;
   }
 
   static MPI_Op get_mpi_op(const std::string& reducer) {
@@ -41,6 +69,203 @@ class MapreduceUtil {
 
     throw std::invalid_argument("invalid reducer");
   }
+
+  // Finds the op and datatype to reduce values of V with in MPI reductions.
+  // Returns false if the reducer has none and needs to be applied by hand.
+  template <class V>
+  static bool get_mpi_op(const std::string& reducer, MPI_Op& op, MPI_Datatype& type) {
+    if (reducer == "sum" || reducer == "prod" || reducer == "max" || reducer == "min") {
+      return get_builtin_mpi_op<V>(reducer, op, type, HasMpiType<V>());
+    }
+    return ReducerRegistry<V>::get_mpi_op(reducer, op, type);
+  }
+
+  // Same for the builtin reducers as functions or functors and the registered reducer functions.
+  template <class V>
+  static bool get_mpi_op(
+      const std::function<void(V&, const V&)>& reducer, MPI_Op& op, MPI_Datatype& type) {
+    const char* builtin_name = get_builtin_name<V>(reducer);
+    if (builtin_name != nullptr) return get_mpi_op<V>(std::string(builtin_name), op, type);
+    const auto& func = reducer.template target<void (*)(V&, const V&)>();
+    if (func == nullptr) return false;
+    return ReducerRegistry<V>::get_mpi_op(*func, op, type);
+  }
+
+  // Same, resolved from the reducer function or functor itself instead of a std::function.
+  template <class V>
+  static bool get_mpi_op(void (*reducer)(V&, const V&), MPI_Op& op, MPI_Datatype& type) {
+    const char* builtin_name = get_builtin_name<V>(reducer);
+    if (builtin_name != nullptr) return get_mpi_op<V>(std::string(builtin_name), op, type);
+    return ReducerRegistry<V>::get_mpi_op(reducer, op, type);
+  }
+
+  template <class V, void (*F)(V&, const V&)>
+  static bool get_mpi_op(const ReducerFunctor<V, F>&, MPI_Op& op, MPI_Datatype& type) {
+    return get_mpi_op<V>(F, op, type);
+  }
+
+  // Other callables, such as lambdas, are neither builtin nor registered and have none.
+  template <class V, class R, class = EnableIfReducerFunc<R>>
+  static bool get_mpi_op(const R&, MPI_Op&, MPI_Datatype&) {
+    return false;
+  }
+
+  // Whether reductions may combine partial results in any order. Only the builtin sum, prod, max
+  // and min reducers and the reducers registered as commutative are taken as such, so that other
+  // callables keep the order of the procs.
+  template <class V>
+  static bool is_commutative(const std::function<void(V&, const V&)>& reducer) {
+    if (get_builtin_name<V>(reducer) != nullptr) return true;
+    const auto& func = reducer.template target<void (*)(V&, const V&)>();
+    if (func == nullptr) return false;
+    return ReducerRegistry<V>::is_commutative(*func);
+  }
+
+  template <class V>
+  static bool is_commutative(void (*reducer)(V&, const V&)) {
+    if (get_builtin_name<V>(reducer) != nullptr) return true;
+    return ReducerRegistry<V>::is_commutative(reducer);
+  }
+
+  template <class V, void (*F)(V&, const V&)>
+  static bool is_commutative(const ReducerFunctor<V, F>&) {
+    return is_commutative<V>(F);
+  }
+
+  template <class V, class R, class = EnableIfReducerFunc<R>>
+  static bool is_commutative(const R&) {
+    return false;
+  }
+
+ private:
+  // The builtin reducers only exist for value types with the operators they use.
+  template <class V, class = void>
+  struct HasSum : std::false_type {};
+
+  template <class V>
+  struct HasSum<V, decltype((void)(std::declval<V&>() += std::declval<const V&>()))>
+      : std::true_type {};
+
+  template <class V, class = void>
+  struct HasProd : std::false_type {};
+
+  template <class V>
+  struct HasProd<V, decltype((void)(std::declval<V&>() *= std::declval<const V&>()))>
+      : std::true_type {};
+
+  template <class V, class = void>
+  struct HasOrder : std::false_type {};
+
+  template <class V>
+  struct HasOrder<V, decltype((void)(std::declval<const V&>() < std::declval<const V&>()))>
+      : std::true_type {};
+
+  template <class V, class F>
+  static void visit_sum(const F& handler, std::true_type) {
+    handler(ReducerFunctor<V, Reducer<V>::sum>());
+  }
+
+  template <class V, class F>
+  static void visit_prod(const F& handler, std::true_type) {
+    handler(ReducerFunctor<V, Reducer<V>::prod>());
+  }
+
+  template <class V, class F>
+  static void visit_max(const F& handler, std::true_type) {
+    handler(ReducerFunctor<V, Reducer<V>::max>());
+  }
+
+  template <class V, class F>
+  static void visit_min(const F& handler, std::true_type) {
+    handler(ReducerFunctor<V, Reducer<V>::min>());
+  }
+
+  template <class V, class F>
+  static void visit_sum(const F&, std::false_type) {
+    throw std::invalid_argument("reducer sum requires operator+=");
+  }
+
+  template <class V, class F>
+  static void visit_prod(const F&, std::false_type) {
+    throw std::invalid_argument("reducer prod requires operator*=");
+  }
+
+  template <class V, class F>
+  static void visit_max(const F&, std::false_type) {
+    throw std::invalid_argument("reducer max requires operator<");
+  }
+
+  template <class V, class F>
+  static void visit_min(const F&, std::false_type) {
+    throw std::invalid_argument("reducer min requires operator<");
+  }
+
+  // Whether the reducer is F, as a function or as its functor.
+  template <class V, void (*F)(V&, const V&)>
+  static bool is_func(const std::function<void(V&, const V&)>& reducer) {
+    if (reducer.template target<ReducerFunctor<V, F>>() != nullptr) return true;
+    const auto& func = reducer.template target<void (*)(V&, const V&)>();
+    return func != nullptr && *func == F;
+  }
+
+  template <class V, void (*F)(V&, const V&)>
+  static bool is_func(void (*reducer)(V&, const V&)) {
+    return reducer == F;
+  }
+
+  // The name of the builtin sum, prod, max or min reducer, or nullptr for other reducers.
+  // Reducer: a std::function or a function pointer.
+  template <class V, class R>
+  static const char* get_builtin_name(const R& reducer) {
+    if (is_sum<V>(reducer, HasSum<V>())) return "sum";
+    if (is_prod<V>(reducer, HasProd<V>())) return "prod";
+    return get_builtin_order_name<V>(reducer, HasOrder<V>());
+  }
+
+  template <class V, class R>
+  static bool is_sum(const R& reducer, std::true_type) {
+    return is_func<V, Reducer<V>::sum>(reducer);
+  }
+
+  template <class V, class R>
+  static bool is_sum(const R&, std::false_type) {
+    return false;
+  }
+
+  template <class V, class R>
+  static bool is_prod(const R& reducer, std::true_type) {
+    return is_func<V, Reducer<V>::prod>(reducer);
+  }
+
+  template <class V, class R>
+  static bool is_prod(const R&, std::false_type) {
+    return false;
+  }
+
+  template <class V, class R>
+  static const char* get_builtin_order_name(const R& reducer, std::true_type) {
+    if (is_func<V, Reducer<V>::max>(reducer)) return "max";
+    if (is_func<V, Reducer<V>::min>(reducer)) return "min";
+    return nullptr;
+  }
+
+  template <class V, class R>
+  static const char* get_builtin_order_name(const R&, std::false_type) {
+    return nullptr;
+  }
+
+  template <class V>
+  static bool get_builtin_mpi_op(
+      const std::string& reducer, MPI_Op& op, MPI_Datatype& type, std::true_type) {
+    op = get_mpi_op(reducer);
+    type = MpiType<V>::value;
+    return true;
+  }
+
+  template <class V>
+  static bool get_builtin_mpi_op(const std::string&, MPI_Op&, MPI_Datatype&, std::false_type) {
+    return false;
+  }
 };
 
 }  // namespace internal
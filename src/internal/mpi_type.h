@@ -2,6 +2,7 @@
 #define BLAZE_INTERNAL_MPI_TYPE_H_
 
 #include <mpi.h>
+#include <type_traits>
 
 namespace blaze {
 namespace internal {
@@ -74,6 +75,13 @@ struct MpiType<long double> {
   constexpr static MPI_Datatype value = MPI_LONG_DOUBLE;
 };
 
+// Whether T has a builtin datatype, which builtin ops such as MPI_SUM operate on.
+template <class T, class = void>
+struct HasMpiType : std::false_type {};
+
+template <class T>
+struct HasMpiType<T, decltype((void)MpiType<T>::value)> : std::true_type {};
+
 };  // namespace internal
 };  // namespace blaze
 
@@ -14,6 +14,18 @@ class MpiUtil {
 
   static int get_proc_id() { return get_instance().proc_id; }
 
+  static int get_n_procs(MPI_Comm comm) {
+    int n_procs;
+    MPI_Comm_size(comm, &n_procs);
+    return n_procs;
+  }
+
+  static int get_proc_id(MPI_Comm comm) {
+    int proc_id;
+    MPI_Comm_rank(comm, &proc_id);
+    return proc_id;
+  }
+
   static std::vector<int> generate_shuffled_procs() {
     int n_procs = get_n_procs();
     std::vector<int> res(n_procs);
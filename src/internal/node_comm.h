@@ -0,0 +1,116 @@
+#ifndef BLAZE_INTERNAL_NODE_COMM_H_
+#define BLAZE_INTERNAL_NODE_COMM_H_
+
+#include <mpi.h>
+#include <algorithm>
+#include <vector>
+
+#include "mpi_util.h"
+
+namespace blaze {
+namespace internal {
+
+// Splits the procs into nodes of procs that share memory, and the lowest proc of each node, its
+// leader, into a leader comm, so that collectives cross the network between the leaders only.
+class NodeComm {
+ public:
+  // Splits by shared memory, or into blocks of ranks_per_node consecutive procs if positive.
+  explicit NodeComm(const int ranks_per_node = 0);
+
+  NodeComm(const NodeComm&) = delete;
+
+  NodeComm& operator=(const NodeComm&) = delete;
+
+  ~NodeComm();
+
+  // Split by shared memory on first use, which is collective.
+  static const NodeComm& get_instance() {
+    static NodeComm instance;
+    return instance;
+  }
+
+  MPI_Comm get_node_comm() const { return node_comm; }
+
+  // MPI_COMM_NULL on the procs that are not leaders.
+  MPI_Comm get_leader_comm() const { return leader_comm; }
+
+  int get_n_nodes() const { return n_nodes; }
+
+  bool is_leader() const { return get_node_rank() == 0; }
+
+  // The node of a proc is the rank of its leader in the leader comm.
+  int get_node_id() const { return node_ids[MpiUtil::get_proc_id()]; }
+
+  int get_node_id(const int proc_id) const { return node_ids[proc_id]; }
+
+  int get_node_rank() const { return node_ranks[MpiUtil::get_proc_id()]; }
+
+  // The rank of a proc in the node comm of its node.
+  int get_node_rank(const int proc_id) const { return node_ranks[proc_id]; }
+
+  // The procs by node, then by node rank, which is the order in which the leaders gather.
+  const std::vector<int>& get_node_ordered_proc_ids() const { return node_ordered_proc_ids; }
+
+  // Whether several nodes hold several procs, so that going through the leaders saves traffic.
+  bool is_hierarchical() const { return n_nodes > 1 && n_nodes < MpiUtil::get_n_procs(); }
+
+ private:
+  MPI_Comm node_comm;
+
+  MPI_Comm leader_comm;
+
+  int n_nodes;
+
+  std::vector<int> node_ids;
+
+  std::vector<int> node_ranks;
+
+  std::vector<int> node_ordered_proc_ids;
+};
+
+inline NodeComm::NodeComm(const int ranks_per_node) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  if (ranks_per_node > 0) {
+    MPI_Comm_split(MPI_COMM_WORLD, proc_id / ranks_per_node, proc_id, &node_comm);
+  } else {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, proc_id, MPI_INFO_NULL, &node_comm);
+  }
+  int node_rank = MpiUtil::get_proc_id(node_comm);
+  MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, proc_id, &leader_comm);
+
+  int node_id = 0;
+  n_nodes = 0;
+  if (leader_comm != MPI_COMM_NULL) {
+    node_id = MpiUtil::get_proc_id(leader_comm);
+    n_nodes = MpiUtil::get_n_procs(leader_comm);
+  }
+  MPI_Bcast(&node_id, 1, MPI_INT, 0, node_comm);
+  MPI_Bcast(&n_nodes, 1, MPI_INT, 0, node_comm);
+
+  node_ids.resize(n_procs);
+  node_ranks.resize(n_procs);
+  MPI_Allgather(&node_id, 1, MPI_INT, node_ids.data(), 1, MPI_INT, MPI_COMM_WORLD);
+  MPI_Allgather(&node_rank, 1, MPI_INT, node_ranks.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+  // Node ranks follow the proc ids, so a stable sort by node keeps them in order.
+  node_ordered_proc_ids.resize(n_procs);
+  for (int i = 0; i < n_procs; i++) node_ordered_proc_ids[i] = i;
+  std::stable_sort(node_ordered_proc_ids.begin(), node_ordered_proc_ids.end(), [&](int a, int b) {
+    return node_ids[a] < node_ids[b];
+  });
+}
+
+inline NodeComm::~NodeComm() {
+  // The instance outlives MPI_Finalize, which frees the comms anyway.
+  int is_finalized;
+  MPI_Finalized(&is_finalized);
+  if (is_finalized) return;
+  MPI_Comm_free(&node_comm);
+  if (leader_comm != MPI_COMM_NULL) MPI_Comm_free(&leader_comm);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef BLAZE_INTERNAL_NUMBER_PARSER_H_
+#define BLAZE_INTERNAL_NUMBER_PARSER_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace blaze {
+namespace internal {
+
+// Parses numbers in place like std::from_chars, without streams or their locales: an optional
+// sign and digits, and for floating point types an optional fraction and exponent.
+class NumberParser {
+ public:
+  // Parses the number at begin into value and returns its end, or begin if there is no number
+  // there or it does not fit in T.
+  template <class T>
+  static const char* parse(const char* begin, const char* end, T& value) {
+    return parse(begin, end, value, std::is_floating_point<T>());
+  }
+
+ private:
+  // Mantissa digits past this many are dropped, so that the mantissa fits in 64 bits.
+  constexpr static int MAX_MANTISSA_DIGITS = 19;
+
+  static bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+
+  static const char* parse_sign(const char* begin, const char* end, bool& is_negative) {
+    is_negative = begin < end && *begin == '-';
+    return begin < end && (*begin == '-' || *begin == '+') ? begin + 1 : begin;
+  }
+
+  template <class T>
+  static const char* parse(const char* begin, const char* end, T& value, std::false_type);
+
+  template <class T>
+  static const char* parse(const char* begin, const char* end, T& value, std::true_type);
+
+  // The largest mantissa and power of ten that T holds exactly, or 0 and -1 where T is not
+  // float or double.
+  template <class T>
+  static uint64_t get_max_exact_mantissa() {
+    const int digits = std::numeric_limits<T>::digits;
+    return digits == 24 ? static_cast<uint64_t>(1) << 24
+                        : digits == 53 ? static_cast<uint64_t>(1) << 53 : 0;
+  }
+
+  template <class T>
+  static int get_max_exact_pow10() {
+    const int digits = std::numeric_limits<T>::digits;
+    return digits == 24 ? 10 : digits == 53 ? 22 : -1;
+  }
+
+  static const double* get_pow10s() {
+    static const double pow10s[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return pow10s;
+  }
+
+  // The C library conversions are correctly rounded. They follow the C locale, which a program
+  // has unless it calls setlocale.
+  static void convert(const char* str, float& value) { value = std::strtof(str, nullptr); }
+
+  static void convert(const char* str, double& value) { value = std::strtod(str, nullptr); }
+
+  static void convert(const char* str, long double& value) { value = std::strtold(str, nullptr); }
+};
+
+template <class T>
+const char* NumberParser::parse(const char* begin, const char* end, T& value, std::false_type) {
+  using U = typename std::make_unsigned<T>::type;
+  bool is_negative;
+  const char* p = parse_sign(begin, end, is_negative);
+  if (is_negative && !std::is_signed<T>::value) return begin;
+  const U max_abs_value = is_negative ? static_cast<U>(std::numeric_limits<T>::max()) + 1
+                                      : static_cast<U>(std::numeric_limits<T>::max());
+  const char* digits_begin = p;
+  U abs_value = 0;
+  while (p < end && is_digit(*p)) {
+    const U digit = *p - '0';
+    if (abs_value > (max_abs_value - digit) / 10) return begin;
+    abs_value = abs_value * 10 + digit;
+    p++;
+  }
+  if (p == digits_begin) return begin;
+  value = is_negative ? static_cast<T>(0 - abs_value) : static_cast<T>(abs_value);
+  return p;
+}
+
+template <class T>
+const char* NumberParser::parse(const char* begin, const char* end, T& value, std::true_type) {
+  bool is_negative;
+  const char* p = parse_sign(begin, end, is_negative);
+
+  // The number is mantissa * 10^exponent, exactly unless digits were dropped.
+  uint64_t mantissa = 0;
+  int n_mantissa_digits = 0;
+  int exponent = 0;
+  bool is_exact = true;
+  bool has_digits = false;
+  bool is_fraction = false;
+  while (p < end) {
+    if (*p == '.' && !is_fraction) {
+      is_fraction = true;
+      p++;
+      continue;
+    }
+    if (!is_digit(*p)) break;
+    const int digit = *p - '0';
+    has_digits = true;
+    if (n_mantissa_digits < MAX_MANTISSA_DIGITS) {
+      mantissa = mantissa * 10 + digit;
+      if (mantissa > 0) n_mantissa_digits++;
+      if (is_fraction) exponent--;
+    } else {
+      if (!is_fraction) exponent++;
+      if (digit != 0) is_exact = false;
+    }
+    p++;
+  }
+  if (!has_digits) return begin;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    bool is_exponent_negative;
+    const char* q = parse_sign(p + 1, end, is_exponent_negative);
+    const char* exponent_digits_begin = q;
+    int exponent_value = 0;
+    while (q < end && is_digit(*q)) {
+      if (exponent_value < 100000) exponent_value = exponent_value * 10 + (*q - '0');
+      q++;
+    }
+    if (q > exponent_digits_begin) {
+      exponent += is_exponent_negative ? -exponent_value : exponent_value;
+      p = q;
+    }
+  }
+
+  // A mantissa and a power of ten that T holds exactly give a correctly rounded quotient or
+  // product. Everything else goes to the C library.
+  const int max_exact_pow10 = get_max_exact_pow10<T>();
+  if (is_exact && mantissa <= get_max_exact_mantissa<T>() && exponent >= -max_exact_pow10 &&
+      exponent <= max_exact_pow10) {
+    const T pow10 = static_cast<T>(get_pow10s()[exponent < 0 ? -exponent : exponent]);
+    T abs_value = static_cast<T>(mantissa);
+    abs_value = exponent < 0 ? abs_value / pow10 : abs_value * pow10;
+    value = is_negative ? -abs_value : abs_value;
+    return p;
+  }
+  const std::string token(begin, p);
+  convert(token.c_str(), value);
+  return p;
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
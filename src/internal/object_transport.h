@@ -0,0 +1,294 @@
+#ifndef BLAZE_INTERNAL_OBJECT_TRANSPORT_H_
+#define BLAZE_INTERNAL_OBJECT_TRANSPORT_H_
+
+#include <mpi.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "node_comm.h"
+#include "transport.h"
+
+namespace blaze {
+namespace internal {
+
+// The bytes of an object that moves between procs as is, without serializing. Trivially copyable
+// objects are such a block of a fixed size.
+template <class T>
+struct PodLayout {
+  constexpr static bool IS_POD = std::is_trivially_copyable<T>::value;
+
+  constexpr static bool IS_FIXED_SIZE = true;
+
+  static char* get_data(T& t) { return reinterpret_cast<char*>(&t); }
+
+  static const char* get_data(const T& t) { return reinterpret_cast<const char*>(&t); }
+
+  static size_t get_size(const T&) { return sizeof(T); }
+
+  static void resize(T&, const size_t) {}
+};
+
+// Vectors of trivially copyable values are such a block of a variable size.
+template <class V, class A>
+struct PodLayout<std::vector<V, A>> {
+  constexpr static bool IS_POD =
+      std::is_trivially_copyable<V>::value && !std::is_same<V, bool>::value;
+
+  constexpr static bool IS_FIXED_SIZE = false;
+
+  static char* get_data(std::vector<V, A>& t) { return reinterpret_cast<char*>(t.data()); }
+
+  static const char* get_data(const std::vector<V, A>& t) {
+    return reinterpret_cast<const char*>(t.data());
+  }
+
+  static size_t get_size(const std::vector<V, A>& t) { return t.size() * sizeof(V); }
+
+  static void resize(std::vector<V, A>& t, const size_t size) { t.resize(size / sizeof(V)); }
+};
+
+// Moves objects of any type between procs like Transport moves msgs. Objects with a PodLayout go
+// straight from their storage into the storage of the destination objects. All others go through
+// hps and a serialized msg.
+class ObjectTransport {
+ public:
+  template <class T>
+  static void send(const T& t, const int dest_proc_id, MPI_Comm comm = MPI_COMM_WORLD) {
+    send(t, dest_proc_id, comm, IsPod<T>());
+  }
+
+  template <class T>
+  static void recv(T& t, const int src_proc_id, MPI_Comm comm = MPI_COMM_WORLD) {
+    recv(t, src_proc_id, comm, IsPod<T>());
+  }
+
+  // Sends send_t to dest_proc_id while receiving recv_t from src_proc_id.
+  template <class T>
+  static void send_recv(
+      const T& send_t,
+      const int dest_proc_id,
+      T& recv_t,
+      const int src_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD) {
+    send_recv(send_t, dest_proc_id, recv_t, src_proc_id, comm, IsPod<T>());
+  }
+
+  template <class T>
+  static void broadcast(T& t, const int root, MPI_Comm comm = MPI_COMM_WORLD) {
+    broadcast(t, root, comm, IsPod<T>());
+  }
+
+  // Broadcasts across the leaders and within each node.
+  template <class T>
+  static void broadcast(T& t, const int root, const NodeComm& nodes) {
+    broadcast(t, root, nodes, IsPod<T>());
+  }
+
+  // Gathers the object of proc i into res[i] on every proc.
+  template <class T>
+  static void allgather(const T& t, std::vector<T>& res, const NodeComm& nodes) {
+    allgather(t, res, nodes, IsPod<T>());
+  }
+
+ private:
+  template <class T>
+  using IsPod = std::integral_constant<bool, PodLayout<T>::IS_POD>;
+
+  template <class T>
+  static void send(const T& t, const int dest_proc_id, MPI_Comm comm, std::true_type);
+
+  template <class T>
+  static void send(const T& t, const int dest_proc_id, MPI_Comm comm, std::false_type);
+
+  template <class T>
+  static void recv(T& t, const int src_proc_id, MPI_Comm comm, std::true_type);
+
+  template <class T>
+  static void recv(T& t, const int src_proc_id, MPI_Comm comm, std::false_type);
+
+  template <class T>
+  static void send_recv(
+      const T& send_t,
+      const int dest_proc_id,
+      T& recv_t,
+      const int src_proc_id,
+      MPI_Comm comm,
+      std::true_type);
+
+  template <class T>
+  static void send_recv(
+      const T& send_t,
+      const int dest_proc_id,
+      T& recv_t,
+      const int src_proc_id,
+      MPI_Comm comm,
+      std::false_type);
+
+  // The comm whose ranks name the procs.
+  static MPI_Comm get_comm(MPI_Comm comm) { return comm; }
+
+  static MPI_Comm get_comm(const NodeComm&) { return MPI_COMM_WORLD; }
+
+  template <class T, class C>
+  static void broadcast(T& t, const int root, const C& comm_or_nodes, std::true_type);
+
+  template <class T, class C>
+  static void broadcast(T& t, const int root, const C& comm_or_nodes, std::false_type);
+
+  template <class T>
+  static void allgather(const T& t, std::vector<T>& res, const NodeComm& nodes, std::true_type);
+
+  template <class T>
+  static void allgather(const T& t, std::vector<T>& res, const NodeComm& nodes, std::false_type);
+};
+
+template <class T>
+void ObjectTransport::send(const T& t, const int dest_proc_id, MPI_Comm comm, std::true_type) {
+  using Layout = PodLayout<T>;
+  size_t size = Layout::get_size(t);
+  if (!Layout::IS_FIXED_SIZE) {
+    MPI_Send(&size, 1, MpiType<size_t>::value, dest_proc_id, 0, comm);
+  }
+  Transport::send(Layout::get_data(t), size, dest_proc_id, comm);
+}
+
+template <class T>
+void ObjectTransport::send(const T& t, const int dest_proc_id, MPI_Comm comm, std::false_type) {
+  Transport::send(hps::to_string(t), dest_proc_id, comm);
+}
+
+template <class T>
+void ObjectTransport::recv(T& t, const int src_proc_id, MPI_Comm comm, std::true_type) {
+  using Layout = PodLayout<T>;
+  size_t size = Layout::get_size(t);
+  if (!Layout::IS_FIXED_SIZE) {
+    MPI_Recv(&size, 1, MpiType<size_t>::value, src_proc_id, 0, comm, MPI_STATUS_IGNORE);
+    Layout::resize(t, size);
+  }
+  Transport::recv(Layout::get_data(t), size, src_proc_id, comm);
+}
+
+template <class T>
+void ObjectTransport::recv(T& t, const int src_proc_id, MPI_Comm comm, std::false_type) {
+  std::string msg;
+  Transport::recv(msg, src_proc_id, comm);
+  hps::from_string(msg, t);
+}
+
+template <class T>
+void ObjectTransport::send_recv(
+    const T& send_t,
+    const int dest_proc_id,
+    T& recv_t,
+    const int src_proc_id,
+    MPI_Comm comm,
+    std::true_type) {
+  using Layout = PodLayout<T>;
+  size_t send_size = Layout::get_size(send_t);
+  size_t recv_size = Layout::get_size(recv_t);
+  if (!Layout::IS_FIXED_SIZE) {
+    MPI_Request size_reqs[2];
+    const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+    MPI_Irecv(&recv_size, 1, size_t_mpi, src_proc_id, 0, comm, &size_reqs[0]);
+    MPI_Isend(&send_size, 1, size_t_mpi, dest_proc_id, 0, comm, &size_reqs[1]);
+    MPI_Waitall(2, size_reqs, MPI_STATUSES_IGNORE);
+    Layout::resize(recv_t, recv_size);
+  }
+  std::vector<MPI_Request> reqs;
+  Transport::irecv(
+      Layout::get_data(recv_t), recv_size, src_proc_id, comm, Transport::MAX_CHUNK_SIZE, reqs);
+  Transport::isend(
+      Layout::get_data(send_t), send_size, dest_proc_id, comm, Transport::MAX_CHUNK_SIZE, reqs);
+  MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+}
+
+template <class T>
+void ObjectTransport::send_recv(
+    const T& send_t,
+    const int dest_proc_id,
+    T& recv_t,
+    const int src_proc_id,
+    MPI_Comm comm,
+    std::false_type) {
+  std::string recv_msg;
+  Transport::send_recv(hps::to_string(send_t), dest_proc_id, recv_msg, src_proc_id, comm);
+  hps::from_string(recv_msg, recv_t);
+}
+
+template <class T, class C>
+void ObjectTransport::broadcast(T& t, const int root, const C& comm_or_nodes, std::true_type) {
+  using Layout = PodLayout<T>;
+  size_t size = Layout::get_size(t);
+  if (!Layout::IS_FIXED_SIZE) {
+    MPI_Bcast(&size, 1, MpiType<size_t>::value, root, get_comm(comm_or_nodes));
+    Layout::resize(t, size);
+  }
+  Transport::broadcast(Layout::get_data(t), size, root, comm_or_nodes);
+}
+
+template <class T, class C>
+void ObjectTransport::broadcast(T& t, const int root, const C& comm_or_nodes, std::false_type) {
+  std::string msg;
+  const bool is_root = MpiUtil::get_proc_id(get_comm(comm_or_nodes)) == root;
+  if (is_root) hps::to_string(t, msg);
+  Transport::broadcast(msg, root, comm_or_nodes);
+  if (!is_root) hps::from_string(msg, t);
+}
+
+template <class T>
+void ObjectTransport::allgather(
+    const T& t, std::vector<T>& res, const NodeComm& nodes, std::true_type) {
+  using Layout = PodLayout<T>;
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  res.resize(n_procs);
+  const size_t size = Layout::get_size(t);
+  if (Layout::IS_FIXED_SIZE) {
+    // Fixed size objects lie back to back in res already.
+    MPI_Allgather(Layout::get_data(t), size, MPI_CHAR, res.data(), size, MPI_CHAR, MPI_COMM_WORLD);
+    return;
+  }
+
+  // Variable size objects are gathered back to back in one go, as msgs are, and split by size.
+  std::string recv_buf;
+  std::vector<size_t> displs;
+  Transport::allgather(Layout::get_data(t), size, recv_buf, displs, nodes);
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) {
+      res[i] = t;
+      continue;
+    }
+    Layout::resize(res[i], displs[i + 1] - displs[i]);
+    std::copy(
+        recv_buf.begin() + displs[i], recv_buf.begin() + displs[i + 1], Layout::get_data(res[i]));
+  }
+}
+
+template <class T>
+void ObjectTransport::allgather(
+    const T& t, std::vector<T>& res, const NodeComm& nodes, std::false_type) {
+  const int n_procs = MpiUtil::get_n_procs();
+  const int proc_id = MpiUtil::get_proc_id();
+  res.resize(n_procs);
+  const std::string msg = hps::to_string(t);
+  std::string recv_buf;
+  std::vector<size_t> displs;
+  Transport::allgather(msg, recv_buf, displs, nodes);
+  for (int i = 0; i < n_procs; i++) {
+    if (i == proc_id) {
+      res[i] = t;
+    } else {
+      hps::from_char_array(recv_buf.data() + displs[i], res[i]);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef BLAZE_INTERNAL_OUTPUT_SINK_H_
+#define BLAZE_INTERNAL_OUTPUT_SINK_H_
+
+#include <mpi.h>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "../dist_hash_map.h"
+#include "../dist_vector.h"
+#include "../mapreduce_output.h"
+#include "exchange_util.h"
+#include "mapreduce_util.h"
+#include "mpi_util.h"
+#include "node_comm.h"
+#include "pipeline_stage.h"
+#include "transport.h"
+#include "vector_mapreduce_wrapper.h"
+
+namespace blaze {
+namespace internal {
+
+// The value type of a destination.
+template <class D>
+class OutputValue;
+
+template <class VD>
+class OutputValue<std::vector<VD>> {
+ public:
+  using Type = VD;
+};
+
+template <class VD>
+class OutputValue<DistVector<VD>> {
+ public:
+  using Type = VD;
+};
+
+template <class KD, class VD, class HD>
+class OutputValue<DistHashMap<KD, VD, HD>> {
+ public:
+  using Type = VD;
+};
+
+// The values of this proc of a local destination, which reduce with the MPI op and datatype.
+class MpiOpValues {
+ public:
+  MPI_Op op;
+
+  MPI_Datatype type;
+
+  void* data;
+
+  size_t count;
+};
+
+// Emits into the destination of one output, with a reducer callable, and takes part in the
+// combined sync. Distributed destinations take part in the exchange through get_send_bufs and
+// merge_recv_bufs. Local destinations too small for sparse accumulation whose reducer has an MPI op
+// hand their values to the reduction shared by the outputs of the same op through
+// get_mpi_op_values, and all local destinations finish in reduce.
+template <class R, class D>
+class OutputSink;
+
+template <class R, class VD>
+class OutputSink<R, std::vector<VD>> {
+ public:
+  constexpr static bool IS_DISTRIBUTED = false;
+
+  OutputSink(const MapreduceOutput<R, std::vector<VD>>& output)
+      : reducer(output.reducer), dest_wrapper(output.dest) {
+    op = MPI_OP_NULL;
+    type = MPI_DATATYPE_NULL;
+    MapreduceUtil::get_mpi_op<VD>(reducer, op, type);
+    shares_mpi_op = op != MPI_OP_NULL && !dest_wrapper.allows_sparse();
+  }
+
+  auto get_emit() {
+    return [this](const size_t key, const VD& value) {
+      dest_wrapper.async_set(key, value, reducer);
+    };
+  }
+
+  void get_send_bufs(std::vector<std::string>& send_bufs) {
+    send_bufs.assign(MpiUtil::get_n_procs(), std::string());
+  }
+
+  void merge_recv_bufs(std::vector<std::string>&) {}
+
+  bool is_co_partitioned() const { return true; }
+
+  void get_mpi_op_values(std::vector<MpiOpValues>& values) {
+    if (!shares_mpi_op) return;
+    dest_wrapper.sync_local(reducer);
+    auto& res_local = dest_wrapper.get_res_local();
+    values.push_back({op, type, res_local.data(), res_local.size()});
+  }
+
+  // Collective. Reduces the values reduced across procs into the destination, or reduces on its
+  // own over the sparse, ring, node-aware or MPI op path, as the single output mapreduce does.
+  void reduce() {
+    if (shares_mpi_op) {
+      dest_wrapper.reduce_into_target(reducer);
+    } else {
+      dest_wrapper.sync(reducer);
+    }
+  }
+
+ private:
+  R reducer;
+
+  VectorMapreduceWrapper<VD> dest_wrapper;
+
+  MPI_Op op;
+
+  MPI_Datatype type;
+
+  bool shares_mpi_op;
+};
+
+template <class R, class VD>
+class OutputSink<R, DistVector<VD>> {
+ public:
+  constexpr static bool IS_DISTRIBUTED = true;
+
+  OutputSink(const MapreduceOutput<R, DistVector<VD>>& output)
+      : reducer(output.reducer), dest(output.dest) {}
+
+  auto get_emit() {
+    return [this](const size_t key, const VD& value) { dest.async_set(key, value, reducer); };
+  }
+
+  void get_send_bufs(std::vector<std::string>& send_bufs) {
+    dest.get_send_bufs(reducer, send_bufs);
+  }
+
+  void merge_recv_bufs(std::vector<std::string>& recv_bufs) {
+    dest.merge_recv_bufs(reducer, recv_bufs);
+  }
+
+  bool is_co_partitioned() const { return dest.is_co_partitioned(); }
+
+  void get_mpi_op_values(std::vector<MpiOpValues>&) {}
+
+  void reduce() {}
+
+ private:
+  R reducer;
+
+  DistVector<VD>& dest;
+};
+
+template <class R, class KD, class VD, class HD>
+class OutputSink<R, DistHashMap<KD, VD, HD>> {
+ public:
+  constexpr static bool IS_DISTRIBUTED = true;
+
+  OutputSink(const MapreduceOutput<R, DistHashMap<KD, VD, HD>>& output)
+      : reducer(output.reducer), dest(output.dest) {}
+
+  auto get_emit() {
+    return [this](const KD& key, const VD& value) { dest.async_set(key, value, reducer); };
+  }
+
+  void get_send_bufs(std::vector<std::string>& send_bufs) {
+    dest.get_send_bufs(reducer, send_bufs);
+  }
+
+  void merge_recv_bufs(std::vector<std::string>& recv_bufs) {
+    dest.merge_recv_bufs(reducer, recv_bufs);
+  }
+
+  bool is_co_partitioned() const { return dest.is_co_partitioned(); }
+
+  void get_mpi_op_values(std::vector<MpiOpValues>&) {}
+
+  void reduce() {}
+
+ private:
+  R reducer;
+
+  DistHashMap<KD, VD, HD>& dest;
+};
+
+class OutputSinkUtil {
+ public:
+  // Resolves the reducer names of the outputs into their inlinable functors one output at a time,
+  // as the single output mapreduce does, and then runs the mapreduce over sinks of the outputs.
+  template <class S, class M, class... O>
+  static void mapreduce(S& source, const M& mapper, const O&... outputs) {
+    resolve(source, mapper, std::tuple<>(), outputs...);
+  }
+
+ private:
+  template <class S, class M, class... O, class R, class D, class... P>
+  static void resolve(
+      S& source,
+      const M& mapper,
+      const std::tuple<O...>& resolved,
+      const MapreduceOutput<R, D>& output,
+      const P&... pending) {
+    resolve(source, mapper, std::tuple_cat(resolved, std::make_tuple(output)), pending...);
+  }
+
+  template <class S, class M, class... O, class D, class... P>
+  static void resolve(
+      S& source,
+      const M& mapper,
+      const std::tuple<O...>& resolved,
+      const MapreduceOutput<std::string, D>& output,
+      const P&... pending) {
+    using VD = typename OutputValue<D>::Type;
+    MapreduceUtil::visit_reducer_func<VD>(output.reducer, [&](const auto& reducer) {
+      using R = typename std::decay<decltype(reducer)>::type;
+      const auto& resolved_outputs =
+          std::tuple_cat(resolved, std::make_tuple(MapreduceOutput<R, D>(reducer, output.dest)));
+      resolve(source, mapper, resolved_outputs, pending...);
+    });
+  }
+
+  template <class S, class M, class... R, class... D>
+  static void resolve(
+      S& source, const M& mapper, const std::tuple<MapreduceOutput<R, D>...>& outputs) {
+    run(source, mapper, outputs, std::index_sequence_for<D...>());
+  }
+
+  template <class S, class M, class... R, class... D, size_t... I>
+  static void run(
+      S& source,
+      const M& mapper,
+      const std::tuple<MapreduceOutput<R, D>...>& outputs,
+      std::index_sequence<I...>) {
+    std::tuple<OutputSink<R, D>...> sinks(std::get<I>(outputs)...);
+    mapreduce_sinks(source, mapper, sinks, std::index_sequence<I...>());
+  }
+
+  // Runs the mapper once per source record with one emit per sink, then syncs all sinks.
+  template <class S, class M, class T, size_t... I>
+  static void mapreduce_sinks(S& source, const M& mapper, T& sinks, std::index_sequence<I...>) {
+    const auto& emits = std::make_tuple(std::get<I>(sinks).get_emit()...);
+    const auto& handler = [&](const auto&... record) {
+      mapper(record..., std::get<I>(emits)...);
+    };
+    PipelineSource<S>::for_each(source, handler);
+    sync(sinks, std::index_sequence<I...>());
+  }
+
+  template <class T, size_t... I>
+  static void sync(T& sinks, std::index_sequence<I...>) {
+    const int n_procs = MpiUtil::get_n_procs();
+    const int proc_id = MpiUtil::get_proc_id();
+    const int n_sinks = sizeof...(I);
+    const bool is_distributed[] = {std::tuple_element<I, T>::type::IS_DISTRIBUTED...};
+    const bool is_co_partitioned[] = {std::get<I>(sinks).is_co_partitioned()...};
+    bool co_partitioned = true;
+    bool has_distributed = false;
+    bool has_local = false;
+    for (int j = 0; j < n_sinks; j++) {
+      co_partitioned &= is_co_partitioned[j];
+      if (is_distributed[j]) {
+        has_distributed = true;
+      } else {
+        has_local = true;
+      }
+    }
+
+    // Distributed destinations share one exchange with one message per proc.
+    if (has_distributed) {
+      std::vector<std::vector<std::string>> sink_bufs(n_sinks);
+      const int get_send_bufs[] = {(std::get<I>(sinks).get_send_bufs(sink_bufs[I]), 0)...};
+      (void)get_send_bufs;
+      std::vector<std::string> send_bufs(n_procs);
+      std::vector<std::string> recv_bufs;
+      std::vector<std::string> parts(n_sinks);
+      for (int i = 0; i < n_procs; i++) {
+        if (i == proc_id) continue;
+        bool has_parts = false;
+        for (int j = 0; j < n_sinks; j++) {
+          parts[j].swap(sink_bufs[j][i]);
+          has_parts |= !parts[j].empty();
+        }
+        if (has_parts) hps::to_string(parts, send_bufs[i]);
+        for (auto& part : parts) part.clear();
+      }
+      ExchangeUtil::all_to_all_if_any(send_bufs, recv_bufs, co_partitioned);
+      send_bufs.clear();
+      for (int i = 0; i < n_procs; i++) {
+        if (i == proc_id || recv_bufs[i].empty()) continue;
+        hps::from_string(recv_bufs[i], parts);
+        recv_bufs[i].clear();
+        for (int j = 0; j < n_sinks; j++) sink_bufs[j][i].swap(parts[j]);
+      }
+      const int merge_recv_bufs[] = {(std::get<I>(sinks).merge_recv_bufs(sink_bufs[I]), 0)...};
+      (void)merge_recv_bufs;
+    }
+
+    // Local destinations share one reduction per MPI op and datatype where they can, and the
+    // others reduce one by one.
+    if (has_local) {
+      std::vector<MpiOpValues> values;
+      const int get_mpi_op_values[] = {(std::get<I>(sinks).get_mpi_op_values(values), 0)...};
+      (void)get_mpi_op_values;
+      reduce(values);
+      const int reduce_sinks[] = {(std::get<I>(sinks).reduce(), 0)...};
+      (void)reduce_sinks;
+    }
+  }
+
+  // Collective. Packs the values of the same op and datatype back to back into one buffer,
+  // reduces it on all procs, and unpacks the results in place.
+  static void reduce(std::vector<MpiOpValues>& values) {
+    const size_t n_values = values.size();
+    if (n_values == 0) return;
+    const NodeComm& nodes = NodeComm::get_instance();
+    std::vector<bool> is_reduced(n_values, false);
+    std::vector<size_t> group;
+    std::vector<char> send_buf;
+    std::vector<char> recv_buf;
+    for (size_t i = 0; i < n_values; i++) {
+      if (is_reduced[i]) continue;
+      const MPI_Op op = values[i].op;
+      const MPI_Datatype type = values[i].type;
+      int type_size;
+      MPI_Type_size(type, &type_size);
+      group.clear();
+      size_t count = 0;
+      for (size_t j = i; j < n_values; j++) {
+        if (is_reduced[j] || values[j].op != op || values[j].type != type) continue;
+        group.push_back(j);
+        is_reduced[j] = true;
+        count += values[j].count;
+      }
+      send_buf.resize(count * type_size);
+      recv_buf.resize(count * type_size);
+      size_t pos = 0;
+      for (const size_t j : group) {
+        const size_t size = values[j].count * type_size;
+        std::memcpy(send_buf.data() + pos, values[j].data, size);
+        pos += size;
+      }
+      Transport::reduce(send_buf.data(), recv_buf.data(), count, type, op, nodes);
+      pos = 0;
+      for (const size_t j : group) {
+        const size_t size = values[j].count * type_size;
+        std::memcpy(values[j].data, recv_buf.data() + pos, size);
+        pos += size;
+      }
+    }
+  }
+};
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef BLAZE_INTERNAL_PIPELINE_STAGE_H_
+#define BLAZE_INTERNAL_PIPELINE_STAGE_H_
+
+#include <functional>
+
+#include "../dist_hash_map.h"
+#include "../dist_range.h"
+#include "../dist_text_file.h"
+#include "../dist_text_stream.h"
+#include "../dist_vector.h"
+
+namespace blaze {
+namespace internal {
+
+// A stage is called as stage(emit, record...) and passes each of its output records to emit.
+// Chained stages are nested into one another, so the whole chain runs in the same loop.
+
+class IdentityStage {
+ public:
+  template <class E, class... T>
+  void operator()(const E& emit, const T&... record) const {
+    emit(record...);
+  }
+};
+
+template <class F, class M>
+class MapStage {
+ public:
+  MapStage(const F& stage, const M& mapper) : stage(stage), mapper(mapper) {}
+
+  template <class E, class... T>
+  void operator()(const E& emit, const T&... record) const {
+    stage([&](const auto&... mid_record) { mapper(mid_record..., emit); }, record...);
+  }
+
+ private:
+  F stage;
+
+  M mapper;
+};
+
+template <class F, class P>
+class FilterStage {
+ public:
+  FilterStage(const F& stage, const P& predicate) : stage(stage), predicate(predicate) {}
+
+  template <class E, class... T>
+  void operator()(const E& emit, const T&... record) const {
+    stage(
+        [&](const auto&... mid_record) {
+          if (predicate(mid_record...)) emit(mid_record...);
+        },
+        record...);
+  }
+
+ private:
+  F stage;
+
+  P predicate;
+};
+
+// Adapts each source container to records and to the mapper signature of mapreduce.
+template <class S>
+class PipelineSource;
+
+template <class T>
+class PipelineSource<DistRange<T>> {
+ public:
+  // Record: (const T value).
+  template <class F>
+  static void for_each(DistRange<T>& source, const F& handler) {
+    source.for_each([&](const T value) { handler(value); });
+  }
+
+  template <class F>
+  static auto get_mapper(const F& stage) {
+    return [stage](const T value, const auto& emit) { stage(emit, value); };
+  }
+};
+
+template <class V>
+class PipelineSource<DistVector<V>> {
+ public:
+  // Record: (const size_t key, const V& value).
+  template <class F>
+  static void for_each(DistVector<V>& source, const F& handler) {
+    source.for_each([&](const size_t key, const V& value) { handler(key, value); });
+  }
+
+  template <class F>
+  static auto get_mapper(const F& stage) {
+    return [stage](const size_t key, const V& value, const auto& emit) { stage(emit, key, value); };
+  }
+};
+
+template <>
+class PipelineSource<DistTextFile> {
+ public:
+  // Record: (const size_t line_id, const StringView& line).
+  template <class F>
+  static void for_each(DistTextFile& source, const F& handler) {
+    source.for_each([&](const size_t line_id, const StringView& line) { handler(line_id, line); });
+  }
+
+  template <class F>
+  static auto get_mapper(const F& stage) {
+    return [stage](const size_t line_id, const StringView& line, const auto& emit) {
+      stage(emit, line_id, line);
+    };
+  }
+};
+
+template <>
+class PipelineSource<DistTextStream> {
+ public:
+  // Record: (const StringView& line).
+  template <class F>
+  static void for_each(DistTextStream& source, const F& handler) {
+    source.for_each([&](const StringView& line) { handler(line); });
+  }
+
+  template <class F>
+  static auto get_mapper(const F& stage) {
+    return [stage](const StringView& line, const auto& emit) { stage(emit, line); };
+  }
+};
+
+template <class K, class V, class H>
+class PipelineSource<DistHashMap<K, V, H>> {
+ public:
+  // Record: (const K& key, const V& value).
+  template <class F>
+  static void for_each(DistHashMap<K, V, H>& source, const F& handler) {
+    source.for_each([&](const K& key, const size_t, const V& value) { handler(key, value); });
+  }
+
+  template <class F>
+  static auto get_mapper(const F& stage) {
+    return [stage](const K& key, const V& value, const auto& emit) { stage(emit, key, value); };
+  }
+};
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
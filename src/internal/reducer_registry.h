@@ -0,0 +1,142 @@
+#ifndef BLAZE_INTERNAL_REDUCER_REGISTRY_H_
+#define BLAZE_INTERNAL_REDUCER_REGISTRY_H_
+
+#include <mpi.h>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "../reducer.h"
+
+namespace blaze {
+namespace internal {
+
+// Named reducers for values of type V, registered in addition to the builtin names.
+// Reducers that are associative over a trivially copyable V get an MPI op created from them, so
+// that reductions into std::vector run through MPI_Allreduce.
+template <class V>
+class ReducerRegistry {
+ public:
+  using Func = void (*)(V&, const V&);
+
+  template <Func F>
+  static void add(const std::string& name, const ReducerTraits& traits);
+
+  static bool has(const std::string& name) { return get_entries().count(name) > 0; }
+
+  static Func get_func(const std::string& name);
+
+  // Returns whether the reducer has an MPI op, which is created on first use.
+  static bool get_mpi_op(const std::string& name, MPI_Op& op, MPI_Datatype& type);
+
+  static bool get_mpi_op(const Func func, MPI_Op& op, MPI_Datatype& type);
+
+  // Functions that are not registered are not taken as commutative.
+  static bool is_commutative(const Func func);
+
+ private:
+  class Entry {
+   public:
+    Func func;
+
+    ReducerTraits traits;
+
+    MPI_User_function* mpi_func;
+
+    MPI_Op op;
+  };
+
+  static std::unordered_map<std::string, Entry>& get_entries() {
+    static std::unordered_map<std::string, Entry> entries;
+    return entries;
+  }
+
+  static bool get_mpi_op(Entry& entry, MPI_Op& op, MPI_Datatype& type);
+
+  // Contiguous bytes, which only user defined ops operate on.
+  static MPI_Datatype get_mpi_type();
+
+  // MPI calls the op with inout = in op inout, where in comes from the lower ranks.
+  template <Func F>
+  static void apply(void* in, void* inout, int* len, MPI_Datatype*) {
+    const V* in_values = static_cast<const V*>(in);
+    V* inout_values = static_cast<V*>(inout);
+    for (int i = 0; i < *len; i++) {
+      V value = in_values[i];
+      F(value, inout_values[i]);
+      inout_values[i] = value;
+    }
+  }
+};
+
+template <class V>
+template <typename ReducerRegistry<V>::Func F>
+void ReducerRegistry<V>::add(const std::string& name, const ReducerTraits& traits) {
+  auto& entries = get_entries();
+  const auto& it = entries.find(name);
+  if (it != entries.end()) {
+    // Registering the same function again, e.g. from a repeated setup, keeps the first entry.
+    if (it->second.func == F) return;
+    throw std::invalid_argument("reducer already registered: " + name);
+  }
+  entries[name] = {F, traits, &apply<F>, MPI_OP_NULL};
+}
+
+template <class V>
+typename ReducerRegistry<V>::Func ReducerRegistry<V>::get_func(const std::string& name) {
+  auto& entries = get_entries();
+  const auto& it = entries.find(name);
+  if (it == entries.end()) throw std::invalid_argument("invalid reducer: " + name);
+  return it->second.func;
+}
+
+template <class V>
+bool ReducerRegistry<V>::get_mpi_op(const std::string& name, MPI_Op& op, MPI_Datatype& type) {
+  auto& entries = get_entries();
+  const auto& it = entries.find(name);
+  if (it == entries.end()) return false;
+  return get_mpi_op(it->second, op, type);
+}
+
+template <class V>
+bool ReducerRegistry<V>::get_mpi_op(const Func func, MPI_Op& op, MPI_Datatype& type) {
+  for (auto& name_entry : get_entries()) {
+    if (name_entry.second.func == func) return get_mpi_op(name_entry.second, op, type);
+  }
+  return false;
+}
+
+template <class V>
+bool ReducerRegistry<V>::is_commutative(const Func func) {
+  for (const auto& name_entry : get_entries()) {
+    if (name_entry.second.func == func) return name_entry.second.traits.is_commutative;
+  }
+  return false;
+}
+
+template <class V>
+bool ReducerRegistry<V>::get_mpi_op(Entry& entry, MPI_Op& op, MPI_Datatype& type) {
+  if (!entry.traits.is_associative || !std::is_trivially_copyable<V>::value) return false;
+  if (entry.op == MPI_OP_NULL) {
+    MPI_Op_create(entry.mpi_func, entry.traits.is_commutative, &entry.op);
+  }
+  op = entry.op;
+  type = get_mpi_type();
+  return true;
+}
+
+template <class V>
+MPI_Datatype ReducerRegistry<V>::get_mpi_type() {
+  static MPI_Datatype type = MPI_DATATYPE_NULL;
+  if (type == MPI_DATATYPE_NULL) {
+    MPI_Type_contiguous(sizeof(V), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+  }
+  return type;
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BLAZE_INTERNAL_SHARED_WINDOW_H_
+#define BLAZE_INTERNAL_SHARED_WINDOW_H_
+
+#include <mpi.h>
+
+#include "node_comm.h"
+
+namespace blaze {
+namespace internal {
+
+// Memory allocated by the leader of a node and mapped by all procs of the node. Allocating and
+// freeing are collective over the node.
+class SharedWindow {
+ public:
+  SharedWindow(const size_t size, const NodeComm& nodes);
+
+  SharedWindow(const SharedWindow&) = delete;
+
+  SharedWindow& operator=(const SharedWindow&) = delete;
+
+  ~SharedWindow();
+
+  char* get_data() const { return data; }
+
+  size_t get_size() const { return size; }
+
+  // Makes the writes before it visible to all procs of the node. Collective over the node.
+  void fence() { MPI_Win_fence(0, win); }
+
+ private:
+  MPI_Win win;
+
+  char* data;
+
+  size_t size;
+};
+
+inline SharedWindow::SharedWindow(const size_t size, const NodeComm& nodes) : size(size) {
+  const MPI_Aint local_size = nodes.is_leader() ? size : 0;
+  char* local_data;
+  MPI_Win_allocate_shared(local_size, 1, MPI_INFO_NULL, nodes.get_node_comm(), &local_data, &win);
+  MPI_Aint leader_size;
+  int disp_unit;
+  MPI_Win_shared_query(win, 0, &leader_size, &disp_unit, &data);
+  MPI_Win_fence(0, win);
+}
+
+inline SharedWindow::~SharedWindow() {
+  int is_finalized;
+  MPI_Finalized(&is_finalized);
+  if (is_finalized) return;
+  MPI_Win_free(&win);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,422 @@
+#ifndef BLAZE_INTERNAL_SHUFFLE_CODEC_H_
+#define BLAZE_INTERNAL_SHUFFLE_CODEC_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+
+namespace blaze {
+namespace internal {
+
+// Varints and a fast LZ77 block codec in the spirit of LZ4. A block is the varint size of the
+// data, then sequences of a token with the literal length in the high and the match length in
+// the low nibble, the literals, and the 2 byte offset of the match. A nibble of 15 continues in a
+// varint. The last sequence has no match.
+class LzCodec {
+ public:
+  static void compress(const char* data, const size_t size, std::string& block);
+
+  // Throws if the block is corrupt.
+  static void decompress(const char* block, const size_t block_size, std::string& data);
+
+  static void write_varint(size_t value, std::string& buf) {
+    while (value >= 0x80) {
+      buf.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+  }
+
+  static size_t read_varint(const char*& ptr, const char* end) {
+    size_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (ptr == end) break;
+      const unsigned char byte = *ptr++;
+      value |= static_cast<size_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    throw std::runtime_error("corrupt varint");
+  }
+
+ private:
+  constexpr static size_t MIN_MATCH = 4;
+
+  constexpr static size_t MAX_OFFSET = 0xFFFF;
+
+  constexpr static int HASH_BITS = 14;
+
+  static uint32_t read_u32(const char* ptr) {
+    uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+  }
+
+  static size_t get_slot(const uint32_t seq) { return (seq * 2654435761u) >> (32 - HASH_BITS); }
+
+  static void write_sequence(
+      const char* literals,
+      const size_t n_literals,
+      const size_t offset,
+      const size_t match_size,
+      std::string& block);
+};
+
+inline void LzCodec::compress(const char* data, const size_t size, std::string& block) {
+  block.clear();
+  block.reserve(size / 2 + 16);
+  write_varint(size, block);
+  // Positions plus one of the last sequence with each slot, zero for none.
+  std::vector<size_t> table(static_cast<size_t>(1) << HASH_BITS, 0);
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + MIN_MATCH <= size) {
+    const uint32_t seq = read_u32(data + pos);
+    size_t& slot = table[get_slot(seq)];
+    const size_t candidate = slot;
+    slot = pos + 1;
+    if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+        read_u32(data + candidate - 1) != seq) {
+      pos++;
+      continue;
+    }
+    const size_t match_pos = candidate - 1;
+    size_t match_size = MIN_MATCH;
+    while (pos + match_size < size && data[match_pos + match_size] == data[pos + match_size]) {
+      match_size++;
+    }
+    write_sequence(data + anchor, pos - anchor, pos - match_pos, match_size, block);
+    pos += match_size;
+    anchor = pos;
+  }
+  if (anchor < size) write_sequence(data + anchor, size - anchor, 0, 0, block);
+}
+
+inline void LzCodec::write_sequence(
+    const char* literals,
+    const size_t n_literals,
+    const size_t offset,
+    const size_t match_size,
+    std::string& block) {
+  const size_t match_nibble = match_size == 0 ? 0 : match_size - MIN_MATCH;
+  const size_t token = (std::min<size_t>(n_literals, 15) << 4) | std::min<size_t>(match_nibble, 15);
+  block.push_back(static_cast<char>(token));
+  if (n_literals >= 15) write_varint(n_literals - 15, block);
+  block.append(literals, n_literals);
+  if (match_size == 0) return;
+  block.push_back(static_cast<char>(offset & 0xFF));
+  block.push_back(static_cast<char>(offset >> 8));
+  if (match_nibble >= 15) write_varint(match_nibble - 15, block);
+}
+
+inline void LzCodec::decompress(const char* block, const size_t block_size, std::string& data) {
+  const char* ptr = block;
+  const char* end = block + block_size;
+  const size_t size = read_varint(ptr, end);
+  data.resize(size);
+  size_t pos = 0;
+  while (ptr < end) {
+    const unsigned char token = *ptr++;
+    size_t n_literals = token >> 4;
+    if (n_literals == 15) n_literals += read_varint(ptr, end);
+    if (n_literals > static_cast<size_t>(end - ptr) || n_literals > size - pos) {
+      throw std::runtime_error("corrupt compressed block");
+    }
+    std::memcpy(&data[pos], ptr, n_literals);
+    ptr += n_literals;
+    pos += n_literals;
+    if (ptr == end) break;
+
+    if (end - ptr < 2) throw std::runtime_error("corrupt compressed block");
+    const size_t offset = static_cast<unsigned char>(ptr[0]) |
+                          static_cast<size_t>(static_cast<unsigned char>(ptr[1])) << 8;
+    ptr += 2;
+    size_t match_size = token & 0x0F;
+    if (match_size == 15) match_size += read_varint(ptr, end);
+    match_size += MIN_MATCH;
+    if (offset == 0 || offset > pos || match_size > size - pos) {
+      throw std::runtime_error("corrupt compressed block");
+    }
+    // Byte by byte, as a match may overlap the bytes it produces.
+    for (size_t i = 0; i < match_size; i++) data[pos + i] = data[pos - offset + i];
+    pos += match_size;
+  }
+  if (pos != size) throw std::runtime_error("corrupt compressed block");
+}
+
+// Encodes a column of keys or values. Anything else goes through hps, one length-prefixed
+// element at a time.
+template <class T, class Enable = void>
+class ColumnCodec {
+ public:
+  // Whether the pairs are sorted by this column as keys before encoding.
+  constexpr static bool IS_SORTED = false;
+
+  static void encode(const std::vector<const T*>& column, std::string& buf) {
+    std::string elem_buf;
+    for (const T* elem : column) {
+      hps::to_string(*elem, elem_buf);
+      LzCodec::write_varint(elem_buf.size(), buf);
+      buf.append(elem_buf);
+    }
+  }
+
+  static void decode(const char*& ptr, const char* end, std::vector<T>& column) {
+    for (auto& elem : column) {
+      const size_t size = LzCodec::read_varint(ptr, end);
+      if (size > static_cast<size_t>(end - ptr)) throw std::runtime_error("corrupt column");
+      hps::from_char_array(ptr, elem);
+      ptr += size;
+    }
+  }
+};
+
+// Sorted strings share prefixes with their predecessors, which are sent once: the size of the
+// shared prefix, the size of the rest, and the rest.
+template <>
+class ColumnCodec<std::string> {
+ public:
+  constexpr static bool IS_SORTED = true;
+
+  static void encode(const std::vector<const std::string*>& column, std::string& buf) {
+    const std::string empty;
+    const std::string* prev = &empty;
+    for (const std::string* elem : column) {
+      const size_t max_prefix_size = std::min(prev->size(), elem->size());
+      size_t prefix_size = 0;
+      while (prefix_size < max_prefix_size && (*prev)[prefix_size] == (*elem)[prefix_size]) {
+        prefix_size++;
+      }
+      LzCodec::write_varint(prefix_size, buf);
+      LzCodec::write_varint(elem->size() - prefix_size, buf);
+      buf.append(*elem, prefix_size, std::string::npos);
+      prev = elem;
+    }
+  }
+
+  static void decode(const char*& ptr, const char* end, std::vector<std::string>& column) {
+    const std::string empty;
+    const std::string* prev = &empty;
+    for (auto& elem : column) {
+      const size_t prefix_size = LzCodec::read_varint(ptr, end);
+      const size_t suffix_size = LzCodec::read_varint(ptr, end);
+      if (prefix_size > prev->size() || suffix_size > static_cast<size_t>(end - ptr)) {
+        throw std::runtime_error("corrupt column");
+      }
+      elem.reserve(prefix_size + suffix_size);
+      elem.assign(*prev, 0, prefix_size);
+      elem.append(ptr, suffix_size);
+      ptr += suffix_size;
+      prev = &elem;
+    }
+  }
+};
+
+// Integers are sent as varints of their differences from their predecessors, zigzagged so that
+// small negative differences stay small. Sorted keys mostly differ by little.
+template <class T>
+class ColumnCodec<
+    T,
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+ public:
+  constexpr static bool IS_SORTED = true;
+
+  static void encode(const std::vector<const T*>& column, std::string& buf) {
+    uint64_t prev = 0;
+    for (const T* elem : column) {
+      const uint64_t bits = static_cast<uint64_t>(*elem);
+      const uint64_t diff = bits - prev;
+      prev = bits;
+      LzCodec::write_varint((diff << 1) ^ (0 - (diff >> 63)), buf);
+    }
+  }
+
+  static void decode(const char*& ptr, const char* end, std::vector<T>& column) {
+    uint64_t prev = 0;
+    for (auto& elem : column) {
+      const uint64_t zigzag = LzCodec::read_varint(ptr, end);
+      prev += (zigzag >> 1) ^ (0 - (zigzag & 1));
+      elem = static_cast<T>(prev);
+    }
+  }
+};
+
+// Floating point values are XORed with their predecessors, which zeroes the sign, the exponent and
+// the top of the mantissa of similar values. Each is sent as a byte with the numbers of leading and
+// trailing zero bytes, and the bytes in between.
+template <class T>
+class ColumnCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+ public:
+  constexpr static bool IS_SORTED = false;
+
+  static void encode(const std::vector<const T*>& column, std::string& buf) {
+    uint64_t prev = 0;
+    for (const T* elem : column) {
+      const uint64_t bits = to_bits(*elem);
+      const uint64_t diff = bits ^ prev;
+      prev = bits;
+      int n_leading = 0;
+      while (n_leading < 8 && ((diff >> (56 - 8 * n_leading)) & 0xFF) == 0) n_leading++;
+      int n_trailing = 0;
+      while (n_leading + n_trailing < 8 && ((diff >> (8 * n_trailing)) & 0xFF) == 0) n_trailing++;
+      buf.push_back(static_cast<char>((n_leading << 4) | n_trailing));
+      for (int i = 7 - n_leading; i >= n_trailing; i--) {
+        buf.push_back(static_cast<char>((diff >> (8 * i)) & 0xFF));
+      }
+    }
+  }
+
+  static void decode(const char*& ptr, const char* end, std::vector<T>& column) {
+    uint64_t prev = 0;
+    for (auto& elem : column) {
+      if (ptr == end) throw std::runtime_error("corrupt column");
+      const unsigned char header = *ptr++;
+      const int n_leading = header >> 4;
+      const int n_trailing = header & 0x0F;
+      if (n_leading + n_trailing > 8 || 8 - n_leading - n_trailing > end - ptr) {
+        throw std::runtime_error("corrupt column");
+      }
+      uint64_t diff = 0;
+      for (int i = 7 - n_leading; i >= n_trailing; i--) {
+        diff |= static_cast<uint64_t>(static_cast<unsigned char>(*ptr++)) << (8 * i);
+      }
+      prev ^= diff;
+      elem = from_bits(prev);
+    }
+  }
+
+ private:
+  // Floats sit in the high bytes, so that their sign and exponent are the leading ones.
+  constexpr static int SHIFT = 8 * (sizeof(uint64_t) - sizeof(T));
+
+  using Bits = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+
+  static uint64_t to_bits(const T value) {
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return static_cast<uint64_t>(bits) << SHIFT;
+  }
+
+  static T from_bits(const uint64_t value) {
+    const Bits bits = static_cast<Bits>(value >> SHIFT);
+    T res;
+    std::memcpy(&res, &bits, sizeof(T));
+    return res;
+  }
+};
+
+// Encodes the key value pairs of a shuffle buffer column by column, sorted by key where the key
+// column benefits from it.
+template <class K, class V>
+class PairCodec {
+ public:
+  // Pairs: std::vector<std::pair<const K*, const V*>>. Sorted in place if the keys are sortable.
+  static void encode(std::vector<std::pair<const K*, const V*>>& pairs, std::string& buf) {
+    if (ColumnCodec<K>::IS_SORTED) {
+      std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+        return *a.first < *b.first;
+      });
+    }
+    const size_t n_pairs = pairs.size();
+    std::vector<const K*> keys(n_pairs);
+    std::vector<const V*> values(n_pairs);
+    for (size_t i = 0; i < n_pairs; i++) {
+      keys[i] = pairs[i].first;
+      values[i] = pairs[i].second;
+    }
+    LzCodec::write_varint(n_pairs, buf);
+    ColumnCodec<K>::encode(keys, buf);
+    ColumnCodec<V>::encode(values, buf);
+  }
+
+  // Handler: void(const K& key, const V& value).
+  template <class F>
+  static void decode(const char* data, const size_t size, const F& handler) {
+    const char* ptr = data;
+    const char* end = data + size;
+    const size_t n_pairs = LzCodec::read_varint(ptr, end);
+    if (n_pairs > size) throw std::runtime_error("corrupt pairs");
+    std::vector<K> keys(n_pairs);
+    std::vector<V> values(n_pairs);
+    ColumnCodec<K>::decode(ptr, end, keys);
+    ColumnCodec<V>::decode(ptr, end, values);
+    for (size_t i = 0; i < n_pairs; i++) handler(keys[i], values[i]);
+  }
+};
+
+// Compresses send bufs with the LzCodec when that pays off. The codec runs on a sample of each buf
+// first, and the buf is compressed if the time the saved bytes take on the network exceeds the
+// time it takes to compress and decompress them. Each buf ends with a tag for the receiver.
+class ShuffleCompressor {
+ public:
+  // 10 GbE per node.
+  constexpr static double DEFAULT_NETWORK_BYTES_PER_SEC = 1.25e9;
+
+  constexpr static size_t SAMPLE_SIZE = 1 << 16;
+
+  constexpr static char RAW = 'R';
+
+  constexpr static char COMPRESSED = 'Z';
+
+  // The bandwidth of this proc. With 0, bufs are compressed whenever that saves bytes.
+  ShuffleCompressor(const double network_bytes_per_sec)
+      : network_bytes_per_sec(network_bytes_per_sec) {}
+
+  void compress(std::string& buf) const;
+
+  // Restores a buf from compress, which must not be empty.
+  void decompress(std::string& buf) const;
+
+ private:
+  double network_bytes_per_sec;
+
+  bool is_worth_compressing(const std::string& buf, std::string& block) const;
+};
+
+inline void ShuffleCompressor::compress(std::string& buf) const {
+  std::string block;
+  if (!is_worth_compressing(buf, block)) {
+    buf += RAW;
+    return;
+  }
+  if (buf.size() > SAMPLE_SIZE) LzCodec::compress(buf.data(), buf.size(), block);
+  buf.swap(block);
+  buf += COMPRESSED;
+}
+
+inline bool ShuffleCompressor::is_worth_compressing(
+    const std::string& buf, std::string& block) const {
+  const size_t sample_size = buf.size() < SAMPLE_SIZE ? buf.size() : SAMPLE_SIZE;
+  if (sample_size == 0) return false;
+  const auto start = std::chrono::steady_clock::now();
+  LzCodec::compress(buf.data(), sample_size, block);
+  const auto end = std::chrono::steady_clock::now();
+  if (block.size() >= sample_size) return false;
+  if (network_bytes_per_sec <= 0) return true;
+  const double compress_sec = std::chrono::duration<double>(end - start).count();
+  // Decompressing takes at most as long as compressing.
+  const double saved_sec = (sample_size - block.size()) / network_bytes_per_sec;
+  return saved_sec > 2 * compress_sec;
+}
+
+inline void ShuffleCompressor::decompress(std::string& buf) const {
+  const char tag = buf.back();
+  buf.pop_back();
+  if (tag == RAW) return;
+  if (tag != COMPRESSED) throw std::runtime_error("corrupt shuffle buf");
+  std::string data;
+  LzCodec::decompress(buf.data(), buf.size(), data);
+  buf.swap(data);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef BLAZE_INTERNAL_SHUFFLE_PLAN_H_
+#define BLAZE_INTERNAL_SHUFFLE_PLAN_H_
+
+#include <mpi.h>
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "exchange_util.h"
+#include "mpi_util.h"
+
+namespace blaze {
+namespace internal {
+
+// Records the remote keys a DistVector sends to each proc in one sync and replays these routes in
+// later syncs. Replays reduce values into a fixed slot per key and destination instead of hash
+// maps, and exchange only the value arrays and the flags of the slots set in the round over
+// persistent requests. Receivers scatter the values of the set slots into the keys recorded for
+// them.
+template <class V>
+class ShufflePlan {
+ public:
+  ShufflePlan();
+
+  ShufflePlan(const ShufflePlan&) = delete;
+
+  ~ShufflePlan();
+
+  bool is_recorded() const { return n_keys_recorded > 0; }
+
+  // The size of the DistVector the plan was recorded on.
+  size_t get_n_keys_recorded() const { return n_keys_recorded; }
+
+  // Collective. Records send_keys[i], the keys sent to proc i, in slot order.
+  void record(const size_t n_keys, const std::vector<std::vector<size_t>>& send_keys);
+
+  // Returns false if the key is not on the plan, or the calling thread is past those the plan holds
+  // values for, e.g. after omp_set_num_threads.
+  template <class R>
+  bool async_set(const int dest_proc_id, const size_t key, const V& value, const R& reducer);
+
+  // Collective. Exchanges the values of all slots and passes the received ones to the merger.
+  // Merger: void(const size_t key, const V& value), must be thread safe.
+  template <class M>
+  void sync(const std::function<void(V&, const V&)>& reducer, const M& merger);
+
+ private:
+  constexpr static uint32_t NO_SLOT = UINT32_MAX;
+
+  int n_procs;
+
+  int proc_id;
+
+  size_t n_keys_recorded;
+
+  MPI_Comm comm;
+
+  MPI_Datatype value_type;
+
+  // Per destination, indexed by key.
+  std::vector<std::vector<uint32_t>> slots;
+
+  // Per thread and destination. The sends read from the values and flags of thread 0.
+  std::vector<std::vector<std::vector<V>>> thread_send_values;
+
+  // Whether each slot was set in the round, so that the first value set is copied in and unset
+  // slots are not merged.
+  std::vector<std::vector<std::vector<char>>> thread_send_set;
+
+  // Per source.
+  std::vector<std::vector<size_t>> recv_keys;
+
+  std::vector<std::vector<V>> recv_values;
+
+  std::vector<std::vector<char>> recv_set;
+
+  std::vector<MPI_Request> reqs;
+
+  // Holds values for omp_get_max_threads threads. The slots of threads past 0 must be unset.
+  void resize_thread_send_values();
+};
+
+template <class V>
+ShufflePlan<V>::ShufflePlan() {
+  static_assert(std::is_trivially_copyable<V>::value, "shuffle plans send raw value arrays");
+  n_procs = MpiUtil::get_n_procs();
+  proc_id = MpiUtil::get_proc_id();
+  n_keys_recorded = 0;
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  MPI_Type_contiguous(sizeof(V), MPI_BYTE, &value_type);
+  MPI_Type_commit(&value_type);
+}
+
+template <class V>
+ShufflePlan<V>::~ShufflePlan() {
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (finalized) return;
+  for (auto& req : reqs) MPI_Request_free(&req);
+  MPI_Type_free(&value_type);
+  MPI_Comm_free(&comm);
+}
+
+template <class V>
+void ShufflePlan<V>::record(
+    const size_t n_keys, const std::vector<std::vector<size_t>>& send_keys) {
+  slots.assign(n_procs, std::vector<uint32_t>());
+  thread_send_values.assign(1, std::vector<std::vector<V>>(n_procs));
+  thread_send_set.assign(1, std::vector<std::vector<char>>(n_procs));
+  std::vector<std::string> send_bufs(n_procs);
+  for (int i = 0; i < n_procs; i++) {
+    const auto& keys = send_keys[i];
+    if (i == proc_id || keys.empty()) continue;
+    auto& dest_slots = slots[i];
+    dest_slots.assign(*std::max_element(keys.begin(), keys.end()) + 1, NO_SLOT);
+    for (size_t j = 0; j < keys.size(); j++) dest_slots[keys[j]] = j;
+    thread_send_values[0][i].assign(keys.size(), V());
+    thread_send_set[0][i].assign(keys.size(), 0);
+    hps::to_string(keys, send_bufs[i]);
+  }
+  resize_thread_send_values();
+
+  std::vector<std::string> recv_bufs;
+  ExchangeUtil::all_to_all(send_bufs, recv_bufs);
+  recv_keys.assign(n_procs, std::vector<size_t>());
+  recv_values.assign(n_procs, std::vector<V>());
+  recv_set.assign(n_procs, std::vector<char>());
+  for (int i = 0; i < n_procs; i++) {
+    if (recv_bufs[i].empty()) continue;
+    hps::from_string(recv_bufs[i], recv_keys[i]);
+    recv_values[i].assign(recv_keys[i].size(), V());
+    recv_set[i].assign(recv_keys[i].size(), 0);
+  }
+
+  for (auto& req : reqs) MPI_Request_free(&req);
+  reqs.clear();
+  for (int i = 0; i < n_procs; i++) {
+    MPI_Request req;
+    if (!recv_values[i].empty()) {
+      MPI_Recv_init(recv_values[i].data(), recv_values[i].size(), value_type, i, 0, comm, &req);
+      reqs.push_back(req);
+      MPI_Recv_init(recv_set[i].data(), recv_set[i].size(), MPI_CHAR, i, 1, comm, &req);
+      reqs.push_back(req);
+    }
+    auto& send_values = thread_send_values[0][i];
+    if (!send_values.empty()) {
+      MPI_Send_init(send_values.data(), send_values.size(), value_type, i, 0, comm, &req);
+      reqs.push_back(req);
+      auto& send_set = thread_send_set[0][i];
+      MPI_Send_init(send_set.data(), send_set.size(), MPI_CHAR, i, 1, comm, &req);
+      reqs.push_back(req);
+    }
+  }
+  n_keys_recorded = n_keys;
+}
+
+template <class V>
+template <class R>
+bool ShufflePlan<V>::async_set(
+    const int dest_proc_id, const size_t key, const V& value, const R& reducer) {
+  if (n_keys_recorded == 0) return false;
+  const auto& dest_slots = slots[dest_proc_id];
+  if (key >= dest_slots.size() || dest_slots[key] == NO_SLOT) return false;
+  const size_t thread_id = omp_get_thread_num();
+  if (thread_id >= thread_send_values.size()) return false;
+  const uint32_t slot = dest_slots[key];
+  V& slot_value = thread_send_values[thread_id][dest_proc_id][slot];
+  char& is_set = thread_send_set[thread_id][dest_proc_id][slot];
+  if (is_set) {
+    reducer(slot_value, value);
+  } else {
+    slot_value = value;
+    is_set = 1;
+  }
+  return true;
+}
+
+template <class V>
+template <class M>
+void ShufflePlan<V>::sync(const std::function<void(V&, const V&)>& reducer, const M& merger) {
+  const int n_threads = thread_send_values.size();
+  for (int i = 0; i < n_procs; i++) {
+    auto& send_values = thread_send_values[0][i];
+    auto& send_set = thread_send_set[0][i];
+    const size_t n_slots = send_values.size();
+#pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < n_slots; j++) {
+      for (int t = 1; t < n_threads; t++) {
+        char& is_set = thread_send_set[t][i][j];
+        if (!is_set) continue;
+        if (send_set[j]) {
+          reducer(send_values[j], thread_send_values[t][i][j]);
+        } else {
+          send_values[j] = thread_send_values[t][i][j];
+          send_set[j] = 1;
+        }
+        is_set = 0;
+      }
+    }
+  }
+
+  if (!reqs.empty()) {
+    MPI_Startall(reqs.size(), reqs.data());
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  for (auto& send_set : thread_send_set[0]) std::fill(send_set.begin(), send_set.end(), 0);
+  // The next replay may run on a different number of threads.
+  resize_thread_send_values();
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_procs; i++) {
+    const auto& keys = recv_keys[i];
+    const auto& values = recv_values[i];
+    const auto& set = recv_set[i];
+    for (size_t j = 0; j < keys.size(); j++) {
+      if (set[j]) merger(keys[j], values[j]);
+    }
+  }
+}
+
+template <class V>
+void ShufflePlan<V>::resize_thread_send_values() {
+  const size_t n_threads = std::max(omp_get_max_threads(), 1);
+  const size_t prev_n_threads = thread_send_values.size();
+  // Moving the slots of thread 0 keeps the buffers the persistent sends read from.
+  thread_send_values.resize(n_threads);
+  thread_send_set.resize(n_threads);
+  for (size_t t = prev_n_threads; t < n_threads; t++) {
+    thread_send_values[t].resize(n_procs);
+    thread_send_set[t].resize(n_procs);
+    for (int i = 0; i < n_procs; i++) {
+      thread_send_values[t][i].assign(thread_send_values[0][i].size(), V());
+      thread_send_set[t][i].assign(thread_send_values[0][i].size(), 0);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
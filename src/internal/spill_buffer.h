@@ -0,0 +1,249 @@
+#ifndef BLAZE_INTERNAL_SPILL_BUFFER_H_
+#define BLAZE_INTERNAL_SPILL_BUFFER_H_
+
+#include <mpi.h>
+#include <omp.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "exchange_util.h"
+#include "hash/hash_map.h"
+#include "mpi_type.h"
+#include "mpi_util.h"
+
+namespace blaze {
+namespace internal {
+
+// Buffers remote key value pairs per thread and destination within a budget of keys.
+// When a thread's share of the budget is exceeded, its buffers are appended as runs to its own
+// temp files. At sync, the runs are exchanged one round at a time, so that at most one run per
+// destination is in memory, and the keys still buffered are handed back to the container.
+template <class K, class V, class H = std::hash<K>>
+class SpillBuffer {
+ public:
+  SpillBuffer(const size_t max_n_keys, const std::string& spill_dir);
+
+  SpillBuffer(const SpillBuffer&) = delete;
+
+  ~SpillBuffer();
+
+  template <class R>
+  void async_set(
+      const int dest_proc_id,
+      const K& key,
+      const size_t hash_value,
+      const V& value,
+      const R& reducer);
+
+  // Collective. Merges the runs other procs spilled for this proc through the merger.
+  // Merger: void(const K& key, const size_t hash_value, const V& value), must be thread safe.
+  template <class M>
+  void sync_spilled(const M& merger);
+
+  // Hands the buffered keys to the handler and clears the buffers.
+  // Handler: void(const int dest_proc_id, const K& key, const size_t hash_value, const V& value).
+  template <class F>
+  void flush(const F& handler);
+
+  size_t get_n_spilled_runs() const;
+
+  void clear();
+
+ private:
+  class Run {
+   public:
+    int thread_id;
+
+    std::streamoff offset;
+
+    size_t size;
+  };
+
+  int n_procs;
+
+  int proc_id;
+
+  size_t max_n_keys_thread;
+
+  std::vector<std::vector<hash::HashMap<K, V, H>>> thread_bufs;
+
+  std::vector<size_t> thread_n_keys;
+
+  // Per thread and destination.
+  std::vector<std::vector<std::string>> thread_filenames;
+
+  std::vector<std::vector<std::vector<Run>>> thread_runs;
+
+  void spill(const int thread_id);
+
+  void remove_files();
+};
+
+template <class K, class V, class H>
+SpillBuffer<K, V, H>::SpillBuffer(const size_t max_n_keys, const std::string& spill_dir) {
+  n_procs = MpiUtil::get_n_procs();
+  proc_id = MpiUtil::get_proc_id();
+  const int n_threads = omp_get_max_threads();
+  max_n_keys_thread = std::max<size_t>(max_n_keys / n_threads, 1);
+  thread_bufs.resize(n_threads);
+  thread_n_keys.assign(n_threads, 0);
+  thread_filenames.resize(n_threads);
+  thread_runs.resize(n_threads);
+  const std::string prefix = spill_dir + "/blaze_spill_" + std::to_string(getpid()) + "_" +
+                             std::to_string(reinterpret_cast<size_t>(this)) + "_";
+  for (int i = 0; i < n_threads; i++) {
+    thread_bufs[i].resize(n_procs);
+    thread_runs[i].resize(n_procs);
+    for (int j = 0; j < n_procs; j++) {
+      thread_filenames[i].push_back(prefix + std::to_string(i) + "_" + std::to_string(j));
+    }
+  }
+}
+
+template <class K, class V, class H>
+SpillBuffer<K, V, H>::~SpillBuffer() {
+  remove_files();
+}
+
+template <class K, class V, class H>
+template <class R>
+void SpillBuffer<K, V, H>::async_set(
+    const int dest_proc_id,
+    const K& key,
+    const size_t hash_value,
+    const V& value,
+    const R& reducer) {
+  const int thread_id = omp_get_thread_num();
+  auto& buf = thread_bufs[thread_id][dest_proc_id];
+  const size_t n_keys_before = buf.get_n_keys();
+  buf.set(key, hash_value, value, reducer);
+  thread_n_keys[thread_id] += buf.get_n_keys() - n_keys_before;
+  if (thread_n_keys[thread_id] > max_n_keys_thread) spill(thread_id);
+}
+
+template <class K, class V, class H>
+void SpillBuffer<K, V, H>::spill(const int thread_id) {
+  std::string run;
+  for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+    auto& buf = thread_bufs[thread_id][dest_proc_id];
+    if (buf.get_n_keys() == 0) continue;
+    const auto& filename = thread_filenames[thread_id][dest_proc_id];
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    if (!file) throw std::runtime_error("cannot open spill file " + filename);
+    file.seekp(0, std::ios::end);
+    hps::to_string(buf, run);
+    thread_runs[thread_id][dest_proc_id].push_back({thread_id, file.tellp(), run.size()});
+    file.write(run.data(), run.size());
+    if (!file) throw std::runtime_error("cannot write spill file " + filename);
+    buf.clear();
+  }
+  thread_n_keys[thread_id] = 0;
+}
+
+template <class K, class V, class H>
+template <class M>
+void SpillBuffer<K, V, H>::sync_spilled(const M& merger) {
+  const int n_threads = thread_bufs.size();
+  std::vector<std::vector<Run>> runs(n_procs);
+  size_t n_rounds_local = 0;
+  for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+    for (int i = 0; i < n_threads; i++) {
+      const auto& thread_dest_runs = thread_runs[i][dest_proc_id];
+      runs[dest_proc_id].insert(
+          runs[dest_proc_id].end(), thread_dest_runs.begin(), thread_dest_runs.end());
+    }
+    n_rounds_local = std::max(n_rounds_local, runs[dest_proc_id].size());
+  }
+  size_t n_rounds = 0;
+  MPI_Allreduce(
+      &n_rounds_local, &n_rounds, 1, MpiType<size_t>::value, MPI_MAX, MPI_COMM_WORLD);
+
+  std::vector<std::string> send_bufs(n_procs);
+  std::vector<std::string> recv_bufs;
+  for (size_t round = 0; round < n_rounds; round++) {
+    for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+      auto& send_buf = send_bufs[dest_proc_id];
+      send_buf.clear();
+      if (round >= runs[dest_proc_id].size()) continue;
+      const auto& run = runs[dest_proc_id][round];
+      std::ifstream file(thread_filenames[run.thread_id][dest_proc_id], std::ios::binary);
+      file.seekg(run.offset);
+      send_buf.resize(run.size);
+      file.read(&send_buf[0], run.size);
+      if (!file) throw std::runtime_error("cannot read spill file");
+    }
+
+    // Runs to this proc itself are merged directly.
+    recv_bufs.clear();
+    ExchangeUtil::all_to_all(send_bufs, recv_bufs);
+    recv_bufs[proc_id].swap(send_bufs[proc_id]);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n_procs; i++) {
+      if (recv_bufs[i].empty()) continue;
+      hash::HashMap<K, V, H> buf;
+      hps::from_string(recv_bufs[i], buf);
+      buf.for_each(merger);
+    }
+  }
+
+  for (auto& thread_dest_runs : thread_runs) {
+    for (auto& dest_runs : thread_dest_runs) dest_runs.clear();
+  }
+  remove_files();
+}
+
+template <class K, class V, class H>
+template <class F>
+void SpillBuffer<K, V, H>::flush(const F& handler) {
+  const int n_threads = thread_bufs.size();
+  for (int i = 0; i < n_threads; i++) {
+    for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+      auto& buf = thread_bufs[i][dest_proc_id];
+      buf.for_each([&](const K& key, const size_t hash_value, const V& value) {
+        handler(dest_proc_id, key, hash_value, value);
+      });
+      buf.clear();
+    }
+    thread_n_keys[i] = 0;
+  }
+}
+
+template <class K, class V, class H>
+size_t SpillBuffer<K, V, H>::get_n_spilled_runs() const {
+  size_t n_runs = 0;
+  for (const auto& thread_dest_runs : thread_runs) {
+    for (const auto& dest_runs : thread_dest_runs) n_runs += dest_runs.size();
+  }
+  return n_runs;
+}
+
+template <class K, class V, class H>
+void SpillBuffer<K, V, H>::clear() {
+  for (auto& bufs : thread_bufs) {
+    for (auto& buf : bufs) buf.clear();
+  }
+  thread_n_keys.assign(thread_n_keys.size(), 0);
+  for (auto& thread_dest_runs : thread_runs) {
+    for (auto& dest_runs : thread_dest_runs) dest_runs.clear();
+  }
+  remove_files();
+}
+
+template <class K, class V, class H>
+void SpillBuffer<K, V, H>::remove_files() {
+  for (const auto& filenames : thread_filenames) {
+    for (const auto& filename : filenames) std::remove(filename.c_str());
+  }
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef BLAZE_INTERNAL_STREAM_SHUFFLER_H_
+#define BLAZE_INTERNAL_STREAM_SHUFFLER_H_
+
+#include <mpi.h>
+#include <omp.h>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "../../vendor/hps/src/hps.h"
+#include "hash/hash_map.h"
+#include "mpi_util.h"
+
+namespace blaze {
+namespace internal {
+
+// Sends remote key value pairs to their owners in chunks while the map phase is still running.
+// Each thread combines pairs in its own buffer per destination. A full buffer is serialized and
+// queued, and thread 0 posts the queued chunks with nonblocking sends and merges incoming chunks
+// through the merger. MPI is only called from thread 0, which requires MPI_THREAD_FUNNELED.
+template <class K, class V, class H = std::hash<K>>
+class StreamShuffler {
+ public:
+  constexpr static size_t DEFAULT_N_CHUNK_KEYS = 1 << 14;
+
+  constexpr static size_t N_PROGRESS_SETS = 1 << 10;
+
+  StreamShuffler(const size_t n_chunk_keys = DEFAULT_N_CHUNK_KEYS);
+
+  StreamShuffler(const StreamShuffler&) = delete;
+
+  ~StreamShuffler();
+
+  // Merger: void(const K& key, const size_t hash_value, const V& value), must be thread safe.
+  template <class R, class M>
+  void async_set(
+      const int dest_proc_id,
+      const K& key,
+      const size_t hash_value,
+      const V& value,
+      const R& reducer,
+      const M& merger);
+
+  // Collective. Sends the remaining pairs and merges everything received in this round.
+  template <class M>
+  void sync(const M& merger);
+
+ private:
+  constexpr static int CHUNK_TAG = 0;
+
+  constexpr static int DONE_TAG = 1;
+
+  int n_procs;
+
+  int proc_id;
+
+  size_t n_chunk_keys;
+
+  bool is_funneled;
+
+  MPI_Comm comm;
+
+  size_t n_sets_thread_0;
+
+  std::vector<std::vector<hash::HashMap<K, V, H>>> thread_bufs;
+
+  std::vector<std::pair<int, std::string>> queued_chunks;
+
+  omp_lock_t queue_lock;
+
+  std::list<std::string> sending_chunks;
+
+  std::vector<MPI_Request> send_reqs;
+
+  std::vector<bool> done_procs;
+
+  void enqueue(const int dest_proc_id, hash::HashMap<K, V, H>& buf);
+
+  void send_queued();
+
+  void send(const int dest_proc_id, std::string&& chunk, const int tag);
+
+  void complete_sends(const bool wait);
+
+  // Receives one message from src_proc_id, or any source if MPI_ANY_SOURCE, if one is pending.
+  bool receive(const int src_proc_id, const bool wait, std::string& chunk);
+
+  template <class M>
+  void merge(const std::string& chunk, const M& merger);
+
+  template <class M>
+  void progress(const M& merger);
+};
+
+template <class K, class V, class H>
+StreamShuffler<K, V, H>::StreamShuffler(const size_t n_chunk_keys) : n_chunk_keys(n_chunk_keys) {
+  n_procs = MpiUtil::get_n_procs();
+  proc_id = MpiUtil::get_proc_id();
+  int thread_level;
+  MPI_Query_thread(&thread_level);
+  is_funneled = thread_level >= MPI_THREAD_FUNNELED;
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  n_sets_thread_0 = 0;
+  const int n_threads = omp_get_max_threads();
+  thread_bufs.resize(n_threads);
+  for (auto& bufs : thread_bufs) bufs.resize(n_procs);
+  omp_init_lock(&queue_lock);
+  done_procs.assign(n_procs, false);
+}
+
+template <class K, class V, class H>
+StreamShuffler<K, V, H>::~StreamShuffler() {
+  omp_destroy_lock(&queue_lock);
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!finalized) MPI_Comm_free(&comm);
+}
+
+template <class K, class V, class H>
+template <class R, class M>
+void StreamShuffler<K, V, H>::async_set(
+    const int dest_proc_id,
+    const K& key,
+    const size_t hash_value,
+    const V& value,
+    const R& reducer,
+    const M& merger) {
+  const int thread_id = omp_get_thread_num();
+  auto& buf = thread_bufs[thread_id][dest_proc_id];
+  buf.set(key, hash_value, value, reducer);
+  if (buf.get_n_keys() >= n_chunk_keys) enqueue(dest_proc_id, buf);
+  if (thread_id != 0 || !is_funneled) return;
+  n_sets_thread_0++;
+  if (n_sets_thread_0 % N_PROGRESS_SETS == 0) progress(merger);
+}
+
+template <class K, class V, class H>
+template <class M>
+void StreamShuffler<K, V, H>::sync(const M& merger) {
+  const int n_threads = thread_bufs.size();
+#pragma omp parallel for schedule(static, 1)
+  for (int thread_id = 0; thread_id < n_threads; thread_id++) {
+    for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+      auto& buf = thread_bufs[thread_id][dest_proc_id];
+      if (buf.get_n_keys() > 0) enqueue(dest_proc_id, buf);
+    }
+  }
+  send_queued();
+  for (int dest_proc_id = 0; dest_proc_id < n_procs; dest_proc_id++) {
+    if (dest_proc_id != proc_id) send(dest_proc_id, std::string(), DONE_TAG);
+  }
+
+  // Receive per source so that chunks a faster peer sends for the next round stay queued.
+  std::vector<std::string> chunks;
+  std::string chunk;
+  for (int src_proc_id = 0; src_proc_id < n_procs; src_proc_id++) {
+    if (src_proc_id == proc_id) continue;
+    while (!done_procs[src_proc_id]) {
+      if (receive(src_proc_id, true, chunk)) chunks.push_back(std::move(chunk));
+    }
+  }
+
+  const int n_chunks = chunks.size();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < n_chunks; i++) merge(chunks[i], merger);
+
+  complete_sends(true);
+  done_procs.assign(n_procs, false);
+  n_sets_thread_0 = 0;
+}
+
+template <class K, class V, class H>
+void StreamShuffler<K, V, H>::enqueue(const int dest_proc_id, hash::HashMap<K, V, H>& buf) {
+  std::string chunk = hps::to_string(buf);
+  buf.clear();
+  omp_set_lock(&queue_lock);
+  queued_chunks.emplace_back(dest_proc_id, std::move(chunk));
+  omp_unset_lock(&queue_lock);
+}
+
+template <class K, class V, class H>
+void StreamShuffler<K, V, H>::send_queued() {
+  std::vector<std::pair<int, std::string>> chunks;
+  omp_set_lock(&queue_lock);
+  chunks.swap(queued_chunks);
+  omp_unset_lock(&queue_lock);
+  for (auto& chunk : chunks) send(chunk.first, std::move(chunk.second), CHUNK_TAG);
+}
+
+template <class K, class V, class H>
+void StreamShuffler<K, V, H>::send(const int dest_proc_id, std::string&& chunk, const int tag) {
+  sending_chunks.push_back(std::move(chunk));
+  const auto& send_chunk = sending_chunks.back();
+  send_reqs.emplace_back();
+  MPI_Isend(
+      send_chunk.data(), send_chunk.size(), MPI_CHAR, dest_proc_id, tag, comm, &send_reqs.back());
+}
+
+template <class K, class V, class H>
+void StreamShuffler<K, V, H>::complete_sends(const bool wait) {
+  // Requests complete in order for the common case, so release the finished prefix.
+  size_t n_completed = 0;
+  if (wait) {
+    MPI_Waitall(send_reqs.size(), send_reqs.data(), MPI_STATUSES_IGNORE);
+    n_completed = send_reqs.size();
+  } else {
+    int flag = 1;
+    while (n_completed < send_reqs.size() && flag) {
+      MPI_Test(&send_reqs[n_completed], &flag, MPI_STATUS_IGNORE);
+      if (flag) n_completed++;
+    }
+  }
+  send_reqs.erase(send_reqs.begin(), send_reqs.begin() + n_completed);
+  for (size_t i = 0; i < n_completed; i++) sending_chunks.pop_front();
+}
+
+template <class K, class V, class H>
+bool StreamShuffler<K, V, H>::receive(const int src_proc_id, const bool wait, std::string& chunk) {
+  MPI_Status status;
+  if (wait) {
+    MPI_Probe(src_proc_id, MPI_ANY_TAG, comm, &status);
+  } else {
+    int flag;
+    MPI_Iprobe(src_proc_id, MPI_ANY_TAG, comm, &flag, &status);
+    if (!flag) return false;
+  }
+  int count;
+  MPI_Get_count(&status, MPI_CHAR, &count);
+  chunk.resize(count);
+  MPI_Recv(&chunk[0], count, MPI_CHAR, status.MPI_SOURCE, status.MPI_TAG, comm, &status);
+  if (status.MPI_TAG == DONE_TAG) {
+    done_procs[status.MPI_SOURCE] = true;
+    return false;
+  }
+  return true;
+}
+
+template <class K, class V, class H>
+template <class M>
+void StreamShuffler<K, V, H>::merge(const std::string& chunk, const M& merger) {
+  hash::HashMap<K, V, H> buf;
+  hps::from_string(chunk, buf);
+  buf.for_each(merger);
+}
+
+template <class K, class V, class H>
+template <class M>
+void StreamShuffler<K, V, H>::progress(const M& merger) {
+  send_queued();
+  complete_sends(false);
+  std::string chunk;
+  while (receive(MPI_ANY_SOURCE, false, chunk)) merge(chunk, merger);
+}
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
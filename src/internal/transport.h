@@ -0,0 +1,396 @@
+#ifndef BLAZE_INTERNAL_TRANSPORT_H_
+#define BLAZE_INTERNAL_TRANSPORT_H_
+
+#include <mpi.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mpi_type.h"
+#include "mpi_util.h"
+#include "node_comm.h"
+
+namespace blaze {
+namespace internal {
+
+// Moves serialized messages between procs straight out of and into their strings. Messages are
+// split into chunks of at most max_chunk_size bytes, so that MPI counts fit in an int, and all
+// chunks of a message are in flight at once. All procs of the comm, MPI_COMM_WORLD by default, take
+// part in the collectives.
+class Transport {
+ public:
+  constexpr static size_t MAX_CHUNK_SIZE = static_cast<size_t>(1) << 30;
+
+  // Sends send_buf to dest_proc_id while receiving recv_buf from src_proc_id.
+  static void send_recv(
+      const std::string& send_buf,
+      const int dest_proc_id,
+      std::string& recv_buf,
+      const int src_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    size_t send_size = send_buf.size();
+    size_t recv_size = 0;
+    MPI_Request size_reqs[2];
+    const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+    MPI_Irecv(&recv_size, 1, size_t_mpi, src_proc_id, 0, comm, &size_reqs[0]);
+    MPI_Isend(&send_size, 1, size_t_mpi, dest_proc_id, 0, comm, &size_reqs[1]);
+    MPI_Waitall(2, size_reqs, MPI_STATUSES_IGNORE);
+    recv_buf.resize(recv_size);
+    std::vector<MPI_Request> reqs;
+    irecv(&recv_buf[0], recv_size, src_proc_id, comm, max_chunk_size, reqs);
+    isend(send_buf.data(), send_size, dest_proc_id, comm, max_chunk_size, reqs);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  static void send(
+      const std::string& msg,
+      const int dest_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    size_t msg_size = msg.size();
+    MPI_Send(&msg_size, 1, MpiType<size_t>::value, dest_proc_id, 0, comm);
+    send(msg.data(), msg_size, dest_proc_id, comm, max_chunk_size);
+  }
+
+  // Sends size bytes the receiver already expects.
+  static void send(
+      const char* data,
+      const size_t size,
+      const int dest_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    std::vector<MPI_Request> reqs;
+    isend(data, size, dest_proc_id, comm, max_chunk_size, reqs);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  static void recv(
+      std::string& msg,
+      const int src_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    size_t msg_size;
+    MPI_Recv(&msg_size, 1, MpiType<size_t>::value, src_proc_id, 0, comm, MPI_STATUS_IGNORE);
+    msg.resize(msg_size);
+    recv(&msg[0], msg_size, src_proc_id, comm, max_chunk_size);
+  }
+
+  static void recv(
+      char* data,
+      const size_t size,
+      const int src_proc_id,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    std::vector<MPI_Request> reqs;
+    irecv(data, size, src_proc_id, comm, max_chunk_size, reqs);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  // Broadcasts msg from the root into msg on every proc.
+  static void broadcast(
+      std::string& msg,
+      const int root,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    size_t msg_size = msg.size();
+    MPI_Bcast(&msg_size, 1, MpiType<size_t>::value, root, comm);
+    msg.resize(msg_size);
+    broadcast(&msg[0], msg_size, root, comm, max_chunk_size);
+  }
+
+  // Broadcasts size bytes all procs already expect.
+  static void broadcast(
+      char* data,
+      const size_t size,
+      const int root,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    std::vector<MPI_Request> reqs;
+    ibcast(data, size, root, comm, max_chunk_size, reqs);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  // Gathers the msgs of all procs back to back into recv_buf on every proc. The msg of proc i
+  // starts at displs[i] and ends at displs[i + 1].
+  static void allgather(
+      const std::string& msg,
+      std::string& recv_buf,
+      std::vector<size_t>& displs,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    allgather(msg.data(), msg.size(), recv_buf, displs, comm, max_chunk_size);
+  }
+
+  // Same, with the msg of this proc as size bytes at data.
+  static void allgather(
+      const char* data,
+      const size_t size,
+      std::string& recv_buf,
+      std::vector<size_t>& displs,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    const int n_procs = MpiUtil::get_n_procs(comm);
+    const int proc_id = MpiUtil::get_proc_id(comm);
+    const size_t msg_size = size;
+    std::vector<size_t> msg_sizes(n_procs);
+    const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+    MPI_Allgather(&msg_size, 1, size_t_mpi, msg_sizes.data(), 1, size_t_mpi, comm);
+    displs.assign(n_procs + 1, 0);
+    for (int i = 0; i < n_procs; i++) displs[i + 1] = displs[i] + msg_sizes[i];
+    recv_buf.resize(displs[n_procs]);
+
+    if (displs[n_procs] <= max_chunk_size) {
+      std::vector<int> counts(n_procs);
+      std::vector<int> int_displs(n_procs);
+      for (int i = 0; i < n_procs; i++) {
+        counts[i] = msg_sizes[i];
+        int_displs[i] = displs[i];
+      }
+      MPI_Allgatherv(
+          data,
+          msg_size,
+          MPI_CHAR,
+          &recv_buf[0],
+          counts.data(),
+          int_displs.data(),
+          MPI_CHAR,
+          comm);
+      return;
+    }
+
+    // Too large for int displacements, so each proc broadcasts its own msg.
+    std::copy(data, data + size, recv_buf.begin() + displs[proc_id]);
+    std::vector<MPI_Request> reqs;
+    for (int i = 0; i < n_procs; i++) {
+      ibcast(&recv_buf[displs[i]], msg_sizes[i], i, comm, max_chunk_size, reqs);
+    }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  }
+
+  // Broadcasts msg from the root across the leaders, and from each leader within its node. The
+  // procs on the node of the root receive msg from the root directly.
+  static void broadcast(
+      std::string& msg,
+      const int root,
+      const NodeComm& nodes,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    if (!nodes.is_hierarchical()) {
+      broadcast(msg, root, MPI_COMM_WORLD, max_chunk_size);
+      return;
+    }
+    size_t msg_size = msg.size();
+    MPI_Bcast(&msg_size, 1, MpiType<size_t>::value, root, MPI_COMM_WORLD);
+    msg.resize(msg_size);
+    broadcast(&msg[0], msg_size, root, nodes, max_chunk_size);
+  }
+
+  // Same, for size bytes all procs already expect.
+  static void broadcast(
+      char* data,
+      const size_t size,
+      const int root,
+      const NodeComm& nodes,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    if (!nodes.is_hierarchical()) {
+      broadcast(data, size, root, MPI_COMM_WORLD, max_chunk_size);
+      return;
+    }
+    const int root_node_id = nodes.get_node_id(root);
+    const bool is_root_node = nodes.get_node_id() == root_node_id;
+    MPI_Comm node_comm = nodes.get_node_comm();
+    if (is_root_node) broadcast(data, size, nodes.get_node_rank(root), node_comm, max_chunk_size);
+    if (nodes.is_leader()) {
+      broadcast(data, size, root_node_id, nodes.get_leader_comm(), max_chunk_size);
+    }
+    if (!is_root_node) broadcast(data, size, 0, node_comm, max_chunk_size);
+  }
+
+  // Same as allgather, but gathers within each node, then across the leaders, and then broadcasts
+  // within each node.
+  static void allgather(
+      const std::string& msg,
+      std::string& recv_buf,
+      std::vector<size_t>& displs,
+      const NodeComm& nodes,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    allgather(msg.data(), msg.size(), recv_buf, displs, nodes, max_chunk_size);
+  }
+
+  static void allgather(
+      const char* data,
+      const size_t size,
+      std::string& recv_buf,
+      std::vector<size_t>& displs,
+      const NodeComm& nodes,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    if (!nodes.is_hierarchical()) {
+      allgather(data, size, recv_buf, displs, MPI_COMM_WORLD, max_chunk_size);
+      return;
+    }
+    const int n_procs = MpiUtil::get_n_procs();
+    const MPI_Datatype size_t_mpi = MpiType<size_t>::value;
+    MPI_Comm node_comm = nodes.get_node_comm();
+    std::string node_buf;
+    std::vector<size_t> node_displs;
+    allgather(data, size, node_buf, node_displs, node_comm, max_chunk_size);
+
+    // The leaders gather the msgs and their sizes in node order.
+    std::string nodes_buf;
+    std::vector<size_t> node_ordered_sizes(n_procs);
+    if (nodes.is_leader()) {
+      std::vector<size_t> nodes_displs;
+      allgather(node_buf, nodes_buf, nodes_displs, nodes.get_leader_comm(), max_chunk_size);
+      const int n_nodes = nodes.get_n_nodes();
+      std::vector<int> counts(n_nodes, 0);
+      std::vector<int> int_displs(n_nodes, 0);
+      for (int i = 0; i < n_procs; i++) counts[nodes.get_node_id(i)]++;
+      for (int i = 1; i < n_nodes; i++) int_displs[i] = int_displs[i - 1] + counts[i - 1];
+      const int node_size = node_displs.size() - 1;
+      std::vector<size_t> node_sizes(node_size);
+      for (int i = 0; i < node_size; i++) node_sizes[i] = node_displs[i + 1] - node_displs[i];
+      MPI_Allgatherv(
+          node_sizes.data(),
+          node_size,
+          size_t_mpi,
+          node_ordered_sizes.data(),
+          counts.data(),
+          int_displs.data(),
+          size_t_mpi,
+          nodes.get_leader_comm());
+    }
+    broadcast(nodes_buf, 0, node_comm, max_chunk_size);
+    MPI_Bcast(node_ordered_sizes.data(), n_procs, size_t_mpi, 0, node_comm);
+
+    // Lay the msgs out by proc.
+    const auto& node_ordered_proc_ids = nodes.get_node_ordered_proc_ids();
+    displs.assign(n_procs + 1, 0);
+    for (int i = 0; i < n_procs; i++) displs[node_ordered_proc_ids[i] + 1] = node_ordered_sizes[i];
+    for (int i = 0; i < n_procs; i++) displs[i + 1] += displs[i];
+    if (std::is_sorted(node_ordered_proc_ids.begin(), node_ordered_proc_ids.end())) {
+      recv_buf.swap(nodes_buf);
+      return;
+    }
+    recv_buf.resize(displs[n_procs]);
+    size_t pos = 0;
+    for (int i = 0; i < n_procs; i++) {
+      const size_t size = node_ordered_sizes[i];
+      std::copy(
+          nodes_buf.begin() + pos,
+          nodes_buf.begin() + pos + size,
+          recv_buf.begin() + displs[node_ordered_proc_ids[i]]);
+      pos += size;
+    }
+  }
+
+  // Reduces count values of the type with the op into recv_data on the root, or on all procs if
+  // root is negative. Reduced in chunks of at most max_chunk_size values.
+  static void reduce(
+      const void* send_data,
+      void* recv_data,
+      const size_t count,
+      MPI_Datatype type,
+      MPI_Op op,
+      const int root,
+      MPI_Comm comm = MPI_COMM_WORLD,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    int type_size;
+    MPI_Type_size(type, &type_size);
+    const char* send_ptr = static_cast<const char*>(send_data);
+    char* recv_ptr = static_cast<char*>(recv_data);
+    size_t pos = 0;
+    do {
+      const int chunk_count = std::min(max_chunk_size, count - pos);
+      const size_t offset = pos * type_size;
+      char* recv_chunk = recv_ptr == nullptr ? nullptr : recv_ptr + offset;
+      if (root < 0) {
+        MPI_Allreduce(send_ptr + offset, recv_chunk, chunk_count, type, op, comm);
+      } else {
+        MPI_Reduce(send_ptr + offset, recv_chunk, chunk_count, type, op, root, comm);
+      }
+      pos += chunk_count;
+    } while (pos < count);
+  }
+
+  // Same as reduce into all procs, but reduces within each node, then across the leaders, and then
+  // broadcasts within each node.
+  static void reduce(
+      const void* send_data,
+      void* recv_data,
+      const size_t count,
+      MPI_Datatype type,
+      MPI_Op op,
+      const NodeComm& nodes,
+      const size_t max_chunk_size = MAX_CHUNK_SIZE) {
+    if (!nodes.is_hierarchical()) {
+      reduce(send_data, recv_data, count, type, op, -1, MPI_COMM_WORLD, max_chunk_size);
+      return;
+    }
+    int type_size;
+    MPI_Type_size(type, &type_size);
+    MPI_Comm node_comm = nodes.get_node_comm();
+    std::vector<char> node_data(nodes.is_leader() ? count * type_size : 0);
+    reduce(send_data, node_data.data(), count, type, op, 0, node_comm, max_chunk_size);
+    if (nodes.is_leader()) {
+      reduce(
+          node_data.data(),
+          recv_data,
+          count,
+          type,
+          op,
+          -1,
+          nodes.get_leader_comm(),
+          max_chunk_size);
+    }
+    broadcast(static_cast<char*>(recv_data), count * type_size, 0, node_comm, max_chunk_size);
+  }
+
+  // Post the chunks of a message without waiting for them.
+  static void isend(
+      const char* data,
+      const size_t size,
+      const int dest_proc_id,
+      MPI_Comm comm,
+      const size_t max_chunk_size,
+      std::vector<MPI_Request>& reqs) {
+    for (size_t pos = 0; pos < size; pos += max_chunk_size) {
+      const int chunk_size = std::min(max_chunk_size, size - pos);
+      reqs.emplace_back();
+      MPI_Isend(data + pos, chunk_size, MPI_CHAR, dest_proc_id, 1, comm, &reqs.back());
+    }
+  }
+
+  static void irecv(
+      char* data,
+      const size_t size,
+      const int src_proc_id,
+      MPI_Comm comm,
+      const size_t max_chunk_size,
+      std::vector<MPI_Request>& reqs) {
+    for (size_t pos = 0; pos < size; pos += max_chunk_size) {
+      const int chunk_size = std::min(max_chunk_size, size - pos);
+      reqs.emplace_back();
+      MPI_Irecv(data + pos, chunk_size, MPI_CHAR, src_proc_id, 1, comm, &reqs.back());
+    }
+  }
+
+ private:
+  static void ibcast(
+      char* data,
+      const size_t size,
+      const int root,
+      MPI_Comm comm,
+      const size_t max_chunk_size,
+      std::vector<MPI_Request>& reqs) {
+    for (size_t pos = 0; pos < size; pos += max_chunk_size) {
+      const int chunk_size = std::min(max_chunk_size, size - pos);
+      reqs.emplace_back();
+      MPI_Ibcast(data + pos, chunk_size, MPI_CHAR, root, comm, &reqs.back());
+    }
+  }
+};
+
+}  // namespace internal
+}  // namespace blaze
+
+#endif
@@ -1,14 +1,21 @@
 #ifndef BLAZE_VECTOR_UTIL_H_
 #define BLAZE_VECTOR_UTIL_H_
 
+#include <omp.h>
+#include <algorithm>
 #include <functional>
 #include <string>
 #include <vector>
 
-#include "../broadcast.h"
+#include "../../vendor/hps/src/hps.h"
+#include "exchange_util.h"
+#include "hash/hash_map.h"
 #include "mapreduce_util.h"
 #include "mpi_type.h"
 #include "mpi_util.h"
+#include "node_comm.h"
+#include "object_transport.h"
+#include "transport.h"
 
 namespace blaze {
 namespace internal {
@@ -18,23 +25,112 @@ class VectorMapreduceWrapper {
  public:
   VectorMapreduceWrapper(std::vector<VD>& target);
 
-  void async_set(
-      const size_t key, const VD& value, const std::function<void(VD&, const VD&)>& reducer);
+  template <class R>
+  void async_set(const size_t key, const VD& value, const R& reducer);
 
-  void sync(const std::function<void(VD&, const VD&)>& reducer);
+  template <class R, class = EnableIfReducerFunc<R>>
+  void sync(const R& reducer);
 
   void sync(const std::string& reducer);
 
+  // Reduces into the target on the root only. The targets on the other procs are left unchanged.
+  template <class R, class = EnableIfReducerFunc<R>>
+  void reduce(const R& reducer, const int root);
+
+  void reduce(const std::string& reducer, const int root);
+
+  // Reduces the thread results into the dense result of this proc.
+  void sync_local(const std::function<void(VD&, const VD&)>& reducer);
+
+  // The dense result of this proc, which callers may also reduce across procs themselves.
+  std::vector<VD>& get_res_local() { return res_local; }
+
+  // Reduces the dense result of this proc into the target.
+  void reduce_into_target(const std::function<void(VD&, const VD&)>& reducer);
+
+  // Whether the vector is large enough for threads to accumulate sparsely.
+  bool allows_sparse() const { return max_n_sparse_keys > 0; }
+
+  // Reduces the results of all procs of the comm into the result of each proc over a binomial
+  // tree and a broadcast from proc 0, in log(n_procs) rounds that each move the whole vector.
+  void allreduce_tree(
+      const std::function<void(VD&, const VD&)>& reducer, MPI_Comm comm = MPI_COMM_WORLD);
+
+  // Reduces the results of all procs of the comm into the result of each proc with a reduce
+  // scatter and an allgather over a ring, in 2 (n_procs - 1) rounds that each move 1 / n_procs of
+  // the vector. Requires a commutative reducer.
+  void allreduce_ring(
+      const std::function<void(VD&, const VD&)>& reducer, MPI_Comm comm = MPI_COMM_WORLD);
+
+  // Reduces the results of all procs into the result of each proc within each node, then across
+  // the node leaders, and then broadcasts within each node, so that only the leaders send over
+  // the network.
+  void allreduce_nodes(const std::function<void(VD&, const VD&)>& reducer, const NodeComm& nodes);
+
  private:
+  constexpr static int ALL_PROCS = -1;
+
+  // Vectors from this size on are reduced over the ring, where the bandwidth outweighs the rounds.
+  constexpr static size_t RING_MIN_BYTES = 1 << 18;
+
+  // Vectors from this size on start each thread on a hash map of the keys it touches, which it
+  // keeps while it touches at most one in N_KEYS_PER_SPARSE_KEY keys.
+  constexpr static size_t SPARSE_MIN_KEYS = 1 << 16;
+
+  constexpr static size_t N_KEYS_PER_SPARSE_KEY = 16;
+
+  template <class R>
+  void densify(const int thread_id, const R& reducer);
+
+  // Reduces into the target on the root, or on all procs for ALL_PROCS.
+  // Reduces with MPI_Reduce or MPI_Allreduce if op is not MPI_OP_NULL.
+  void reduce_to(
+      const std::function<void(VD&, const VD&)>& reducer,
+      MPI_Op op,
+      MPI_Datatype type,
+      const bool is_commutative,
+      const int root);
+
+  // Collective. Merges and exchanges only the touched keys if all threads on all procs stayed
+  // sparse and the reducer is commutative, into the dense result of the root. Returns whether it
+  // did.
+  bool sync_sparse(
+      const std::function<void(VD&, const VD&)>& reducer,
+      const bool is_commutative,
+      const int root);
+
+  // Reduces the results of all procs of the comm into the result of the root over a binomial tree.
+  void reduce_tree(
+      const std::function<void(VD&, const VD&)>& reducer,
+      const int root,
+      MPI_Comm comm = MPI_COMM_WORLD);
+
+  // Reduces over the ring for large vectors and commutative reducers, otherwise over the tree.
+  void allreduce(
+      const std::function<void(VD&, const VD&)>& reducer,
+      const bool is_commutative,
+      MPI_Comm comm);
+
+  void allreduce_nodes(
+      const std::function<void(VD&, const VD&)>& reducer,
+      MPI_Op op,
+      MPI_Datatype type,
+      const bool is_commutative,
+      const NodeComm& nodes);
+
   size_t n_keys;
 
+  // Empty for the threads that are still sparse.
   std::vector<std::vector<VD>> res_threads;
 
+  // Zero if the vector is too small for sparse accumulation.
+  size_t max_n_sparse_keys;
+
+  std::vector<hash::HashMap<size_t, VD>> sparse_res_threads;
+
   std::vector<VD>* target_ptr;
 
   std::vector<VD> res_local;
-
-  void sync_local(const std::function<void(VD&, const VD&)>& reducer);
 };
 
 template <class VD>
@@ -43,101 +139,158 @@ VectorMapreduceWrapper<VD>::VectorMapreduceWrapper(std::vector<VD>& target) {
   const int n_threads = omp_get_max_threads();
 
   res_threads.resize(n_threads);
-  const VD default_value = VD();
-  for (int i = 0; i < n_threads; i++) {
-    res_threads[i].assign(n_keys, default_value);
+  max_n_sparse_keys = n_keys >= SPARSE_MIN_KEYS ? n_keys / N_KEYS_PER_SPARSE_KEY : 0;
+  if (max_n_sparse_keys > 0) {
+    sparse_res_threads.resize(n_threads);
+  } else {
+    const VD default_value = VD();
+    for (int i = 0; i < n_threads; i++) {
+      res_threads[i].assign(n_keys, default_value);
+    }
   }
 
   target_ptr = &target;
 }
 
 template <class VD>
-void VectorMapreduceWrapper<VD>::async_set(
-    const size_t key, const VD& value, const std::function<void(VD&, const VD&)>& reducer) {
+template <class R>
+void VectorMapreduceWrapper<VD>::async_set(const size_t key, const VD& value, const R& reducer) {
   const int thread_id = omp_get_thread_num();
-  reducer(res_threads[thread_id][key], value);
+  auto& res_thread = res_threads[thread_id];
+  if (max_n_sparse_keys == 0 || !res_thread.empty()) {
+    reducer(res_thread[key], value);
+    return;
+  }
+  auto& sparse_res_thread = sparse_res_threads[thread_id];
+  sparse_res_thread.set(key, std::hash<size_t>()(key), value, reducer);
+  if (sparse_res_thread.get_n_keys() > max_n_sparse_keys) densify(thread_id, reducer);
 }
 
 template <class VD>
-void VectorMapreduceWrapper<VD>::sync(const std::function<void(VD&, const VD&)>& reducer) {
-  sync_local(reducer);
+template <class R>
+void VectorMapreduceWrapper<VD>::densify(const int thread_id, const R& reducer) {
+  auto& res_thread = res_threads[thread_id];
+  auto& sparse_res_thread = sparse_res_threads[thread_id];
+  res_thread.assign(n_keys, VD());
+  sparse_res_thread.for_each(
+      [&](const size_t key, const size_t, const VD& value) { reducer(res_thread[key], value); });
+  sparse_res_thread.clear_and_shrink();
+}
 
-  std::vector<VD> res_remote;
+template <class VD>
+bool VectorMapreduceWrapper<VD>::sync_sparse(
+    const std::function<void(VD&, const VD&)>& reducer,
+    const bool is_commutative,
+    const int root) {
+  if (max_n_sparse_keys == 0) return false;
+  const int n_threads = res_threads.size();
+  size_t n_sparse_keys = 0;
+  for (int i = 0; i < n_threads; i++) {
+    if (!res_threads[i].empty()) {
+      n_sparse_keys = n_keys;
+      break;
+    }
+    n_sparse_keys += sparse_res_threads[i].get_n_keys();
+  }
+  if (!is_commutative) n_sparse_keys = n_keys;
+  size_t n_sparse_keys_total = 0;
+  MPI_Allreduce(
+      &n_sparse_keys, &n_sparse_keys_total, 1, MpiType<size_t>::value, MPI_SUM, MPI_COMM_WORLD);
+  if (n_sparse_keys_total > max_n_sparse_keys) return false;
+
+  hash::HashMap<size_t, VD> res_sparse;
+  const auto& merge_into_res_sparse = [&](
+      const size_t key, const size_t hash_value, const VD& value) {
+    res_sparse.set(key, hash_value, value, reducer);
+  };
+  for (auto& sparse_res_thread : sparse_res_threads) {
+    sparse_res_thread.for_each(merge_into_res_sparse);
+    sparse_res_thread.clear();
+  }
 
-  // Cross-node tree reduce.
-  int step = 1;
-  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
-  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
-  const int BUF_SIZE = 1 << 20;
-  std::string msg_buf;
-  char msg_buf_char[BUF_SIZE];
-  size_t msg_size = 0;
-  while (step < n_procs) {
-    if ((proc_id & (step >> 1)) != 0) break;
-    bool is_receiver = (proc_id & step) == 0;
-    size_t pos = 0;
-    msg_buf.clear();
-
-    if (is_receiver && proc_id + step < n_procs) {
-      // Get size.
-      MPI_Recv(
-          &msg_size,
-          1,
-          internal::MpiType<size_t>::value,
-          proc_id + step,
-          0,
-          MPI_COMM_WORLD,
-          MPI_STATUS_IGNORE);
-      msg_buf.reserve(msg_size);
-
-      // Get data.
-      while (pos + BUF_SIZE <= msg_size) {
-        MPI_Recv(
-            msg_buf_char, BUF_SIZE, MPI_CHAR, proc_id + step, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        msg_buf.append(msg_buf_char, BUF_SIZE);
-        pos += BUF_SIZE;
-      }
-      if (pos < msg_size) {
-        MPI_Recv(
-            msg_buf_char,
-            msg_size - pos,
-            MPI_CHAR,
-            proc_id + step,
-            0,
-            MPI_COMM_WORLD,
-            MPI_STATUS_IGNORE);
-        msg_buf.append(msg_buf_char, msg_size - pos);
-      }
+  std::string msg;
+  hps::to_string(res_sparse, msg);
+  const auto& merge = [&](std::string& merged_msg, const std::string& remote_msg) {
+    hash::HashMap<size_t, VD> res_remote;
+    hps::from_string(merged_msg, res_sparse);
+    hps::from_string(remote_msg, res_remote);
+    res_remote.for_each(merge_into_res_sparse);
+    hps::to_string(res_sparse, merged_msg);
+  };
+  if (root == ALL_PROCS) {
+    ExchangeUtil::allreduce(msg, merge);
+  } else {
+    ExchangeUtil::reduce(msg, merge, root);
+    if (MpiUtil::get_proc_id() != root) return true;
+  }
+  hps::from_string(msg, res_sparse);
+
+  // Only the messages are sparse. The untouched keys reduce the default value into the target,
+  // as they do from dense results.
+  res_local.assign(n_keys, VD());
+  res_sparse.for_each(
+      [&](const size_t key, const size_t, const VD& value) { reducer(res_local[key], value); });
+  return true;
+}
 
-      // Parse data.
-      hps::from_string(msg_buf, res_remote);
+template <class VD>
+template <class R, class>
+void VectorMapreduceWrapper<VD>::sync(const R& reducer) {
+  reduce(reducer, ALL_PROCS);
+}
 
-      // Reduce.
-      for (size_t i = 0; i < n_keys; i++) reducer(res_local[i], res_remote[i]);
-    } else {
-      hps::to_string(res_local, msg_buf);
+template <class VD>
+void VectorMapreduceWrapper<VD>::sync(const std::string& reducer) {
+  reduce(reducer, ALL_PROCS);
+}
 
-      // Send size.
-      msg_size = msg_buf.size();
-      MPI_Send(&msg_size, 1, internal::MpiType<size_t>::value, proc_id - step, 0, MPI_COMM_WORLD);
+template <class VD>
+template <class R, class>
+void VectorMapreduceWrapper<VD>::reduce(const R& reducer, const int root) {
+  MPI_Op op = MPI_OP_NULL;
+  MPI_Datatype type = MPI_DATATYPE_NULL;
+  MapreduceUtil::get_mpi_op<VD>(reducer, op, type);
+  reduce_to(reducer, op, type, MapreduceUtil::is_commutative<VD>(reducer), root);
+}
 
-      // Send data.
-      while (pos + BUF_SIZE <= msg_size) {
-        msg_buf.copy(msg_buf_char, BUF_SIZE, pos);
-        MPI_Send(msg_buf_char, BUF_SIZE, MPI_CHAR, proc_id - step, 0, MPI_COMM_WORLD);
-        pos += BUF_SIZE;
-      }
-      if (pos < msg_size) {
-        msg_buf.copy(msg_buf_char, msg_size - pos, pos);
-        MPI_Send(msg_buf_char, msg_size - pos, MPI_CHAR, proc_id - step, 0, MPI_COMM_WORLD);
-      }
-    }
+template <class VD>
+void VectorMapreduceWrapper<VD>::reduce(const std::string& reducer, const int root) {
+  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
+  MPI_Op op = MPI_OP_NULL;
+  MPI_Datatype type = MPI_DATATYPE_NULL;
+  MapreduceUtil::get_mpi_op<VD>(reducer, op, type);
+  reduce_to(reducer_func, op, type, MapreduceUtil::is_commutative<VD>(reducer_func), root);
+}
 
-    step <<= 1;
+template <class VD>
+void VectorMapreduceWrapper<VD>::reduce_to(
+    const std::function<void(VD&, const VD&)>& reducer,
+    MPI_Op op,
+    MPI_Datatype type,
+    const bool is_commutative,
+    const int root) {
+  const bool is_root = root == ALL_PROCS || MpiUtil::get_proc_id() == root;
+  if (!sync_sparse(reducer, is_commutative, root)) {
+    sync_local(reducer);
+    const NodeComm& nodes = NodeComm::get_instance();
+    if (root == ALL_PROCS && nodes.is_hierarchical()) {
+      allreduce_nodes(reducer, op, type, is_commutative, nodes);
+    } else if (op != MPI_OP_NULL) {
+      std::vector<VD> res(is_root ? n_keys : 0);
+      Transport::reduce(res_local.data(), res.data(), n_keys, type, op, root);
+      res_local.swap(res);
+    } else if (root != ALL_PROCS) {
+      reduce_tree(reducer, root);
+    } else {
+      allreduce(reducer, is_commutative, MPI_COMM_WORLD);
+    }
   }
+  if (is_root) reduce_into_target(reducer);
+}
 
-  blaze::broadcast(res_local);
-
+template <class VD>
+void VectorMapreduceWrapper<VD>::reduce_into_target(
+    const std::function<void(VD&, const VD&)>& reducer) {
 #pragma omp parallel for schedule(static)
   for (size_t i = 0; i < n_keys; i++) {
     reducer(target_ptr->at(i), res_local[i]);
@@ -145,50 +298,158 @@ void VectorMapreduceWrapper<VD>::sync(const std::function<void(VD&, const VD&)>&
 }
 
 template <class VD>
-void VectorMapreduceWrapper<VD>::sync(const std::string& reducer) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
+void VectorMapreduceWrapper<VD>::allreduce(
+    const std::function<void(VD&, const VD&)>& reducer,
+    const bool is_commutative,
+    MPI_Comm comm) {
+  const int n_procs = MpiUtil::get_n_procs(comm);
+  if (n_procs > 1 && n_keys * sizeof(VD) >= RING_MIN_BYTES && n_keys >= size_t(n_procs) &&
+      is_commutative) {
+    allreduce_ring(reducer, comm);
+  } else {
+    allreduce_tree(reducer, comm);
+  }
+}
 
-  sync_local(reducer_func);
+template <class VD>
+void VectorMapreduceWrapper<VD>::allreduce_nodes(
+    const std::function<void(VD&, const VD&)>& reducer, const NodeComm& nodes) {
+  MPI_Op op = MPI_OP_NULL;
+  MPI_Datatype type = MPI_DATATYPE_NULL;
+  MapreduceUtil::get_mpi_op<VD>(reducer, op, type);
+  allreduce_nodes(reducer, op, type, MapreduceUtil::is_commutative<VD>(reducer), nodes);
+}
 
-  std::vector<VD> res(n_keys);
+template <class VD>
+void VectorMapreduceWrapper<VD>::allreduce_nodes(
+    const std::function<void(VD&, const VD&)>& reducer,
+    MPI_Op op,
+    MPI_Datatype type,
+    const bool is_commutative,
+    const NodeComm& nodes) {
+  if (op != MPI_OP_NULL) {
+    std::vector<VD> res(n_keys);
+    Transport::reduce(res_local.data(), res.data(), n_keys, type, op, nodes);
+    res_local.swap(res);
+    return;
+  }
 
-  // Cross-node tree reduce.
-  MPI_Allreduce(
-      res_local.data(),
-      res.data(),
-      n_keys,
-      MpiType<VD>::value,
-      MapreduceUtil::get_mpi_op(reducer),
-      MPI_COMM_WORLD);
+  MPI_Comm node_comm = nodes.get_node_comm();
+  reduce_tree(reducer, 0, node_comm);
+  if (nodes.is_leader()) allreduce(reducer, is_commutative, nodes.get_leader_comm());
+  ObjectTransport::broadcast(res_local, 0, node_comm);
+}
 
+template <class VD>
+void VectorMapreduceWrapper<VD>::allreduce_tree(
+    const std::function<void(VD&, const VD&)>& reducer, MPI_Comm comm) {
+  reduce_tree(reducer, 0, comm);
+  if (MpiUtil::get_n_procs(comm) == 1) return;
+  ObjectTransport::broadcast(res_local, 0, comm);
+}
+
+template <class VD>
+void VectorMapreduceWrapper<VD>::reduce_tree(
+    const std::function<void(VD&, const VD&)>& reducer, const int root, MPI_Comm comm) {
+  const int n_procs = MpiUtil::get_n_procs(comm);
+  const int rank = (MpiUtil::get_proc_id(comm) + n_procs - root) % n_procs;
+  std::vector<VD> res_remote;
+  int step = 1;
+  while (step < n_procs) {
+    if ((rank & (step >> 1)) != 0) break;
+    const bool is_receiver = (rank & step) == 0;
+    if (is_receiver && rank + step < n_procs) {
+      ObjectTransport::recv(res_remote, (rank + step + root) % n_procs, comm);
+      for (size_t i = 0; i < n_keys; i++) reducer(res_local[i], res_remote[i]);
+    } else if (!is_receiver) {
+      ObjectTransport::send(res_local, (rank - step + root) % n_procs, comm);
+    }
+    step <<= 1;
+  }
+}
+
+template <class VD>
+void VectorMapreduceWrapper<VD>::allreduce_ring(
+    const std::function<void(VD&, const VD&)>& reducer, MPI_Comm comm) {
+  const int n_procs = MpiUtil::get_n_procs(comm);
+  const int proc_id = MpiUtil::get_proc_id(comm);
+  const int next_proc_id = (proc_id + 1) % n_procs;
+  const int prev_proc_id = (proc_id + n_procs - 1) % n_procs;
+  const auto& get_block_begin = [&](const int block) { return n_keys * block / n_procs; };
+  std::vector<VD> send_values;
+  std::vector<VD> block_values;
+
+  // Reduce scatter. Each step passes one block on to the next proc, which reduces it into its own.
+  // Afterwards, block proc_id + 1 is fully reduced on this proc.
+  for (int step = 0; step < n_procs - 1; step++) {
+    const int send_block = (proc_id + n_procs - step) % n_procs;
+    const int recv_block = (proc_id + n_procs - step - 1) % n_procs;
+    send_values.assign(
+        res_local.begin() + get_block_begin(send_block),
+        res_local.begin() + get_block_begin(send_block + 1));
+    ObjectTransport::send_recv(send_values, next_proc_id, block_values, prev_proc_id, comm);
+    const size_t begin = get_block_begin(recv_block);
+    const size_t n_block_keys = block_values.size();
 #pragma omp parallel for schedule(static)
-  for (size_t i = 0; i < n_keys; i++) {
-    reducer_func(target_ptr->at(i), res[i]);
+    for (size_t i = 0; i < n_block_keys; i++) reducer(res_local[begin + i], block_values[i]);
+  }
+
+  // Allgather. Each step passes one fully reduced block on to the next proc.
+  for (int step = 0; step < n_procs - 1; step++) {
+    const int send_block = (proc_id + 1 + n_procs - step) % n_procs;
+    const int recv_block = (proc_id + n_procs - step) % n_procs;
+    send_values.assign(
+        res_local.begin() + get_block_begin(send_block),
+        res_local.begin() + get_block_begin(send_block + 1));
+    ObjectTransport::send_recv(send_values, next_proc_id, block_values, prev_proc_id, comm);
+    std::copy(
+        block_values.begin(), block_values.end(), res_local.begin() + get_block_begin(recv_block));
   }
 }
 
 template <class VD>
 void VectorMapreduceWrapper<VD>::sync_local(const std::function<void(VD&, const VD&)>& reducer) {
-  // Node reduce.
+  // Node reduce over the dense thread results, then the sparse ones.
+  const int n_threads = res_threads.size();
+  std::vector<int> dense_thread_ids;
+  for (int i = 0; i < n_threads; i++) {
+    if (!res_threads[i].empty()) dense_thread_ids.push_back(i);
+  }
+  const int n_dense_threads = dense_thread_ids.size();
   int step = 1;
-  const int n_threads = omp_get_max_threads();
-  while (step < n_threads) {
-    int i_end = n_threads - step;
+  while (step < n_dense_threads) {
+    int i_end = n_dense_threads - step;
     int i_step = step << 1;
 #pragma omp parallel for schedule(static, 1)
     for (int i = 0; i < i_end; i += i_step) {
+      auto& res_thread = res_threads[dense_thread_ids[i]];
+      const auto& res_thread_other = res_threads[dense_thread_ids[i + step]];
       for (size_t j = 0; j < n_keys; j++) {
-        reducer(res_threads[i][j], res_threads[i + step][j]);
+        reducer(res_thread[j], res_thread_other[j]);
       }
     }
     step <<= 1;
   }
 
-  res_local = res_threads[0];
-
   const VD default_value = VD();
+  if (n_dense_threads > 0) {
+    res_local = res_threads[dense_thread_ids[0]];
+  } else {
+    res_local.assign(n_keys, default_value);
+  }
+  for (auto& sparse_res_thread : sparse_res_threads) {
+    sparse_res_thread.for_each(
+        [&](const size_t key, const size_t, const VD& value) { reducer(res_local[key], value); });
+    sparse_res_thread.clear();
+  }
+
+  // Threads start sparse again if the vector is large enough.
   for (int i = 0; i < n_threads; i++) {
-    res_threads[i].assign(n_keys, default_value);
+    if (max_n_sparse_keys > 0) {
+      std::vector<VD>().swap(res_threads[i]);
+    } else {
+      res_threads[i].assign(n_keys, default_value);
+    }
   }
 }
 }
@@ -1,192 +1,268 @@
 #ifndef BLAZE_MAPREDUCE_H_
 #define BLAZE_MAPREDUCE_H_
 
+#include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include "dist_hash_map_mapreducer.h"
 #include "dist_range_mapreducer.h"
+#include "dist_text_file.h"
+#include "dist_text_stream.h"
 #include "dist_vector_mapreducer.h"
 #include "internal/mapreduce_util.h"
+#include "internal/output_sink.h"
+#include "internal/pipeline_stage.h"
+#include "internal/vector_mapreduce_wrapper.h"
+#include "mapreduce_output.h"
+#include "reducer_registry.h"
+#include "string_view.h"
 
 namespace blaze {
 
+// The mapper and the reducer are taken as template parameters so that lambdas are inlined into the
+// loop over the source. Reducer names ("sum", "max", etc.) are resolved into inlinable functors.
+// Emit signature: void(const size_t key, const VD& value) or void(const KD& key, const VD& value).
+
 // From dist range source.
-template <class VS, class VD>
+// Mapper: void(const VS value, const auto& emit).
+template <class VS, class VD, class M>
 void mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::string& reducer,
-    std::vector<VD>& dest) {
+    DistRange<VS>& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
   DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class VD>
-void mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    std::vector<VD>& dest) {
+template <class VS, class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistRange<VS>& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
   DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class VD>
+template <class VS, class VD, class M>
 void mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::string& reducer,
-    blaze::DistVector<VD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+    DistRange<VS>& source, const M& mapper, const std::string& reducer, DistVector<VD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class VS, class VD>
-void mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    blaze::DistVector<VD>& dest) {
+template <class VS, class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistRange<VS>& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
   DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class KD, class VD, class HD = std::hash<KD>>
+template <class VS, class KD, class VD, class HD = std::hash<KD>, class M>
 void mapreduce(
     DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const KD&, const VD&)>& emit)>& mapper,
+    const M& mapper,
     const std::string& reducer,
     DistHashMap<KD, VD, HD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class VS, class KD, class VD, class HD = std::hash<KD>>
+template <class VS,
+          class KD,
+          class VD,
+          class HD = std::hash<KD>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
-    DistRange<VS>& source,
-    const std::function<
-        void(const VS value, const std::function<void(const KD&, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    DistHashMap<KD, VD, HD>& dest) {
+    DistRange<VS>& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
   DistRangeMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
 // From dist vector source.
-template <class VS, class VD>
+// Mapper: void(const size_t key, const VS& value, const auto& emit).
+template <class VS, class VD, class M>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::string& reducer,
-    std::vector<VD>& dest) {
+    DistVector<VS>& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
   DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class VD>
+template <class VS, class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistVector<VS>& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
+  DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class VS, class VD, class M>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    std::vector<VD>& dest) {
+    DistVector<VS>& source, const M& mapper, const std::string& reducer, DistVector<VD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  });
+}
+
+template <class VS, class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistVector<VS>& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
   DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class VD>
+template <class VS, class KD, class VD, class HD = std::hash<KD>, class M>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
+    DistVector<VS>& source,
+    const M& mapper,
     const std::string& reducer,
-    blaze::DistVector<VD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+    DistHashMap<KD, VD, HD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class VS, class VD>
+template <class VS,
+          class KD,
+          class VD,
+          class HD = std::hash<KD>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key,
-        const VS& value,
-        const std::function<void(const size_t, const VD&)>& emit)>& mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    blaze::DistVector<VD>& dest) {
+    DistVector<VS>& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
   DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class VS, class KD, class VD, class HD = std::hash<KD>>
+// From dist text file source.
+// Mapper: void(const size_t line_id, const StringView& line, const auto& emit).
+template <class VD, class M>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key, const VS& value, const std::function<void(const KD&, const VD&)>& emit)>&
-        mapper,
+    DistTextFile& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
+  DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistTextFile& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
+  DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class VD, class M>
+void mapreduce(
+    DistTextFile& source, const M& mapper, const std::string& reducer, DistVector<VD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer_func, dest);
+  });
+}
+
+template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistTextFile& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
+  DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class KD, class VD, class HD = std::hash<KD>, class M>
+void mapreduce(
+    DistTextFile& source,
+    const M& mapper,
     const std::string& reducer,
     DistHashMap<KD, VD, HD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer_func, dest);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class VS, class KD, class VD, class HD = std::hash<KD>>
+template <class KD,
+          class VD,
+          class HD = std::hash<KD>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
-    blaze::DistVector<VS>& source,
-    const std::function<void(
-        const size_t key, const VS& value, const std::function<void(const KD&, const VD&)>& emit)>&
-        mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
+    DistTextFile& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
+  DistVectorMapreducer<StringView, DistTextFile>::mapreduce(source, mapper, reducer, dest);
+}
+
+// From dist text stream source.
+// Mapper: void(const StringView& line, const auto& emit).
+template <class VD, class M>
+void mapreduce(
+    DistTextStream& source, const M& mapper, const std::string& reducer, std::vector<VD>& dest) {
+  DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistTextStream& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
+  DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class VD, class M>
+void mapreduce(
+    DistTextStream& source, const M& mapper, const std::string& reducer, DistVector<VD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer_func, dest);
+  });
+}
+
+template <class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce(DistTextStream& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
+  DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer, dest);
+}
+
+template <class KD, class VD, class HD = std::hash<KD>, class M>
+void mapreduce(
+    DistTextStream& source,
+    const M& mapper,
+    const std::string& reducer,
     DistHashMap<KD, VD, HD>& dest) {
-  DistVectorMapreducer<VS>::mapreduce(source, mapper, reducer, dest);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer_func, dest);
+  });
+}
+
+template <class KD,
+          class VD,
+          class HD = std::hash<KD>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
+void mapreduce(
+    DistTextStream& source, const M& mapper, const R& reducer, DistHashMap<KD, VD, HD>& dest) {
+  DistRangeMapreducer<StringView, DistTextStream>::mapreduce(source, mapper, reducer, dest);
 }
 
 // From dist hash map source.
-template <class KS, class VS, class VD, class HS = std::hash<KS>>
+// Mapper: void(const KS& key, const VS& value, const auto& emit).
+template <class KS, class VS, class VD, class HS = std::hash<KS>, class M>
 void mapreduce(
     DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const size_t, const VD&)>& emit)>&
-        mapper,
+    const M& mapper,
     const std::string& reducer,
     std::vector<VD>& dest) {
   DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class KS, class VS, class VD, class HS = std::hash<KS>>
+template <class KS,
+          class VS,
+          class VD,
+          class HS = std::hash<KS>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
-    DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const size_t, const VD&)>& emit)>&
-        mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    std::vector<VD>& dest) {
+    DistHashMap<KS, VS, HS>& source, const M& mapper, const R& reducer, std::vector<VD>& dest) {
   DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer, dest);
 }
 
-template <class KS, class VS, class VD, class HS = std::hash<KS>>
+template <class KS, class VS, class VD, class HS = std::hash<KS>, class M>
 void mapreduce(
     DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const size_t, const VD&)>& emit)>&
-        mapper,
+    const M& mapper,
     const std::string& reducer,
-    blaze::DistVector<VD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer_func, dest);
+    DistVector<VD>& dest) {
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class KS, class VS, class VD, class HS = std::hash<KS>>
+template <class KS,
+          class VS,
+          class VD,
+          class HS = std::hash<KS>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
-    DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const size_t, const VD&)>& emit)>&
-        mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
-    blaze::DistVector<VD>& dest) {
+    DistHashMap<KS, VS, HS>& source, const M& mapper, const R& reducer, DistVector<VD>& dest) {
   DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer, dest);
 }
 
@@ -195,34 +271,81 @@ template <class KS,
           class KD,
           class VD,
           class HS = std::hash<KS>,
-          class HD = std::hash<KD>>
+          class HD = std::hash<KD>,
+          class M>
 void mapreduce(
     DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const KD&, const VD&)>& emit)>&
-        mapper,
+    const M& mapper,
     const std::string& reducer,
     DistHashMap<KD, VD, HD>& dest) {
-  const auto& reducer_func = internal::MapreduceUtil::get_reducer_func<VD>(reducer);
-  DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer_func, dest);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer_func, dest);
+  });
 }
 
-template <class KS,
-          class VS,
+template <class KS, class VS,
           class KD,
           class VD,
           class HS = std::hash<KS>,
-          class HD = std::hash<KD>>
+          class HD = std::hash<KD>,
+          class M,
+          class R,
+          class = internal::EnableIfReducerFunc<R>>
 void mapreduce(
     DistHashMap<KS, VS, HS>& source,
-    const std::function<void(
-        const KS& key, const VS& value, const std::function<void(const KD&, const VD&)>& emit)>&
-        mapper,
-    const std::function<void(VD&, const VD&)>& reducer,
+    const M& mapper,
+    const R& reducer,
     DistHashMap<KD, VD, HD>& dest) {
   DistHashMapMapreducer<KS, VS, HS>::mapreduce(source, mapper, reducer, dest);
 }
 
+// Several destinations in a single pass over the source, e.g.
+// mapreduce(source, mapper, output("sum", vec), output(Reducer<double>::max, dist_vec)).
+// Mapper: void(record..., const auto& emit_1, ..., const auto& emit_n), with one emit per output.
+// The record is (value) for DistRange, (line_id, line) for DistTextFile, (line) for
+// DistTextStream, and (key, value) for DistVector and DistHashMap sources.
+// All DistVector and DistHashMap destinations are synced in one exchange. The std::vector
+// destinations too small for sparse accumulation whose reducers have the same MPI op share one
+// reduction, and the others reduce one by one as they would in their own mapreduce.
+template <class S, class M, class... R, class... D>
+void mapreduce(S& source, const M& mapper, const MapreduceOutput<R, D>&... outputs) {
+  internal::OutputSinkUtil::mapreduce(source, mapper, outputs...);
+}
+
+// Reduces into dest on the root proc only, for when the other procs do not need the result.
+// This skips the broadcast of the result and leaves dest on the other procs unchanged.
+// Source: DistRange, DistTextFile, DistTextStream, DistVector or DistHashMap, with the mapper as
+// for mapreduce.
+template <class S, class VD, class M>
+void mapreduce_to_root(
+    S& source,
+    const M& mapper,
+    const std::string& reducer,
+    std::vector<VD>& dest,
+    const int root = 0) {
+  internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
+  internal::MapreduceUtil::visit_reducer_func<VD>(reducer, [&](const auto& reducer_func) {
+    const auto& emit = [&](const size_t key, const VD& value) {
+      dest_wrapper.async_set(key, value, reducer_func);
+    };
+    const auto& handler = [&](const auto&... record) { mapper(record..., emit); };
+    internal::PipelineSource<S>::for_each(source, handler);
+  });
+  dest_wrapper.reduce(reducer, root);
+}
+
+template <class S, class VD, class M, class R, class = internal::EnableIfReducerFunc<R>>
+void mapreduce_to_root(
+    S& source, const M& mapper, const R& reducer, std::vector<VD>& dest, const int root = 0) {
+  internal::VectorMapreduceWrapper<VD> dest_wrapper(dest);
+  const auto& emit = [&](const size_t key, const VD& value) {
+    dest_wrapper.async_set(key, value, reducer);
+  };
+  const auto& handler = [&](const auto&... record) { mapper(record..., emit); };
+  internal::PipelineSource<S>::for_each(source, handler);
+  dest_wrapper.reduce(reducer, root);
+}
+
 }  // namespace blaze
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef BLAZE_MAPREDUCE_OUTPUT_H_
+#define BLAZE_MAPREDUCE_OUTPUT_H_
+
+#include <string>
+#include <type_traits>
+
+#include "internal/mapreduce_util.h"
+
+namespace blaze {
+
+// One (reducer, destination) pair of a multi-output mapreduce.
+template <class R, class D>
+class MapreduceOutput {
+ public:
+  MapreduceOutput(const R& reducer, D& dest) : reducer(reducer), dest(dest) {}
+
+  R reducer;
+
+  D& dest;
+};
+
+// Reducer: a name such as "sum" or a void(VD&, const VD&) callable.
+// Dest: a std::vector, DistVector or DistHashMap.
+template <class D>
+MapreduceOutput<std::string, D> output(const std::string& reducer, D& dest) {
+  return MapreduceOutput<std::string, D>(reducer, dest);
+}
+
+// Reducer functions are stored as function pointers.
+template <class R, class D, class = internal::EnableIfReducerFunc<R>>
+MapreduceOutput<typename std::decay<R>::type, D> output(const R& reducer, D& dest) {
+  return MapreduceOutput<typename std::decay<R>::type, D>(reducer, dest);
+}
+
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef BLAZE_PIPELINE_H_
+#define BLAZE_PIPELINE_H_
+
+#include "internal/pipeline_stage.h"
+#include "mapreduce.h"
+
+namespace blaze {
+
+// A lazy chain of stages over a DistRange, DistVector or DistHashMap source.
+// map and filter only record their stage. Nothing runs until a terminal call (for_each or
+// reduce), which fuses all recorded stages into a single pass over the source. The only container
+// created along the way is the destination of reduce, where the shuffle happens.
+// Records are (value) for DistRange and (key, value) for DistVector and DistHashMap sources.
+template <class S, class F = internal::IdentityStage>
+class Pipeline {
+ public:
+  Pipeline(S& source, const F& stage = F()) : source(source), stage(stage) {}
+
+  // Mapper: void(const auto&... record, const auto& emit), emitting zero or more records.
+  template <class M>
+  Pipeline<S, internal::MapStage<F, M>> map(const M& mapper) const;
+
+  // Predicate: bool(const auto&... record).
+  template <class P>
+  Pipeline<S, internal::FilterStage<F, P>> filter(const P& predicate) const;
+
+  // Handler: void(const auto&... record), called from multiple threads.
+  template <class G>
+  void for_each(const G& handler) const;
+
+  // Shuffles the (key, value) records into dest, which can be a std::vector, DistVector or
+  // DistHashMap. Reducer: a name such as "sum" or a void(VD&, const VD&) callable.
+  template <class R, class D>
+  void reduce(const R& reducer, D& dest) const;
+
+ private:
+  S& source;
+
+  F stage;
+};
+
+template <class S>
+Pipeline<S> pipeline(S& source) {
+  return Pipeline<S>(source);
+}
+
+template <class S, class F>
+template <class M>
+Pipeline<S, internal::MapStage<F, M>> Pipeline<S, F>::map(const M& mapper) const {
+  return Pipeline<S, internal::MapStage<F, M>>(source, internal::MapStage<F, M>(stage, mapper));
+}
+
+template <class S, class F>
+template <class P>
+Pipeline<S, internal::FilterStage<F, P>> Pipeline<S, F>::filter(const P& predicate) const {
+  return Pipeline<S, internal::FilterStage<F, P>>(
+      source, internal::FilterStage<F, P>(stage, predicate));
+}
+
+template <class S, class F>
+template <class G>
+void Pipeline<S, F>::for_each(const G& handler) const {
+  internal::PipelineSource<S>::for_each(
+      source, [&](const auto&... record) { stage(handler, record...); });
+}
+
+template <class S, class F>
+template <class R, class D>
+void Pipeline<S, F>::reduce(const R& reducer, D& dest) const {
+  mapreduce(source, internal::PipelineSource<S>::get_mapper(stage), reducer, dest);
+}
+
+}  // namespace blaze
+
+#endif
@@ -25,6 +25,16 @@ class Reducer {
   static void overwrite(T& t1, const T& t2) { t1 = t2; }
 };
 
+// Properties a registered reducer declares about itself. Every reducer takes T() as its identity.
+class ReducerTraits {
+ public:
+  // Whether the order of the operands does not matter.
+  bool is_commutative = true;
+
+  // Whether partial results can be grouped in any way, which MPI reductions require.
+  bool is_associative = true;
+};
+
 }  // namespace blaze
 
 #endif
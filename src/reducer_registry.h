@@ -0,0 +1,23 @@
+#ifndef BLAZE_REDUCER_REGISTRY_H_
+#define BLAZE_REDUCER_REGISTRY_H_
+
+#include <string>
+
+#include "internal/reducer_registry.h"
+#include "reducer.h"
+
+namespace blaze {
+
+// Registers F under a name that can be used wherever reducer names such as "sum" are.
+// Associative reducers over trivially copyable types, such as POD structs and std::array, reduce
+// std::vector destinations with MPI_Allreduce, whether passed by name or as F itself.
+// Register on every proc, after MPI is initialized. Registering the same F under the same name
+// again has no effect, and another function under a registered name throws.
+template <class V, void (*F)(V&, const V&)>
+void register_reducer(const std::string& name, const ReducerTraits& traits = ReducerTraits()) {
+  internal::ReducerRegistry<V>::template add<F>(name, traits);
+}
+
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef BLAZE_SHARED_ARRAY_H_
+#define BLAZE_SHARED_ARRAY_H_
+
+#include <memory>
+
+#include "internal/shared_window.h"
+
+namespace blaze {
+
+// Read-only values in memory shared by all procs of a node, such as the result of
+// broadcast_shared. Copies share the memory, which is freed with the last copy. Freeing is
+// collective over the node, so all procs of the node drop their arrays at the same point.
+template <class T>
+class SharedArray {
+ public:
+  SharedArray() : n_values(0) {}
+
+  SharedArray(const std::shared_ptr<internal::SharedWindow>& window, const size_t n_values)
+      : window(window), n_values(n_values) {}
+
+  size_t size() const { return n_values; }
+
+  bool empty() const { return n_values == 0; }
+
+  const T* data() const {
+    return window ? reinterpret_cast<const T*>(window->get_data()) : nullptr;
+  }
+
+  const T& operator[](const size_t i) const { return data()[i]; }
+
+  const T* begin() const { return data(); }
+
+  const T* end() const { return data() + n_values; }
+
+ private:
+  std::shared_ptr<internal::SharedWindow> window;
+
+  size_t n_values;
+};
+
+}  // namespace blaze
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BLAZE_STRING_VIEW_H_
+#define BLAZE_STRING_VIEW_H_
+
+#include <cstring>
+#include <string>
+
+namespace blaze {
+
+// Read-only chars owned elsewhere, such as a line of a memory-mapped file. Valid as long as the
+// owner is.
+class StringView {
+ public:
+  StringView() : ptr(nullptr), n_chars(0) {}
+
+  StringView(const char* data, const size_t size) : ptr(data), n_chars(size) {}
+
+  StringView(const std::string& str) : ptr(str.data()), n_chars(str.size()) {}
+
+  const char* data() const { return ptr; }
+
+  size_t size() const { return n_chars; }
+
+  bool empty() const { return n_chars == 0; }
+
+  char operator[](const size_t i) const { return ptr[i]; }
+
+  const char* begin() const { return ptr; }
+
+  const char* end() const { return ptr + n_chars; }
+
+  std::string to_string() const { return std::string(ptr, n_chars); }
+
+  bool operator==(const StringView& rhs) const {
+    return n_chars == rhs.n_chars && (n_chars == 0 || std::memcmp(ptr, rhs.ptr, n_chars) == 0);
+  }
+
+  bool operator!=(const StringView& rhs) const { return !(*this == rhs); }
+
+ private:
+  const char* ptr;
+
+  size_t n_chars;
+};
+
+}  // namespace blaze
+
+#endif
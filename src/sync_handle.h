@@ -0,0 +1,68 @@
+#ifndef BLAZE_SYNC_HANDLE_H_
+#define BLAZE_SYNC_HANDLE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "internal/async_exchange.h"
+#include "internal/mpi_util.h"
+
+namespace blaze {
+
+// A sync in flight, returned by sync_async. The container must not be used until test returns
+// true or wait returns, which merge the received values into it. Destroying a handle that is still
+// in flight waits for it.
+class SyncHandle {
+ public:
+  // Merge: void(std::vector<std::string>& recv_bufs). The exchange is null if there is nothing to
+  // exchange, in which case the merge gets empty recv bufs.
+  SyncHandle(
+      std::unique_ptr<internal::AsyncExchange> exchange,
+      const std::function<void(std::vector<std::string>&)>& merge)
+      : exchange(std::move(exchange)), merge(merge) {}
+
+  SyncHandle(SyncHandle&& other) : exchange(std::move(other.exchange)), merge(other.merge) {
+    other.merge = nullptr;
+  }
+
+  SyncHandle(const SyncHandle&) = delete;
+
+  SyncHandle& operator=(const SyncHandle&) = delete;
+
+  ~SyncHandle() { wait(); }
+
+  // Whether the sync is complete. Progresses the exchange, and merges once it is complete.
+  bool test() {
+    if (!merge) return true;
+    if (exchange && !exchange->test()) return false;
+    finish();
+    return true;
+  }
+
+  void wait() {
+    if (!merge) return;
+    if (exchange) exchange->wait();
+    finish();
+  }
+
+ private:
+  std::unique_ptr<internal::AsyncExchange> exchange;
+
+  // Empty once merged.
+  std::function<void(std::vector<std::string>&)> merge;
+
+  void finish() {
+    std::vector<std::string> recv_bufs(internal::MpiUtil::get_n_procs());
+    if (exchange) recv_bufs.swap(exchange->get_recv_bufs());
+    const auto merge_recv_bufs = merge;
+    merge = nullptr;
+    merge_recv_bufs(recv_bufs);
+    exchange.reset();
+  }
+};
+
+}  // namespace blaze
+
+#endif
@@ -1,66 +1,180 @@
 #ifndef BLAZE_LOAD_FILE_H_
 #define BLAZE_LOAD_FILE_H_
 
+#include <array>
+#include <cstring>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
+#include "../vendor/hps/src/hps.h"
+#include "dist_text_file.h"
 #include "dist_vector.h"
+#include "internal/char_scanner.h"
+#include "internal/exchange_util.h"
+#include "internal/file_range.h"
+#include "internal/mpi_type.h"
 #include "internal/mpi_util.h"
+#include "internal/number_parser.h"
 
 namespace blaze {
 
 class util {
  public:
-  static void init(int, char**) { MPI_Init(nullptr, nullptr); }
+  // Thread 0 may call MPI inside parallel regions, e.g. the streaming shuffle.
+  static void init(int, char**) {
+    int thread_level;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &thread_level);
+  }
 
+  // Collective. Each proc reads its own byte range of the file, and the lines are numbered in
+  // order across the procs.
   static DistVector<std::string> load_file(const std::string& filename) {
-    // Open file.
-    int error;
-    const size_t TRUNK_SIZE = 1 << 20;
-    char buffer[TRUNK_SIZE];
-    MPI_File file;
-    error = MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
-    if (error) throw std::runtime_error("Cannot open file");
+    std::string buf;
+    internal::FileRange::read(filename, buf);
+    size_t head_size;
+    std::string tail;
+    internal::FileRange::exchange_boundaries(buf.data(), buf.size(), head_size, tail);
 
-    // Load file.
-    MPI_Offset size;
-    MPI_File_get_size(file, &size);
-    MPI_Status status;
+    // Split the lines of this proc, of which the last one ends in the tail.
     std::vector<std::string> lines;
-    std::string line;
-    size_t line_index = 0;
-    const size_t n_procs_u = internal::MpiUtil::get_n_procs();
-    const size_t proc_id_u = internal::MpiUtil::get_proc_id();
-    bool is_local = proc_id_u == 0;
-    while (size > 0) {
-      size_t loop_size = std::min(TRUNK_SIZE, static_cast<size_t>(size));
-      MPI_File_read_all(file, buffer, loop_size, MPI_CHAR, &status);
-      size -= loop_size;
-      for (size_t i = 0; i < loop_size; i++) {
-        if (buffer[i] == '\n') {
-          if (is_local) lines.push_back(line);
-          line.clear();
-          line_index++;
-          is_local = line_index % n_procs_u == proc_id_u;
-        } else {
-          line.push_back(buffer[i]);
+    const char* data = buf.data();
+    size_t pos = head_size;
+    while (pos < buf.size()) {
+      const void* newline = std::memchr(data + pos, '\n', buf.size() - pos);
+      if (newline == nullptr) break;
+      const size_t line_end = static_cast<const char*>(newline) - data;
+      lines.emplace_back(data + pos, line_end - pos);
+      pos = line_end + 1;
+    }
+    std::string last_line = pos < buf.size() ? buf.substr(pos) : std::string();
+    last_line.append(tail);
+    if (!last_line.empty()) {
+      if (last_line.back() == '\n') last_line.pop_back();
+      lines.push_back(std::move(last_line));
+    }
+    std::string().swap(buf);
+    return distribute_in_order(lines);
+  }
+
+  // Collective. Loads a text file of numbers with N fields per line, like points or, with
+  // load_numbers<size_t, 2>, an edge list, into the element of the line number among the lines
+  // with numbers. Fields are separated by whitespace or commas. Blank lines and lines that start
+  // with '#' are skipped, and fields past the N-th are ignored. Throws on all procs if a line has
+  // fewer than N numbers.
+  template <class T, size_t N>
+  static DistVector<std::array<T, N>> load_numbers(const std::string& filename) {
+    using Row = std::array<T, N>;
+    const DistTextFile file(filename);
+    const size_t n_local_lines = file.get_n_local_lines();
+    size_t line_offset = 0;
+    const MPI_Datatype size_t_mpi = internal::MpiType<size_t>::value;
+    MPI_Exscan(&n_local_lines, &line_offset, 1, size_t_mpi, MPI_SUM, MPI_COMM_WORLD);
+    if (internal::MpiUtil::is_master()) line_offset = 0;
+
+    // Parse each line in place, marking the rows of skipped lines.
+    const char SKIPPED = 0;
+    const char PARSED = 1;
+    const char MALFORMED = 2;
+    std::vector<Row> rows(n_local_lines);
+    std::vector<char> states(n_local_lines, SKIPPED);
+    file.for_each([&](const size_t line_id, const StringView& line) {
+      const size_t i = line_id - line_offset;
+      const char* end = line.end();
+      const char* p = internal::CharScanner::skip_delimiters(line.begin(), end);
+      if (p == end || *p == '#') return;
+      for (size_t j = 0; j < N; j++) {
+        p = internal::CharScanner::skip_delimiters(p, end);
+        const char* number_end = internal::NumberParser::parse(p, end, rows[i][j]);
+        const bool is_field_end =
+            number_end == end || internal::CharScanner::is_delimiter(*number_end);
+        if (number_end == p || !is_field_end) {
+          states[i] = MALFORMED;
+          return;
         }
+        p = number_end;
+      }
+      states[i] = PARSED;
+    });
+
+    // Report the first malformed line of the file on all procs.
+    size_t malformed_line_id = file.size();
+    for (size_t i = 0; i < n_local_lines; i++) {
+      if (states[i] == MALFORMED) {
+        malformed_line_id = line_offset + i;
+        break;
       }
     }
-    MPI_File_close(&file);
+    size_t first_malformed_line_id;
+    MPI_Allreduce(
+        &malformed_line_id, &first_malformed_line_id, 1, size_t_mpi, MPI_MIN, MPI_COMM_WORLD);
+    if (first_malformed_line_id < file.size()) {
+      throw std::runtime_error(
+          "Cannot parse " + std::to_string(N) + " numbers from line " +
+          std::to_string(first_malformed_line_id + 1) + " of " + filename);
+    }
 
-    if (!line.empty()) {
-      if (is_local) lines.push_back(line);
-      line_index++;
+    size_t n_rows = 0;
+    for (size_t i = 0; i < n_local_lines; i++) {
+      if (states[i] == PARSED) rows[n_rows++] = rows[i];
     }
+    rows.resize(n_rows);
+    return distribute_in_order(rows);
+  }
 
-    DistVector<std::string> output(line_index);
-    size_t n_lines = lines.size();
-#pragma omp parallel for schedule(static, 1)
-    for (size_t i = 0; i < n_lines; i++) {
-      size_t loop_line_index = i * n_procs_u + proc_id_u;
-      output.async_set(loop_line_index, std::move(lines[i]));
+ private:
+  // Collective. The values of all procs, in the order of the procs, as a DistVector.
+  template <class V>
+  static DistVector<V> distribute_in_order(std::vector<V>& values) {
+    // Number the values with a prefix sum of the value counts.
+    const int n_procs = internal::MpiUtil::get_n_procs();
+    const int proc_id = internal::MpiUtil::get_proc_id();
+    const size_t n_procs_u = n_procs;
+    const size_t n_values = values.size();
+    size_t offset = 0;
+    size_t n_total_values = 0;
+    const MPI_Datatype size_t_mpi = internal::MpiType<size_t>::value;
+    MPI_Exscan(&n_values, &offset, 1, size_t_mpi, MPI_SUM, MPI_COMM_WORLD);
+    if (proc_id == 0) offset = 0;
+    MPI_Allreduce(&n_values, &n_total_values, 1, size_t_mpi, MPI_SUM, MPI_COMM_WORLD);
+    std::vector<size_t> offsets(n_procs);
+    MPI_Allgather(&offset, 1, size_t_mpi, offsets.data(), 1, size_t_mpi, MPI_COMM_WORLD);
+
+    // Send each value to the proc that owns its id, in order, so that the receiver derives the ids
+    // from the offset of the sender instead of hashing a key per value.
+    std::vector<std::vector<V>> dest_values(n_procs);
+    for (size_t i = 0; i < n_values; i++) {
+      dest_values[(offset + i) % n_procs_u].push_back(std::move(values[i]));
+    }
+    std::vector<V>().swap(values);
+    std::vector<std::string> send_bufs(n_procs);
+    std::vector<std::string> recv_bufs;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n_procs; i++) {
+      if (i == proc_id) continue;
+      hps::to_string(dest_values[i], send_bufs[i]);
+      std::vector<V>().swap(dest_values[i]);
+    }
+    internal::ExchangeUtil::all_to_all(send_bufs, recv_bufs);
+    std::vector<std::string>().swap(send_bufs);
+
+    DistVector<V> output(n_total_values);
+    output.set_co_partitioned(true);
+    for (int i = 0; i < n_procs; i++) {
+      if (i != proc_id) hps::from_string(recv_bufs[i], dest_values[i]);
+      std::string().swap(recv_bufs[i]);
+      const size_t first_id =
+          offsets[i] + (proc_id + n_procs_u - offsets[i] % n_procs_u) % n_procs_u;
+      const auto& src_values = dest_values[i];
+      const size_t n_src_values = src_values.size();
+#pragma omp parallel for schedule(static)
+      for (size_t j = 0; j < n_src_values; j++) {
+        output.async_set(first_id + j * n_procs_u, src_values[j]);
+      }
+      std::vector<V>().swap(dest_values[i]);
     }
     output.sync();
+    output.set_co_partitioned(false);
 
     return output;
   }
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "../../src/internal/vector_mapreduce_wrapper.h"
+#include "../../src/mapreduce.h"
+
+// Tree versus ring allreduce of std::vector destinations with a callable reducer, across sizes.
+namespace {
+
+const int N_REPEATS = 5;
+
+template <class F>
+double get_ms(const F& allreduce) {
+  using namespace std::chrono;
+  allreduce();  // Warm up.
+  const auto start = steady_clock::now();
+  for (int i = 0; i < N_REPEATS; i++) allreduce();
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0 / N_REPEATS;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, AllreduceSweep) {
+  if (blaze::internal::MpiUtil::get_n_procs() == 1) return;
+  const std::function<void(double&, const double&)> reducer = [](double& t1, const double& t2) {
+    t1 += t2;
+  };
+  for (size_t n_keys = 1 << 10; n_keys <= (1 << 22); n_keys <<= 2) {
+    std::vector<double> dest(n_keys, 0.0);
+    blaze::internal::VectorMapreduceWrapper<double> dest_wrapper(dest);
+    dest_wrapper.sync_local(reducer);
+    const double ms_tree = get_ms([&]() { dest_wrapper.allreduce_tree(reducer); });
+    const double ms_ring = get_ms([&]() { dest_wrapper.allreduce_ring(reducer); });
+    if (!blaze::internal::MpiUtil::is_master()) continue;
+    printf(
+        "Allreduce %zu doubles: tree: %.2f ms, ring: %.2f ms, speedup: %.2fx\n",
+        n_keys,
+        ms_tree,
+        ms_ring,
+        ms_tree / ms_ring);
+  }
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+
+#include "../../src/mapreduce.h"
+
+// Aggregation into a DistHashMap with the remote pairs hashed at the sender or appended, for keys
+// that rarely repeat and for keys that repeat often.
+namespace {
+
+const size_t N_SOURCE = 1 << 22;
+
+double get_ms(const size_t n_keys, const bool appends) {
+  using namespace std::chrono;
+  blaze::DistRange<size_t> range(0, N_SOURCE);
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    emit((i * 0x9E3779B97F4A7C15ULL) % n_keys, 1);
+  };
+  blaze::DistHashMap<size_t, size_t> res;
+  if (appends) res.enable_append_shuffle();
+  blaze::mapreduce<size_t, size_t, size_t>(range, mapper, "sum", res);  // Warm up.
+  res.clear();
+  const auto start = steady_clock::now();
+  blaze::mapreduce<size_t, size_t, size_t>(range, mapper, "sum", res);
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, AppendShuffle) {
+  for (const size_t n_keys : {N_SOURCE, N_SOURCE / 64}) {
+    const double ms_before = get_ms(n_keys, false);
+    const double ms_after = get_ms(n_keys, true);
+    if (!blaze::internal::MpiUtil::is_master()) continue;
+    printf(
+        "Append shuffle: %zu keys: hashed: %.1f ms, append: %.1f ms, speedup: %.2fx\n",
+        n_keys,
+        ms_before,
+        ms_after,
+        ms_before / ms_after);
+  }
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../src/broadcast.h"
+#include "../../src/collect.h"
+#include "../../src/dist_hash_map.h"
+#include "../../src/dist_vector.h"
+#include "../../src/distribute.h"
+
+// Time to save a container and load it back, with save and load and by collecting it to proc 0,
+// which writes it with hps, reads it back, broadcasts and distributes it.
+namespace {
+
+const size_t N_VALUES = 1 << 24;
+
+const long long N_KEYS = 1 << 21;
+
+const char* PATH = "/tmp/blaze_checkpoint_benchmark.bin";
+
+template <class F>
+double get_ms(const F& run) {
+  using namespace std::chrono;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  run();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+template <class C>
+void save_collected(C& container) {
+  const auto& collected = blaze::collect(container);
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  std::ofstream file(PATH, std::ios::binary);
+  file << hps::to_string(collected);
+}
+
+template <class T>
+auto load_collected(T& collected) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ifstream file(PATH, std::ios::binary);
+    const std::string buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    hps::from_string(buf, collected);
+  }
+  blaze::broadcast(collected);
+  return blaze::distribute(collected);
+}
+
+template <class C, class T>
+void run(const char* name, C& container, T& collected) {
+  const double ms_save_collected = get_ms([&]() { save_collected(container); });
+  const double ms_load_collected = get_ms([&]() { load_collected(collected); });
+  const double ms_save = get_ms([&]() { container.save(PATH); });
+  C loaded;
+  const double ms_load = get_ms([&]() { loaded.load(PATH); });
+  EXPECT_EQ(blaze::collect(loaded), blaze::collect(container));
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  std::remove(PATH);
+  printf(
+      "%s: collected: save %.1f ms, load %.1f ms; checkpoint: save %.1f ms, load %.1f ms\n",
+      name,
+      ms_save_collected,
+      ms_load_collected,
+      ms_save,
+      ms_load);
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, Checkpoint) {
+  blaze::DistVector<double> vec(N_VALUES);
+  vec.for_each([](const size_t key, double& value) { value = key * 0.5; });
+  std::vector<double> collected_vec;
+  run("DistVector", vec, collected_vec);
+
+  blaze::DistHashMap<long long, double> map;
+  const long long n_procs = blaze::internal::MpiUtil::get_n_procs();
+#pragma omp parallel for
+  for (long long i = blaze::internal::MpiUtil::get_proc_id(); i < N_KEYS; i += n_procs) {
+    map.async_set(i * 0x9E3779B97F4A7C15LL, i * 0.5);
+  }
+  map.sync();
+  std::unordered_map<long long, double> collected_map;
+  run("DistHashMap", map, collected_map);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "../../src/mapreduce.h"
+
+// Per-emit cost of the std::function mapper / emit / reducer path versus the inlined path.
+namespace {
+
+const size_t N_SOURCE = 1 << 22;
+
+const size_t N_EMITS_PER_SOURCE = 4;
+
+const size_t N_KEYS = 1 << 10;
+
+template <class F>
+double get_ns_per_emit(const F& run) {
+  using namespace std::chrono;
+  run();  // Warm up.
+  const auto start = steady_clock::now();
+  run();
+  const auto end = steady_clock::now();
+  const double n_emits = static_cast<double>(N_SOURCE) * N_EMITS_PER_SOURCE;
+  return duration_cast<nanoseconds>(end - start).count() / n_emits;
+}
+
+void report(const std::string& dest_type, const double ns_before, const double ns_after) {
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "%-24s std::function: %6.2f ns/emit, inlined: %6.2f ns/emit, speedup: %.2fx\n",
+      dest_type.c_str(),
+      ns_before,
+      ns_after,
+      ns_before / ns_after);
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, EmitCostToVector) {
+  blaze::DistRange<size_t> range(0, N_SOURCE);
+  const std::function<void(const size_t, const std::function<void(const size_t, const size_t&)>&)>
+      mapper_func =
+          [&](const size_t i, const std::function<void(const size_t, const size_t&)>& emit) {
+            for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+          };
+  const std::function<void(size_t&, const size_t&)> reducer_func = blaze::Reducer<size_t>::sum;
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+  };
+
+  std::vector<size_t> res(N_KEYS);
+  const double ns_before = get_ns_per_emit(
+      [&]() { blaze::mapreduce<size_t, size_t>(range, mapper_func, reducer_func, res); });
+  const double ns_after =
+      get_ns_per_emit([&]() { blaze::mapreduce<size_t, size_t>(range, mapper, "sum", res); });
+  report("std::vector", ns_before, ns_after);
+}
+
+TEST(BenchmarkTest, EmitCostToDistVector) {
+  blaze::DistRange<size_t> range(0, N_SOURCE);
+  const std::function<void(const size_t, const std::function<void(const size_t, const size_t&)>&)>
+      mapper_func =
+          [&](const size_t i, const std::function<void(const size_t, const size_t&)>& emit) {
+            for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+          };
+  const std::function<void(size_t&, const size_t&)> reducer_func = blaze::Reducer<size_t>::sum;
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+  };
+
+  blaze::DistVector<size_t> res(N_KEYS);
+  const double ns_before = get_ns_per_emit(
+      [&]() { blaze::mapreduce<size_t, size_t>(range, mapper_func, reducer_func, res); });
+  const double ns_after =
+      get_ns_per_emit([&]() { blaze::mapreduce<size_t, size_t>(range, mapper, "sum", res); });
+  report("blaze::DistVector", ns_before, ns_after);
+}
+
+TEST(BenchmarkTest, EmitCostToDistHashMap) {
+  blaze::DistRange<size_t> range(0, N_SOURCE);
+  const std::function<void(const size_t, const std::function<void(const size_t&, const size_t&)>&)>
+      mapper_func =
+          [&](const size_t i, const std::function<void(const size_t&, const size_t&)>& emit) {
+            for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+          };
+  const std::function<void(size_t&, const size_t&)> reducer_func = blaze::Reducer<size_t>::sum;
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    for (size_t j = 0; j < N_EMITS_PER_SOURCE; j++) emit((i + j) % N_KEYS, 1);
+  };
+
+  blaze::DistHashMap<size_t, size_t> res;
+  const double ns_before = get_ns_per_emit([&]() {
+    blaze::mapreduce<size_t, size_t, size_t>(range, mapper_func, reducer_func, res);
+  });
+  const double ns_after = get_ns_per_emit(
+      [&]() { blaze::mapreduce<size_t, size_t, size_t>(range, mapper, "sum", res); });
+  report("blaze::DistHashMap", ns_before, ns_after);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../../src/internal/exchange_scheduler.h"
+
+// All-to-all exchanges with balanced and with skewed message sizes on each plan.
+namespace {
+
+using Plan = blaze::internal::ExchangeScheduler::Plan;
+
+const int N_REPEATS = 5;
+
+double get_ms(const std::vector<std::string>& send_bufs, const Plan plan) {
+  using namespace std::chrono;
+  std::vector<size_t> size_matrix;
+  blaze::internal::ExchangeScheduler::gather_size_matrix(send_bufs, size_matrix);
+  std::vector<std::string> recv_bufs;
+  blaze::internal::ExchangeScheduler::all_to_all(send_bufs, recv_bufs, plan, size_matrix);
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  for (int i = 0; i < N_REPEATS; i++) {
+    blaze::internal::ExchangeScheduler::all_to_all(send_bufs, recv_bufs, plan, size_matrix);
+  }
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0 / N_REPEATS;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, ExchangeSchedule) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  if (n_procs == 1) return;
+  for (const bool is_skewed : {false, true}) {
+    // With skew, every proc sends 64 MB to the next proc and 64 KB to the others.
+    std::vector<std::string> send_bufs(n_procs);
+    for (int i = 0; i < n_procs; i++) {
+      if (i == proc_id) continue;
+      const bool is_large = !is_skewed || i == (proc_id + 1) % n_procs;
+      send_bufs[i].assign(is_large ? 1 << 26 : 1 << 16, 'a');
+    }
+    std::vector<size_t> size_matrix;
+    blaze::internal::ExchangeScheduler::gather_size_matrix(send_bufs, size_matrix);
+    const Plan chosen = blaze::internal::ExchangeScheduler::get_plan(size_matrix);
+    const double ms_alltoallv = get_ms(send_bufs, Plan::ALLTOALLV);
+    const double ms_pairwise = get_ms(send_bufs, Plan::PAIRWISE);
+    const double ms_windowed = get_ms(send_bufs, Plan::WINDOWED);
+    if (!blaze::internal::MpiUtil::is_master()) continue;
+    printf(
+        "Exchange %s: alltoallv: %.1f ms, pairwise: %.1f ms, windowed: %.1f ms, chosen: %s\n",
+        is_skewed ? "skewed" : "balanced",
+        ms_alltoallv,
+        ms_pairwise,
+        ms_windowed,
+        blaze::internal::ExchangeScheduler::get_plan_name(chosen));
+  }
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../src/util.h"
+
+// Load time of a text file where every proc reads the whole file and keeps every n_procs-th line,
+// as load_file did before, and where every proc reads its own byte range only. Run at 1, 4 and 16
+// procs to see how each scales.
+namespace {
+
+const size_t N_LINES = 1 << 22;
+
+const char* FILENAME = "/tmp/blaze_load_file_benchmark.txt";
+
+blaze::DistVector<std::string> load_file_read_all(const std::string& filename) {
+  const size_t TRUNK_SIZE = 1 << 20;
+  std::vector<char> buffer(TRUNK_SIZE);
+  MPI_File file;
+  MPI_File_open(MPI_COMM_WORLD, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+  MPI_Offset size;
+  MPI_File_get_size(file, &size);
+  std::vector<std::string> lines;
+  std::string line;
+  size_t line_index = 0;
+  const size_t n_procs_u = blaze::internal::MpiUtil::get_n_procs();
+  const size_t proc_id_u = blaze::internal::MpiUtil::get_proc_id();
+  bool is_local = proc_id_u == 0;
+  while (size > 0) {
+    const size_t loop_size = std::min(TRUNK_SIZE, static_cast<size_t>(size));
+    MPI_File_read_all(file, buffer.data(), loop_size, MPI_CHAR, MPI_STATUS_IGNORE);
+    size -= loop_size;
+    for (size_t i = 0; i < loop_size; i++) {
+      if (buffer[i] == '\n') {
+        if (is_local) lines.push_back(line);
+        line.clear();
+        line_index++;
+        is_local = line_index % n_procs_u == proc_id_u;
+      } else {
+        line.push_back(buffer[i]);
+      }
+    }
+  }
+  MPI_File_close(&file);
+  blaze::DistVector<std::string> output(line_index);
+  const size_t n_lines = lines.size();
+#pragma omp parallel for schedule(static, 1)
+  for (size_t i = 0; i < n_lines; i++) output.async_set(i * n_procs_u + proc_id_u, lines[i]);
+  output.sync();
+  return output;
+}
+
+template <class F>
+double get_ms(const F& load) {
+  using namespace std::chrono;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  const auto& lines = load();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  EXPECT_EQ(lines.size(), N_LINES);
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, LoadFile) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(FILENAME);
+    for (size_t i = 0; i < N_LINES; i++) file << "line " << i * 0x9E3779B97F4A7C15ULL << '\n';
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double ms_read_all = get_ms([]() { return load_file_read_all(FILENAME); });
+  const double ms_byte_range = get_ms([]() { return blaze::util::load_file(FILENAME); });
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  std::remove(FILENAME);
+  printf(
+      "Load file: %zu lines on %d procs: read all: %.1f ms, byte range: %.1f ms, speedup: %.2fx\n",
+      N_LINES,
+      blaze::internal::MpiUtil::get_n_procs(),
+      ms_read_all,
+      ms_byte_range,
+      ms_read_all / ms_byte_range);
+}
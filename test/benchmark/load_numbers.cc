@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../src/mapreduce.h"
+#include "../../src/util.h"
+
+// Load time of synthetic files shaped like the data of the kmeans, pagerank and nn benchmarks,
+// with their stream based loaders and with load_numbers.
+namespace {
+
+const size_t N_LINES = 1 << 21;
+
+const char* FILENAME = "/tmp/blaze_load_numbers_benchmark.txt";
+
+template <class F>
+double get_ms(const F& load) {
+  using namespace std::chrono;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  const size_t n = load();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  EXPECT_EQ(n, N_LINES);
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+template <class W>
+void write_file(const W& write_line) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(FILENAME);
+    for (size_t i = 0; i < N_LINES; i++) write_line(file, i);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void print(const char* name, const double ms_stream, const double ms_load_numbers) {
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "%s: %zu lines on %d procs: stream: %.1f ms, load_numbers: %.1f ms, speedup: %.2fx\n",
+      name,
+      N_LINES,
+      blaze::internal::MpiUtil::get_n_procs(),
+      ms_stream,
+      ms_load_numbers,
+      ms_stream / ms_load_numbers);
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, LoadNumbers) {
+  // Points for kmeans, which every proc reads whole with operator>>.
+  write_file([](std::ofstream& file, const size_t i) {
+    file << (i % 1000) * 0.123 << ' ' << (i % 777) * -4.56 << ' ' << i * 1e-3 << '\n';
+  });
+  double ms_stream = get_ms([]() {
+    std::ifstream file(FILENAME);
+    std::vector<std::array<double, 3>> points;
+    std::array<double, 3> point;
+    while (file >> point[0] >> point[1] >> point[2]) points.push_back(point);
+    return points.size();
+  });
+  double ms_load_numbers =
+      get_ms([]() { return blaze::util::load_numbers<double, 3>(FILENAME).size(); });
+  print("Points", ms_stream, ms_load_numbers);
+
+  // An edge list for pagerank, of which every proc reads all edges and keeps its own.
+  write_file([](std::ofstream& file, const size_t i) {
+    file << i / 8 << '\t' << (i * 0x9E3779B97F4A7C15ULL) % N_LINES << '\n';
+  });
+  ms_stream = get_ms([]() {
+    std::ifstream file(FILENAME);
+    std::vector<std::array<size_t, 2>> edges;
+    size_t n_edges = 0;
+    std::array<size_t, 2> edge;
+    while (file >> edge[0] >> edge[1]) {
+      n_edges++;
+      if (blaze::DistVector<double>::is_local(edge[0])) edges.push_back(edge);
+    }
+    return n_edges;
+  });
+  ms_load_numbers = get_ms([]() { return blaze::util::load_numbers<size_t, 2>(FILENAME).size(); });
+  print("Edges", ms_stream, ms_load_numbers);
+
+  // Points for nn, which are loaded as lines and parsed with a stringstream.
+  write_file([](std::ofstream& file, const size_t i) {
+    file << i % 10007 << ' ' << i % 9973 << '\n';
+  });
+  ms_stream = get_ms([]() {
+    auto lines = blaze::util::load_file(FILENAME);
+    blaze::DistVector<std::array<int, 2>> points(lines.size());
+    const auto& mapper = [&](const size_t key, const std::string& line, const auto& emit) {
+      std::stringstream ss(line);
+      std::array<int, 2> point;
+      ss >> point[0] >> point[1];
+      emit(key, point);
+    };
+    blaze::mapreduce<std::string, std::array<int, 2>>(
+        lines, mapper, blaze::Reducer<std::array<int, 2>>::overwrite, points);
+    return points.size();
+  });
+  ms_load_numbers = get_ms([]() { return blaze::util::load_numbers<int, 2>(FILENAME).size(); });
+  print("Int pairs", ms_stream, ms_load_numbers);
+
+  if (blaze::internal::MpiUtil::is_master()) std::remove(FILENAME);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../../src/broadcast.h"
+#include "../../src/gather.h"
+#include "../../src/internal/transport.h"
+
+// Throughput of broadcasts and gathers of 1 GB double vectors, serialized with hps as before and
+// straight from their storage. The gathered vectors add up to 1 GB.
+namespace {
+
+const size_t N_VALUES = 1 << 27;
+
+const int N_REPEATS = 3;
+
+template <class F>
+double get_gb_per_s(const F& run) {
+  using namespace std::chrono;
+  run();  // Warm up.
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  for (int i = 0; i < N_REPEATS; i++) run();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  const double seconds = duration_cast<microseconds>(end - start).count() / 1.0e6;
+  return N_VALUES * sizeof(double) * N_REPEATS / seconds / 1.0e9;
+}
+
+void broadcast_serialized(std::vector<double>& values) {
+  std::string msg;
+  const bool is_master = blaze::internal::MpiUtil::is_master();
+  if (is_master) hps::to_string(values, msg);
+  blaze::internal::Transport::broadcast(msg, 0, blaze::internal::NodeComm::get_instance());
+  if (!is_master) hps::from_string(msg, values);
+}
+
+std::vector<std::vector<double>> gather_serialized(const std::vector<double>& values) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const std::string msg = hps::to_string(values);
+  std::string recv_buf;
+  std::vector<size_t> displs;
+  blaze::internal::Transport::allgather(
+      msg, recv_buf, displs, blaze::internal::NodeComm::get_instance());
+  std::vector<std::vector<double>> res(n_procs);
+  for (int i = 0; i < n_procs; i++) hps::from_char_array(recv_buf.data() + displs[i], res[i]);
+  return res;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, ObjectTransport) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  std::vector<double> values;
+  const auto& reset = [&]() {
+    if (blaze::internal::MpiUtil::is_master()) {
+      values.assign(N_VALUES, 1.5);
+    } else {
+      std::vector<double>().swap(values);
+    }
+  };
+  const double broadcast_hps = get_gb_per_s([&]() {
+    reset();
+    broadcast_serialized(values);
+  });
+  const double broadcast_pod = get_gb_per_s([&]() {
+    reset();
+    blaze::broadcast(values);
+  });
+  values.assign(N_VALUES / n_procs, 1.5);
+  const double gather_hps = get_gb_per_s([&]() { gather_serialized(values); });
+  const double gather_pod = get_gb_per_s([&]() { blaze::gather(values); });
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "Object transport: %zu MiB: broadcast hps: %.2f GB/s, pod: %.2f GB/s (%.2fx), "
+      "gather hps: %.2f GB/s, pod: %.2f GB/s (%.2fx)\n",
+      N_VALUES * sizeof(double) >> 20,
+      broadcast_hps,
+      broadcast_pod,
+      broadcast_pod / broadcast_hps,
+      gather_hps,
+      gather_pod,
+      gather_pod / gather_hps);
+}
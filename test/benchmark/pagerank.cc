@@ -11,25 +11,18 @@ blaze::DistVector<double> get_page_rank(
     const std::unordered_map<size_t, std::vector<size_t>>& links,
     const double epsilon = 1.0e-5,
     const double d = 0.15) {
-  const auto& sink_mapper = [&](
-      const size_t key,
-      const double& value,
-      const std::function<void(const size_t, const double&)>& emit) {
+  // Sink sum and scatter in a single pass over the ranks.
+  const auto& mapper = [&](
+      const size_t key, const double& value, const auto& emit_sink, const auto& emit_scatter) {
     if (links.count(key) == 0) {
-      emit(0, value);
+      emit_sink(0, value);
+      return;
     }
-  };
-
-  const auto& scatter_mapper = [&](
-      const size_t key,
-      const double& value,
-      const std::function<void(const size_t, const double&)>& emit) {
-    if (links.count(key) == 0) return;
     const auto& key_links = links.find(key)->second;
     size_t L = key_links.size();
     double factor = (1 - d) * value / L;
     for (size_t i = 0; i < L; i++) {
-      emit(key_links[i], factor);
+      emit_scatter(key_links[i], factor);
     }
   };
 
@@ -38,6 +31,8 @@ blaze::DistVector<double> get_page_rank(
       const double& value,
       const std::function<void(const size_t, const double&)>& emit) { emit(0, std::abs(value)); };
 
+  // The links are the same in every iteration, so the scatter routes are recorded once.
+  auto plan = std::make_shared<blaze::DistVector<double>::ShufflePlan>();
   blaze::DistVector<double> ranks(n, 1.0);
   std::vector<double> sink_sum(1, 0.0);
   std::vector<double> max_change(1, 1.0);
@@ -45,10 +40,15 @@ blaze::DistVector<double> get_page_rank(
   while (max_change[0] > epsilon) {
     iteration++;
     sink_sum[0] = 0.0;
-    blaze::mapreduce<double, double>(ranks, sink_mapper, "sum", sink_sum);
-
-    blaze::DistVector<double> new_ranks(n, d + (1 - d) * sink_sum[0] / n);
-    blaze::mapreduce<double, double>(ranks, scatter_mapper, blaze::Reducer<double>::sum, new_ranks);
+    blaze::DistVector<double> new_ranks(n, 0.0);
+    new_ranks.set_shuffle_plan(plan);
+    blaze::mapreduce(
+        ranks,
+        mapper,
+        blaze::output("sum", sink_sum),
+        blaze::output(blaze::Reducer<double>::sum, new_ranks));
+    const double base_rank = d + (1 - d) * sink_sum[0] / n;
+    new_ranks.for_each([&](const size_t, double& value) { value += base_rank; });
 
     ranks -= new_ranks;
     max_change[0] = 0.0;
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../../src/mapreduce.h"
+
+// PageRank style scatter over fixed links, with the routes replayed from a shuffle plan or not.
+namespace {
+
+const size_t N_KEYS = 1 << 20;
+
+const size_t N_LINKS_PER_KEY = 8;
+
+const int N_ITERATIONS = 10;
+
+double get_ms(const bool uses_shuffle_plan) {
+  using namespace std::chrono;
+  blaze::DistVector<double> ranks(N_KEYS, 1.0);
+  const auto& mapper = [&](const size_t key, const double value, const auto& emit) {
+    for (size_t i = 1; i <= N_LINKS_PER_KEY; i++) {
+      emit((key * 0x9E3779B97F4A7C15ULL + i * 0x7F4A7C15ULL) % N_KEYS, value / N_LINKS_PER_KEY);
+    }
+  };
+  auto plan = std::make_shared<blaze::DistVector<double>::ShufflePlan>();
+  steady_clock::time_point start;
+  for (int i = 0; i <= N_ITERATIONS; i++) {
+    if (i == 1) start = steady_clock::now();  // The first iteration records the plan.
+    blaze::DistVector<double> new_ranks(N_KEYS, 0.0);
+    if (uses_shuffle_plan) new_ranks.set_shuffle_plan(plan);
+    blaze::mapreduce<double, double>(ranks, mapper, "sum", new_ranks);
+    ranks = new_ranks;
+  }
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0 / N_ITERATIONS;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, ShufflePlan) {
+  const double ms_before = get_ms(false);
+  const double ms_after = get_ms(true);
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "Shuffle plan: per iteration: hashed shuffle: %.1f ms, replayed plan: %.1f ms, "
+      "speedup: %.2fx\n",
+      ms_before,
+      ms_after,
+      ms_before / ms_after);
+}
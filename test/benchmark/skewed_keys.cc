@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "../../src/mapreduce.h"
+
+// Word count style aggregation where a few hot keys take half of all emits.
+namespace {
+
+const size_t N_SOURCE = 1 << 22;
+
+const size_t N_HOT_KEYS = 4;
+
+const size_t N_COLD_KEYS = 1 << 20;
+
+double get_ms(const bool detect_hot_keys) {
+  using namespace std::chrono;
+  blaze::DistRange<size_t> range(0, N_SOURCE);
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    const size_t mixed = i * 0x9E3779B97F4A7C15ULL;
+    if (i % 2 == 0) {
+      emit(mixed % N_HOT_KEYS, 1);
+    } else {
+      emit(N_HOT_KEYS + mixed % N_COLD_KEYS, 1);
+    }
+  };
+  blaze::DistHashMap<size_t, size_t> res;
+  if (detect_hot_keys) res.enable_hot_key_detection();
+  blaze::mapreduce<size_t, size_t, size_t>(range, mapper, "sum", res);  // Warm up.
+  res.clear();
+  const auto start = steady_clock::now();
+  blaze::mapreduce<size_t, size_t, size_t>(range, mapper, "sum", res);
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, SkewedKeys) {
+  const double ms_before = get_ms(false);
+  const double ms_after = get_ms(true);
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "Skewed keys: hash routing: %.1f ms, hot key detection: %.1f ms, speedup: %.2fx\n",
+      ms_before,
+      ms_after,
+      ms_before / ms_after);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../src/dist_text_file.h"
+#include "../../src/mapreduce.h"
+#include "../../src/util.h"
+
+// Time to load a text file and sum the lengths of its lines, from a DistVector<std::string> of
+// copied lines and from the mapped lines of a DistTextFile.
+namespace {
+
+const size_t N_LINES = 1 << 22;
+
+const char* FILENAME = "/tmp/blaze_text_file_benchmark.txt";
+
+template <class F>
+double get_ms(const F& run) {
+  using namespace std::chrono;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  run();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, TextFile) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(FILENAME);
+    for (size_t i = 0; i < N_LINES; i++) file << "line " << i * 0x9E3779B97F4A7C15ULL << '\n';
+  }
+  std::vector<size_t> n_chars_copied(1);
+  std::vector<size_t> n_chars_mapped(1);
+  const double ms_copied = get_ms([&]() {
+    auto lines = blaze::util::load_file(FILENAME);
+    blaze::mapreduce<std::string, size_t>(
+        lines,
+        [](const size_t, const std::string& line, const auto& emit) { emit(0, line.size()); },
+        "sum",
+        n_chars_copied);
+  });
+  const double ms_mapped = get_ms([&]() {
+    blaze::DistTextFile file(FILENAME);
+    blaze::mapreduce<size_t>(
+        file,
+        [](const size_t, const blaze::StringView& line, const auto& emit) {
+          emit(0, line.size());
+        },
+        "sum",
+        n_chars_mapped);
+  });
+  EXPECT_EQ(n_chars_copied, n_chars_mapped);
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  std::remove(FILENAME);
+  printf(
+      "Text file: %zu lines: load_file: %.1f ms, DistTextFile: %.1f ms, speedup: %.2fx\n",
+      N_LINES,
+      ms_copied,
+      ms_mapped,
+      ms_copied / ms_mapped);
+}
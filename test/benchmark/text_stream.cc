@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../src/dist_text_stream.h"
+#include "../../src/mapreduce.h"
+#include "../../src/util.h"
+
+// Time and peak memory to sum the lengths of the lines of a text file, from a DistVector of
+// loaded lines and from a DistTextStream with small chunks. The stream runs first, so that its
+// peak is not hidden by that of the loaded lines.
+namespace {
+
+const size_t N_LINES = 1 << 22;
+
+const size_t CHUNK_SIZE = 1 << 22;
+
+const char* FILENAME = "/tmp/blaze_text_stream_benchmark.txt";
+
+template <class F>
+double get_ms(const F& run) {
+  using namespace std::chrono;
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  run();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+// The peak resident memory of this proc so far in MiB.
+double get_max_rss_mb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, TextStream) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(FILENAME);
+    for (size_t i = 0; i < N_LINES; i++) file << "line " << i * 0x9E3779B97F4A7C15ULL << '\n';
+  }
+  std::vector<size_t> n_chars_streamed(1);
+  std::vector<size_t> n_chars_loaded(1);
+  MPI_Barrier(MPI_COMM_WORLD);
+  const double mb_start = get_max_rss_mb();
+  const double ms_streamed = get_ms([&]() {
+    blaze::DistTextStream stream(FILENAME, CHUNK_SIZE);
+    blaze::mapreduce<size_t>(
+        stream,
+        [](const blaze::StringView& line, const auto& emit) { emit(0, line.size()); },
+        "sum",
+        n_chars_streamed);
+  });
+  const double mb_streamed = get_max_rss_mb() - mb_start;
+  const double ms_loaded = get_ms([&]() {
+    auto lines = blaze::util::load_file(FILENAME);
+    blaze::mapreduce<std::string, size_t>(
+        lines,
+        [](const size_t, const std::string& line, const auto& emit) { emit(0, line.size()); },
+        "sum",
+        n_chars_loaded);
+  });
+  const double mb_loaded = get_max_rss_mb() - mb_start;
+  EXPECT_EQ(n_chars_streamed, n_chars_loaded);
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  std::remove(FILENAME);
+  printf(
+      "Text stream: %zu lines: load_file: %.1f ms, +%.1f MiB, DistTextStream: %.1f ms, +%.1f MiB\n",
+      N_LINES,
+      ms_loaded,
+      mb_loaded,
+      ms_streamed,
+      mb_streamed);
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../../src/broadcast.h"
+#include "../../src/gather.h"
+#include "../../src/internal/transport.h"
+
+// Throughput of pairwise exchanges, broadcasts and gathers of large serialized messages.
+namespace {
+
+const size_t MSG_SIZE = 1 << 26;
+
+const int N_REPEATS = 5;
+
+// The copy loop through a 1 MiB staging buffer that the transport replaces.
+void send_recv_staged(
+    const std::string& send_buf,
+    const int dest_proc_id,
+    std::string& recv_buf,
+    const int src_proc_id) {
+  const size_t BUF_SIZE = 1 << 20;
+  MPI_Request reqs[2];
+  size_t send_cnt = send_buf.size();
+  size_t recv_cnt = 0;
+  MPI_Irecv(&recv_cnt, 1, MPI_UNSIGNED_LONG, src_proc_id, 0, MPI_COMM_WORLD, &reqs[0]);
+  MPI_Isend(&send_cnt, 1, MPI_UNSIGNED_LONG, dest_proc_id, 0, MPI_COMM_WORLD, &reqs[1]);
+  MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+  std::vector<char> send_buf_char(BUF_SIZE);
+  std::vector<char> recv_buf_char(BUF_SIZE);
+  size_t send_pos = 0;
+  size_t recv_pos = 0;
+  recv_buf.clear();
+  recv_buf.reserve(recv_cnt);
+  while (send_pos < send_cnt || recv_pos < recv_cnt) {
+    const int recv_trunk_cnt = std::min(BUF_SIZE, recv_cnt - recv_pos);
+    const int send_trunk_cnt = std::min(BUF_SIZE, send_cnt - send_pos);
+    MPI_Irecv(
+        recv_buf_char.data(), recv_trunk_cnt, MPI_CHAR, src_proc_id, 1, MPI_COMM_WORLD, &reqs[0]);
+    send_buf.copy(send_buf_char.data(), send_trunk_cnt, send_pos);
+    MPI_Issend(
+        send_buf_char.data(), send_trunk_cnt, MPI_CHAR, dest_proc_id, 1, MPI_COMM_WORLD, &reqs[1]);
+    MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+    recv_buf.append(recv_buf_char.data(), recv_trunk_cnt);
+    recv_pos += recv_trunk_cnt;
+    send_pos += send_trunk_cnt;
+  }
+}
+
+template <class F>
+double get_gb_per_s(const F& run) {
+  using namespace std::chrono;
+  run();  // Warm up.
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto start = steady_clock::now();
+  for (int i = 0; i < N_REPEATS; i++) run();
+  MPI_Barrier(MPI_COMM_WORLD);
+  const auto end = steady_clock::now();
+  const double seconds = duration_cast<microseconds>(end - start).count() / 1.0e6;
+  return MSG_SIZE * N_REPEATS / seconds / 1.0e9;
+}
+
+}  // namespace
+
+TEST(BenchmarkTest, Transport) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const int next_proc_id = (proc_id + 1) % n_procs;
+  const int prev_proc_id = (proc_id + n_procs - 1) % n_procs;
+  const std::string msg(MSG_SIZE, 'a');
+  std::string recv_buf;
+  const double staged = get_gb_per_s([&]() {
+    send_recv_staged(msg, next_proc_id, recv_buf, prev_proc_id);
+  });
+  const double in_place = get_gb_per_s([&]() {
+    blaze::internal::Transport::send_recv(msg, next_proc_id, recv_buf, prev_proc_id);
+  });
+  std::string broadcast_msg;
+  const double broadcast = get_gb_per_s([&]() {
+    broadcast_msg = proc_id == 0 ? msg : std::string();
+    blaze::broadcast(broadcast_msg);
+  });
+  std::string gather_msg(MSG_SIZE / n_procs, 'a');
+  const double gather = get_gb_per_s([&]() { blaze::gather(gather_msg); });
+  if (!blaze::internal::MpiUtil::is_master()) return;
+  printf(
+      "Transport: %zu MiB: send_recv staged: %.2f GB/s, in place: %.2f GB/s, speedup: %.2fx, "
+      "broadcast: %.2f GB/s, gather: %.2f GB/s\n",
+      MSG_SIZE >> 20,
+      staged,
+      in_place,
+      in_place / staged,
+      broadcast,
+      gather);
+}
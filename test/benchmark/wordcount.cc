@@ -1,4 +1,4 @@
-#include "../src/dist_hash_map.h"
+#include "../../src/dist_hash_map.h"
 
 #include <gtest/gtest.h>
 #include <chrono>
@@ -6,7 +6,7 @@
 #include <iostream>
 #include <string>
 
-#include "../src/mapreduce.h"
+#include "../../src/mapreduce.h"
 
 TEST(BenchmarkTest, WordCount) {
   using namespace std::chrono;
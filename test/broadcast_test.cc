@@ -0,0 +1,39 @@
+#include "../src/broadcast.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+TEST(BroadcastTest, Vector) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  for (int root = 0; root < n_procs; root++) {
+    std::vector<std::string> values;
+    if (blaze::internal::MpiUtil::get_proc_id() == root) values.assign(10, std::to_string(root));
+    blaze::broadcast(values, root);
+    EXPECT_EQ(values, std::vector<std::string>(10, std::to_string(root)));
+  }
+}
+
+TEST(BroadcastTest, BroadcastShared) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  // By shared memory, and with two procs per node.
+  for (const int ranks_per_node : {0, 2}) {
+    const blaze::internal::NodeComm nodes(ranks_per_node);
+    for (int root = 0; root < n_procs; root++) {
+      std::vector<double> values;
+      if (proc_id == root) {
+        for (int i = 0; i < 1000; i++) values.push_back(root + i * 0.5);
+      }
+      const blaze::SharedArray<double> res = blaze::broadcast_shared(values, root, nodes);
+      ASSERT_EQ(res.size(), 1000);
+      for (int i = 0; i < 1000; i++) EXPECT_EQ(res[i], root + i * 0.5);
+    }
+  }
+}
+
+TEST(BroadcastTest, BroadcastSharedEmpty) {
+  const blaze::SharedArray<int> res = blaze::broadcast_shared(std::vector<int>());
+  EXPECT_TRUE(res.empty());
+  EXPECT_EQ(res.begin(), res.end());
+}
@@ -0,0 +1,154 @@
+#include "../src/internal/checkpoint.h"
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../src/collect.h"
+#include "../src/dist_hash_map.h"
+#include "../src/dist_vector.h"
+
+namespace {
+
+const char* PATH = "/tmp/blaze_checkpoint_test.bin";
+
+using Checkpoint = blaze::internal::Checkpoint;
+
+// Writes a checkpoint as if saved by as many procs as there are blocks.
+void write_checkpoint(
+    const Checkpoint::Kind kind,
+    const size_t n,
+    const uint64_t hasher_id,
+    const std::vector<std::string>& blocks) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    Checkpoint::Header header;
+    std::memcpy(header.magic, "BLZCKPT1", sizeof(header.magic));
+    header.kind = kind;
+    header.n = n;
+    header.n_procs = blocks.size();
+    header.hasher_id = hasher_id;
+    std::ofstream file(PATH, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& block : blocks) {
+      const uint64_t block_size = block.size();
+      file.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
+    }
+    for (const auto& block : blocks) file.write(block.data(), block.size());
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void remove_checkpoint() {
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (blaze::internal::MpiUtil::is_master()) std::remove(PATH);
+}
+
+}  // namespace
+
+TEST(CheckpointTest, DistVector) {
+  const size_t n = 1001;
+  blaze::DistVector<double> vec(n);
+  vec.for_each([](const size_t key, double& value) { value = key * 0.5; });
+  vec.save(PATH);
+  blaze::DistVector<double> loaded;
+  loaded.load(PATH);
+  EXPECT_EQ(loaded.size(), n);
+  EXPECT_EQ(blaze::collect(loaded), blaze::collect(vec));
+
+  // Values that go through hps, into a vector of another size.
+  blaze::DistVector<std::string> strs(n);
+  strs.for_each([](const size_t key, std::string& value) { value = std::to_string(key); });
+  strs.save(PATH);
+  blaze::DistVector<std::string> loaded_strs(3, "x");
+  loaded_strs.load(PATH);
+  EXPECT_EQ(blaze::collect(loaded_strs), blaze::collect(strs));
+  remove_checkpoint();
+}
+
+TEST(CheckpointTest, DistVectorFromOtherNProcs) {
+  // Round robin over one more proc than there are.
+  const size_t n = 1001;
+  const size_t n_saved_procs = blaze::internal::MpiUtil::get_n_procs() + 1;
+  std::vector<std::string> blocks(n_saved_procs);
+  for (size_t key = 0; key < n; key++) {
+    const double value = key * 0.5;
+    blocks[key % n_saved_procs].append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  write_checkpoint(Checkpoint::DIST_VECTOR, n, 0, blocks);
+  blaze::DistVector<double> vec;
+  vec.load(PATH);
+  const auto& values = blaze::collect(vec);
+  ASSERT_EQ(values.size(), n);
+  for (size_t key = 0; key < n; key++) EXPECT_EQ(values[key], key * 0.5);
+  remove_checkpoint();
+}
+
+TEST(CheckpointTest, DistHashMap) {
+  const int n_keys = 1000;
+  blaze::DistHashMap<std::string, long long> map;
+#pragma omp parallel for
+  for (int i = blaze::internal::MpiUtil::get_proc_id(); i < n_keys;
+       i += blaze::internal::MpiUtil::get_n_procs()) {
+    map.async_set("k" + std::to_string(i), i);
+  }
+  map.sync();
+  map.save(PATH);
+  blaze::DistHashMap<std::string, long long> loaded;
+  loaded.async_set("stale", -1);
+  loaded.sync();
+  loaded.load(PATH);
+  EXPECT_EQ(loaded.get_n_keys(), static_cast<size_t>(n_keys));
+  EXPECT_EQ(blaze::collect(loaded), blaze::collect(map));
+  loaded.for_each([&](const std::string& key, const size_t, const long long value) {
+    EXPECT_EQ(loaded.get_local(key, -1), value);
+  });
+  remove_checkpoint();
+}
+
+TEST(CheckpointTest, DistHashMapFromOtherNProcs) {
+  const size_t n_keys = 1000;
+  const size_t n_saved_procs = blaze::internal::MpiUtil::get_n_procs() + 1;
+  std::hash<std::string> hasher;
+  std::unordered_map<std::string, long long> expected;
+  for (size_t i = 0; i < n_keys; i++) expected["k" + std::to_string(i)] = i;
+
+  // By the saved hash values, and by rehashing the keys under another hasher, with the saved hash
+  // values zeroed.
+  const uint64_t hasher_ids[] = {Checkpoint::get_hasher_id<std::hash<std::string>>(), 0};
+  for (const uint64_t hasher_id : hasher_ids) {
+    std::vector<Checkpoint::MapPart<std::string, long long>> parts(n_saved_procs);
+    for (const auto& pair : expected) {
+      const size_t hash_value = hasher(pair.first);
+      auto& part = parts[hash_value % n_saved_procs];
+      part.first.push_back(hasher_id == 0 ? 0 : hash_value / n_saved_procs);
+      part.second.push_back(pair);
+    }
+    std::vector<std::string> blocks(n_saved_procs);
+    for (size_t i = 0; i < n_saved_procs; i++) {
+      blocks[i] = hps::to_string(std::vector<std::string>(1, hps::to_string(parts[i])));
+    }
+    write_checkpoint(Checkpoint::DIST_HASH_MAP, n_keys, hasher_id, blocks);
+    blaze::DistHashMap<std::string, long long> map;
+    map.load(PATH);
+    EXPECT_EQ(blaze::collect(map), expected);
+    map.for_each([&](const std::string& key, const size_t, const long long value) {
+      EXPECT_EQ(map.get_local(key, -1), value);
+    });
+    remove_checkpoint();
+  }
+}
+
+TEST(CheckpointTest, WrongKind) {
+  blaze::DistVector<double> vec(10);
+  vec.save(PATH);
+  blaze::DistHashMap<std::string, long long> map;
+  EXPECT_THROW(map.load(PATH), std::runtime_error);
+  remove_checkpoint();
+  EXPECT_THROW(vec.load("/tmp/blaze_missing_checkpoint.bin"), std::runtime_error);
+}
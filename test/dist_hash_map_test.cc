@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include "../src/dist_range.h"
+#include "../src/mapreduce.h"
 
 TEST(DistHashMapTest, AsyncSetAndSyncTest) {
   const long long N_KEYS = 100;
@@ -17,6 +18,156 @@ TEST(DistHashMapTest, AsyncSetAndSyncTest) {
   EXPECT_EQ(sum, N_KEYS * (N_KEYS - 1) / 2);
 }
 
+TEST(DistHashMapTest, SyncAsync) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 50;
+  blaze::DistHashMap<long long, long long> ds;
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  range.for_each(
+      [&](const long long i) { ds.async_set(i % N_KEYS, 1, blaze::Reducer<long long>::sum); });
+  auto handle = ds.sync_async(blaze::Reducer<long long>::sum);
+  while (!handle.test()) continue;
+  EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+  long long sum = 0;
+  ds.for_each_serial([&](const long long, const size_t, const long long value) { sum += value; });
+  EXPECT_EQ(sum, N_KEYS * N_REPEATS);
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithCombiner) {
+  const long long N_KEYS = 100;
+  const long long N_REPEATS = 50;
+  blaze::DistHashMap<long long, long long> ds;
+  ds.enable_combiner(16);
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  range.for_each(
+      [&](const long long i) { ds.async_set(i % N_KEYS, 1, blaze::Reducer<long long>::sum); });
+  ds.sync(blaze::Reducer<long long>::sum);
+  EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+  long long sum = 0;
+  ds.for_each_serial([&](const long long, const size_t, const long long value) { sum += value; });
+  EXPECT_EQ(sum, N_KEYS * N_REPEATS);
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithStreamingShuffle) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 50;
+  blaze::DistHashMap<long long, long long> ds;
+  ds.enable_streaming_shuffle(16);
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  for (int round = 1; round <= 2; round++) {
+    range.for_each(
+        [&](const long long i) { ds.async_set(i % N_KEYS, 1, blaze::Reducer<long long>::sum); });
+    ds.sync(blaze::Reducer<long long>::sum);
+    EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+    long long sum = 0;
+    ds.for_each_serial([&](const long long, const size_t, const long long value) { sum += value; });
+    EXPECT_EQ(sum, N_KEYS * N_REPEATS * round);
+  }
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithSpill) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 20;
+  blaze::DistHashMap<long long, long long> ds;
+  ds.enable_spill(64);
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  // Keys by i / N_REPEATS, since i % N_KEYS stays on the proc that owns it.
+  range.for_each([&](const long long i) {
+    ds.async_set(i / N_REPEATS, 1, blaze::Reducer<long long>::sum);
+  });
+  // Only remote keys spill.
+  if (blaze::internal::MpiUtil::get_n_procs() > 1) {
+    EXPECT_GT(ds.get_n_spilled_runs(), 0);
+  }
+  ds.sync(blaze::Reducer<long long>::sum);
+  EXPECT_EQ(ds.get_n_spilled_runs(), 0);
+  EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+  long long sum = 0;
+  ds.for_each_serial([&](const long long, const size_t, const long long value) { sum += value; });
+  EXPECT_EQ(sum, N_KEYS * N_REPEATS);
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithAppendShuffle) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 50;
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  for (const double max_repeat_rate : {0.5, 1.0}) {
+    blaze::DistHashMap<long long, long long> ds;
+    ds.enable_append_shuffle(max_repeat_rate);
+    for (int round = 1; round <= 2; round++) {
+      range.for_each(
+          [&](const long long i) { ds.async_set(i % N_KEYS, 1, blaze::Reducer<long long>::sum); });
+      ds.sync(blaze::Reducer<long long>::sum);
+      EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+      long long sum = 0;
+      ds.for_each_serial(
+          [&](const long long, const size_t, const long long value) { sum += value; });
+      EXPECT_EQ(sum, N_KEYS * N_REPEATS * round);
+    }
+  }
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithCompression) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 20;
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS);
+  // With and without the append shuffle, whose bufs are compressed as well.
+  for (const bool is_append_shuffle : {false, true}) {
+    blaze::DistHashMap<std::string, double> ds;
+    ds.enable_compression(0);
+    if (is_append_shuffle) ds.enable_append_shuffle(1.0);
+    range.for_each([&](const long long i) {
+      ds.async_set("key" + std::to_string(i % N_KEYS), 0.5, blaze::Reducer<double>::sum);
+    });
+    ds.sync(blaze::Reducer<double>::sum);
+    EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+    double sum = 0;
+    ds.for_each_serial([&](const std::string&, const size_t, const double value) { sum += value; });
+    EXPECT_EQ(sum, N_KEYS * N_REPEATS * 0.5);
+  }
+}
+
+TEST(DistHashMapTest, AsyncSetAndSyncWithHotKeys) {
+  const long long N_KEYS = 1000;
+  const long long N_REPEATS = 100;
+  blaze::DistHashMap<long long, long long> ds;
+  ds.enable_hot_key_detection();
+  blaze::DistRange<long long> range(0, N_KEYS * N_REPEATS * 2);
+  for (int round = 1; round <= 2; round++) {
+    range.for_each([&](const long long i) {
+      const long long key = i % 2 == 0 ? 0 : (i / 2) % N_KEYS;
+      ds.async_set(key, 1, blaze::Reducer<long long>::sum);
+    });
+    ds.sync(blaze::Reducer<long long>::sum);
+    EXPECT_EQ(ds.get_n_keys(), N_KEYS);
+    long long sum = 0;
+    ds.for_each_serial([&](const long long, const size_t, const long long value) { sum += value; });
+    EXPECT_EQ(sum, N_KEYS * N_REPEATS * 2 * round);
+  }
+}
+
+TEST(DistHashMapTest, CoPartitionedMapreduce) {
+  const long long N_KEYS = 100;
+  blaze::DistHashMap<long long, long long> ds;
+  blaze::DistRange<long long> range(0, N_KEYS);
+  range.for_each([&](const long long i) { ds.async_set(i, i); });
+  ds.sync();
+  const auto& mapper = [&](const long long key, const long long value, const auto& emit) {
+    emit(key, value * 2);
+  };
+  for (const bool co_partitioned : {false, true}) {
+    blaze::DistHashMap<long long, long long> ds2;
+    ds2.enable_combiner(16);
+    ds2.set_co_partitioned(co_partitioned);
+    blaze::mapreduce<long long, long long, long long, long long>(ds, mapper, "sum", ds2);
+    EXPECT_EQ(ds2.get_n_keys(), N_KEYS);
+    long long sum = 0;
+    ds2.for_each_serial(
+        [&](const long long, const size_t, const long long value) { sum += value; });
+    EXPECT_EQ(sum, N_KEYS * (N_KEYS - 1));
+  }
+}
+
 TEST(DistHashMapTest, Mapreduce) {
   const long long N_KEYS = 100;
   blaze::DistHashMap<long long, long long> ds;
@@ -28,3 +179,17 @@ TEST(DistHashMapTest, Mapreduce) {
   EXPECT_EQ(sum, N_KEYS * (N_KEYS - 1) / 2);
 }
 
+TEST(DistHashMapTest, MapreduceToVector) {
+  const long long N_KEYS = 100;
+  blaze::DistHashMap<long long, long long> ds;
+  blaze::DistRange<long long> range(0, N_KEYS);
+  range.for_each([&](const long long i) { ds.async_set(i, i); });
+  ds.sync();
+  const auto& mapper = [&](const long long key, const long long value, const auto& emit) {
+    emit(key % 2, value);
+  };
+  std::vector<long long> res(2, 0);
+  blaze::mapreduce<long long, long long, long long>(ds, mapper, "sum", res);
+  EXPECT_EQ(res[0] + res[1], N_KEYS * (N_KEYS - 1) / 2);
+  EXPECT_EQ(res[1] - res[0], N_KEYS / 2);
+}
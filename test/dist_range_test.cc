@@ -1,10 +1,16 @@
 #include "../src/dist_range_mapreducer.h"
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <functional>
+#include <numeric>
+#include <stdexcept>
 
+#include "../src/mapreduce.h"
 #include "../src/reducer.h"
+#include "../src/reducer_registry.h"
 
 TEST(DistRangeTest, SumSquaresMapreduce) {
   const size_t N_SAMPLES = 1000;
@@ -23,3 +29,232 @@ TEST(DistRangeTest, SumSquaresMapreduce) {
   blaze::DistRangeMapreducer<size_t>::mapreduce<size_t>(range, mapper, blaze::Reducer<size_t>::sum, result);
   EXPECT_EQ(result[0], expected);
 }
+
+TEST(DistRangeTest, SumSquaresMapreduceInlined) {
+  const size_t N_SAMPLES = 1000;
+  blaze::DistRange<size_t> range(1, N_SAMPLES + 1);
+  const auto& mapper = [&](const size_t i, const auto& emit) { emit(0, i * i); };
+  const auto& reducer = [](size_t& t1, const size_t& t2) { t1 += t2; };
+
+  std::vector<size_t> result(1);
+  blaze::DistRangeMapreducer<size_t>::mapreduce<size_t>(range, mapper, reducer, result);
+  const size_t expected = N_SAMPLES * (N_SAMPLES + 1) * (2 * N_SAMPLES + 1) / 6;
+  EXPECT_EQ(result[0], expected);
+
+  blaze::DistHashMap<size_t, size_t> result_map;
+  blaze::DistRangeMapreducer<size_t>::mapreduce(range, mapper, reducer, result_map);
+  EXPECT_EQ(result_map.get_n_keys(), 1);
+}
+
+TEST(DistRangeTest, MultiOutputMapreduce) {
+  const size_t N_SAMPLES = 1000;
+  blaze::DistRange<size_t> range(1, N_SAMPLES + 1);
+  const auto& mapper = [&](
+      const size_t i,
+      const auto& emit_sum,
+      const auto& emit_max,
+      const auto& emit_vec,
+      const auto& emit_map) {
+    emit_sum(0, i * i);
+    emit_max(i % 2, i);
+    emit_vec(i % 10, 1);
+    emit_map(i % 3, i);
+  };
+
+  std::vector<size_t> sum(1, 0);
+  std::vector<size_t> max(2, 0);
+  blaze::DistVector<size_t> vec(10, 0);
+  blaze::DistHashMap<size_t, size_t> map;
+  blaze::mapreduce(
+      range,
+      mapper,
+      blaze::output("sum", sum),
+      blaze::output(blaze::Reducer<size_t>::max, max),
+      blaze::output("sum", vec),
+      blaze::output([](size_t& t1, const size_t& t2) { t1 += t2; }, map));
+
+  EXPECT_EQ(sum[0], N_SAMPLES * (N_SAMPLES + 1) * (2 * N_SAMPLES + 1) / 6);
+  EXPECT_EQ(max[0], N_SAMPLES);
+  EXPECT_EQ(max[1], N_SAMPLES - 1);
+  std::vector<size_t> vec_sum(1, 0);
+  blaze::mapreduce<size_t, size_t>(
+      vec,
+      [&](const size_t, const size_t value, const auto& emit) { emit(0, value); },
+      "sum",
+      vec_sum);
+  EXPECT_EQ(vec_sum[0], N_SAMPLES);
+  EXPECT_EQ(map.get_n_keys(), 3);
+  std::vector<size_t> map_sum(1, 0);
+  blaze::mapreduce<size_t, size_t, size_t>(
+      map,
+      [&](const size_t, const size_t value, const auto& emit) { emit(0, value); },
+      "sum",
+      map_sum);
+  EXPECT_EQ(map_sum[0], N_SAMPLES * (N_SAMPLES + 1) / 2);
+}
+
+namespace {
+
+void count_sum(std::array<size_t, 2>& t1, const std::array<size_t, 2>& t2) {
+  t1[0] += t2[0];
+  t1[1] += t2[1];
+}
+
+}  // namespace
+
+TEST(DistRangeTest, RegisteredReducerMapreduce) {
+  const size_t N_SAMPLES = 1000;
+  using CountSum = std::array<size_t, 2>;
+  blaze::register_reducer<CountSum, count_sum>("count_sum");
+  blaze::register_reducer<CountSum, count_sum>("count_sum");
+  EXPECT_THROW(
+      (blaze::register_reducer<CountSum, blaze::Reducer<CountSum>::overwrite>("count_sum")),
+      std::invalid_argument);
+  blaze::DistRange<size_t> range(1, N_SAMPLES + 1);
+  const auto& mapper = [&](const size_t i, const auto& emit) { emit(i % 2, CountSum{{1, i}}); };
+
+  std::vector<CountSum> res(2, CountSum{{0, 0}});
+  blaze::mapreduce<size_t, CountSum>(range, mapper, "count_sum", res);
+  EXPECT_EQ(res[0][0], N_SAMPLES / 2);
+  EXPECT_EQ(res[0][1], N_SAMPLES * (N_SAMPLES + 2) / 4);
+  EXPECT_EQ(res[1][0], N_SAMPLES / 2);
+  EXPECT_EQ(res[1][1], N_SAMPLES * N_SAMPLES / 4);
+
+  res.assign(2, CountSum{{0, 0}});
+  blaze::mapreduce<size_t, CountSum>(range, mapper, count_sum, res);
+  EXPECT_EQ(res[0][0] + res[1][0], N_SAMPLES);
+
+  blaze::DistHashMap<size_t, CountSum> res_map;
+  blaze::mapreduce<size_t, size_t, CountSum>(range, mapper, "count_sum", res_map);
+  EXPECT_EQ(res_map.get_n_keys(), 2);
+}
+
+TEST(DistRangeTest, MultiOutputMapreduceVectorReductions) {
+  // Named and builtin reducers with MPI ops, a registered one, and lambdas without. The small
+  // vectors of the same MPI op share one reduction, and the large one stays sparse.
+  const size_t N_SAMPLES = 1000;
+  const size_t N_LARGE_KEYS = 1 << 16;
+  using CountSum = std::array<size_t, 2>;
+  blaze::register_reducer<CountSum, count_sum>("count_sum");
+  blaze::DistRange<size_t> range(1, N_SAMPLES + 1);
+  const auto& mapper = [&](
+      const size_t i,
+      const auto& emit_min,
+      const auto& emit_count_sum,
+      const auto& emit_lambda_sum,
+      const auto& emit_lambda_max,
+      const auto& emit_sum,
+      const auto& emit_count,
+      const auto& emit_large_sum) {
+    emit_min(i % 2, static_cast<double>(i));
+    emit_count_sum(0, CountSum{{1, i}});
+    emit_lambda_sum(i % 3, i);
+    emit_lambda_max(0, i);
+    emit_sum(i % 2, i);
+    emit_count(i % 2, 1);
+    emit_large_sum(i * 61 % N_LARGE_KEYS, 1);
+  };
+  std::vector<double> min(2, 0.5);
+  std::vector<CountSum> count(1, CountSum{{0, 0}});
+  std::vector<size_t> sum(3, 0);
+  std::vector<size_t> max(1, 0);
+  std::vector<size_t> sum_by_parity(2, 0);
+  std::vector<size_t> count_by_parity(2, 0);
+  std::vector<size_t> large_sum(N_LARGE_KEYS, 0);
+  blaze::mapreduce(
+      range,
+      mapper,
+      blaze::output("min", min),
+      blaze::output("count_sum", count),
+      blaze::output([](size_t& t1, const size_t& t2) { t1 += t2; }, sum),
+      blaze::output(
+          [](size_t& t1, const size_t& t2) {
+            if (t1 < t2) t1 = t2;
+          },
+          max),
+      blaze::output("sum", sum_by_parity),
+      blaze::output("sum", count_by_parity),
+      blaze::output(blaze::Reducer<size_t>::sum, large_sum));
+
+  EXPECT_EQ(min[0], 0.0);
+  EXPECT_EQ(min[1], 0.0);
+  EXPECT_EQ(count[0][0], N_SAMPLES);
+  EXPECT_EQ(count[0][1], N_SAMPLES * (N_SAMPLES + 1) / 2);
+  EXPECT_EQ(sum[0] + sum[1] + sum[2], N_SAMPLES * (N_SAMPLES + 1) / 2);
+  EXPECT_EQ(sum[1], 167167);
+  EXPECT_EQ(max[0], N_SAMPLES);
+  EXPECT_EQ(sum_by_parity[0], N_SAMPLES * (N_SAMPLES + 2) / 4);
+  EXPECT_EQ(sum_by_parity[1], N_SAMPLES * N_SAMPLES / 4);
+  EXPECT_EQ(count_by_parity[0], N_SAMPLES / 2);
+  EXPECT_EQ(count_by_parity[1], N_SAMPLES / 2);
+  EXPECT_EQ(large_sum[61], 1);
+  EXPECT_EQ(large_sum[62], 0);
+  EXPECT_EQ(std::accumulate(large_sum.begin(), large_sum.end(), size_t(0)), N_SAMPLES);
+}
+
+TEST(DistRangeTest, LargeVectorMapreduce) {
+  const size_t N_KEYS = 1 << 16;
+  blaze::DistRange<size_t> range(0, N_KEYS * 4);
+  const auto& mapper = [&](const size_t i, const auto& emit) { emit(i % N_KEYS, i); };
+  const auto& reducer = [](size_t& t1, const size_t& t2) { t1 += t2; };
+
+  std::vector<size_t> res(N_KEYS, 1);
+  blaze::mapreduce<size_t, size_t>(range, mapper, reducer, res);
+  for (size_t i = 0; i < N_KEYS; i++) {
+    ASSERT_EQ(res[i], 1 + i * 4 + N_KEYS * 6);
+  }
+}
+
+TEST(DistRangeTest, SparseVectorMapreduce) {
+  const size_t N_KEYS = 1 << 20;
+  const size_t N_TOUCHED_KEYS = 100;
+  blaze::DistRange<size_t> range(0, N_TOUCHED_KEYS * 10);
+  const auto& mapper = [&](const size_t i, const auto& emit) { emit((i % N_TOUCHED_KEYS) * 7, 1); };
+
+  std::vector<size_t> res(N_KEYS, 1);
+  blaze::mapreduce<size_t, size_t>(range, mapper, "sum", res);
+  for (size_t i = 0; i < N_KEYS; i++) {
+    ASSERT_EQ(res[i], (i % 7 == 0 && i / 7 < N_TOUCHED_KEYS) ? 11 : 1);
+  }
+}
+
+TEST(DistRangeTest, SparseVectorMinMaxMapreduce) {
+  // The untouched keys take the default value as from dense results, whether or not the vector is
+  // large enough to accumulate sparsely.
+  const size_t n_keys_list[] = {1000, 1 << 17};
+  blaze::DistRange<size_t> range(0, 100);
+  const auto& mapper = [&](const size_t i, const auto& emit) {
+    emit(i % 10, static_cast<int>(i % 10) + 1);
+  };
+  for (const size_t n_keys : n_keys_list) {
+    std::vector<int> res_min(n_keys, 5);
+    blaze::mapreduce<size_t, int>(range, mapper, "min", res_min);
+    std::vector<int> res_max(n_keys, 5);
+    blaze::mapreduce<size_t, int>(range, mapper, "max", res_max);
+    for (size_t i = 0; i < n_keys; i++) {
+      ASSERT_EQ(res_min[i], 0) << n_keys;
+      ASSERT_EQ(res_max[i], i < 10 ? std::max(5, static_cast<int>(i) + 1) : 5) << n_keys;
+    }
+  }
+}
+
+TEST(DistRangeTest, MapreduceToRoot) {
+  const size_t N_SAMPLES = 1000;
+  const int root = blaze::internal::MpiUtil::get_n_procs() - 1;
+  const bool is_root = blaze::internal::MpiUtil::get_proc_id() == root;
+  blaze::DistRange<size_t> range(1, N_SAMPLES + 1);
+  const auto& mapper = [&](const size_t i, const auto& emit) { emit(i % 2, i); };
+  const size_t expected_even = N_SAMPLES * (N_SAMPLES + 2) / 4;
+  const size_t expected_odd = N_SAMPLES * N_SAMPLES / 4;
+
+  std::vector<size_t> res(2, 0);
+  blaze::mapreduce_to_root(range, mapper, "sum", res, root);
+  EXPECT_EQ(res[0], is_root ? expected_even : 0);
+  EXPECT_EQ(res[1], is_root ? expected_odd : 0);
+
+  res.assign(2, 0);
+  const auto& reducer = [](size_t& t1, const size_t& t2) { t1 += t2; };
+  blaze::mapreduce_to_root(range, mapper, reducer, res, root);
+  EXPECT_EQ(res[0], is_root ? expected_even : 0);
+  EXPECT_EQ(res[1], is_root ? expected_odd : 0);
+}
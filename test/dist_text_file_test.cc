@@ -0,0 +1,97 @@
+#include "../src/dist_text_file.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/collect.h"
+#include "../src/mapreduce.h"
+#include "../src/pipeline.h"
+
+namespace {
+
+const char* FILENAME = "/tmp/blaze_dist_text_file_test.txt";
+
+void write_file(const std::string& content) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(FILENAME);
+    file << content;
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void remove_file() {
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (blaze::internal::MpiUtil::is_master()) std::remove(FILENAME);
+}
+
+}  // namespace
+
+TEST(DistTextFileTest, Lines) {
+  // Empty lines, a line across the ranges of several procs, and a last line without a newline.
+  const std::string long_line(1000, 'x');
+  const std::vector<std::vector<std::string>> files = {
+      {"a", "", "bc", long_line, "", "d", "efg"},
+      {long_line, "", ""},
+      {"", "h"},
+      {},
+  };
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto& expected = files[i];
+    std::string content;
+    for (size_t j = 0; j < expected.size(); j++) {
+      content += expected[j];
+      if (j + 1 < expected.size() || i % 2 == 1) content += '\n';
+    }
+    write_file(content);
+    blaze::DistTextFile file(FILENAME);
+    EXPECT_EQ(file.size(), expected.size());
+    blaze::DistVector<std::string> lines(file.size());
+    blaze::mapreduce<std::string>(
+        file,
+        [](const size_t line_id, const blaze::StringView& line, const auto& emit) {
+          emit(line_id, line.to_string());
+        },
+        "overwrite",
+        lines);
+    EXPECT_EQ(blaze::collect(lines), expected);
+    remove_file();
+  }
+}
+
+TEST(DistTextFileTest, WordCount) {
+  // Large enough for several blocks per proc.
+  const size_t n_lines = 1 << 21;
+  std::string content;
+  for (size_t i = 0; i < n_lines; i++) content += i % 3 == 0 ? "a b\n" : "b\n";
+  write_file(content);
+  blaze::DistTextFile file(FILENAME);
+  blaze::DistHashMap<std::string, size_t> counts;
+  blaze::mapreduce<std::string, size_t>(
+      file,
+      [](const size_t, const blaze::StringView& line, const auto& emit) {
+        for (const char c : line) {
+          if (c != ' ') emit(std::string(1, c), 1);
+        }
+      },
+      "sum",
+      counts);
+  const auto& counts_map = blaze::collect(counts);
+  EXPECT_EQ(counts_map.size(), 2);
+  EXPECT_EQ(counts_map.at("a"), (n_lines + 2) / 3);
+  EXPECT_EQ(counts_map.at("b"), n_lines);
+  std::vector<size_t> n_chars(1);
+  blaze::pipeline(file)
+      .map([](const size_t, const blaze::StringView& line, const auto& emit) {
+        emit(0, line.size());
+      })
+      .reduce("sum", n_chars);
+  EXPECT_EQ(n_chars[0], content.size() - n_lines);
+  remove_file();
+}
+
+TEST(DistTextFileTest, MissingFile) {
+  EXPECT_THROW(blaze::DistTextFile("/tmp/blaze_missing_file.txt"), std::runtime_error);
+}
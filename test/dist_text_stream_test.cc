@@ -0,0 +1,108 @@
+#include "../src/dist_text_stream.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/collect.h"
+#include "../src/mapreduce.h"
+#include "../src/pipeline.h"
+
+namespace {
+
+const char* PATTERN = "/tmp/blaze_dist_text_stream_test_*.txt";
+
+std::string get_filename(const size_t file_id) {
+  return "/tmp/blaze_dist_text_stream_test_" + std::to_string(file_id) + ".txt";
+}
+
+void write_files(const std::vector<std::string>& contents) {
+  if (blaze::internal::MpiUtil::is_master()) {
+    for (size_t i = 0; i < contents.size(); i++) {
+      std::ofstream file(get_filename(i));
+      file << contents[i];
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void remove_files(const size_t n_files) {
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (blaze::internal::MpiUtil::is_master()) {
+    for (size_t i = 0; i < n_files; i++) std::remove(get_filename(i).c_str());
+  }
+}
+
+}  // namespace
+
+TEST(DistTextStreamTest, Lines) {
+  // Empty lines, lines longer than a chunk and across the ranges of several procs, an empty file,
+  // and a last line without a newline.
+  const std::string long_line(100, 'x');
+  const std::vector<std::string> contents = {
+      "a\n\nbc\n" + long_line + "\n\nd\nefg",
+      long_line + "\n\n\n",
+      "",
+      "\nh\na\n",
+  };
+  write_files(contents);
+  std::unordered_map<std::string, size_t> expected;
+  for (const auto& content : contents) {
+    size_t line_begin = 0;
+    while (line_begin < content.size()) {
+      size_t line_end = content.find('\n', line_begin);
+      if (line_end == std::string::npos) line_end = content.size();
+      expected[content.substr(line_begin, line_end - line_begin)]++;
+      line_begin = line_end + 1;
+    }
+  }
+  for (const size_t chunk_size : {1, 3, 16, 1 << 20}) {
+    blaze::DistTextStream stream(PATTERN, chunk_size);
+    EXPECT_EQ(stream.get_filenames().size(), contents.size());
+    blaze::DistHashMap<std::string, size_t> counts;
+    blaze::mapreduce<std::string, size_t>(
+        stream,
+        [](const blaze::StringView& line, const auto& emit) { emit(line.to_string(), 1); },
+        "sum",
+        counts);
+    EXPECT_EQ(blaze::collect(counts), expected);
+  }
+  remove_files(contents.size());
+}
+
+TEST(DistTextStreamTest, WordCount) {
+  // Large enough for several chunks and blocks per proc.
+  const size_t n_lines = 1 << 21;
+  std::string content;
+  for (size_t i = 0; i < n_lines; i++) content += i % 3 == 0 ? "a b\n" : "b\n";
+  write_files({content, content});
+  blaze::DistTextStream stream(
+      std::vector<std::string>({get_filename(0), get_filename(1)}), 1 << 20);
+  blaze::DistHashMap<std::string, size_t> counts;
+  blaze::mapreduce<std::string, size_t>(
+      stream,
+      [](const blaze::StringView& line, const auto& emit) {
+        for (const char c : line) {
+          if (c != ' ') emit(std::string(1, c), 1);
+        }
+      },
+      "sum",
+      counts);
+  const auto& counts_map = blaze::collect(counts);
+  EXPECT_EQ(counts_map.size(), 2);
+  EXPECT_EQ(counts_map.at("a"), (n_lines + 2) / 3 * 2);
+  EXPECT_EQ(counts_map.at("b"), n_lines * 2);
+  std::vector<size_t> n_chars(1);
+  blaze::pipeline(stream)
+      .map([](const blaze::StringView& line, const auto& emit) { emit(0, line.size()); })
+      .reduce("sum", n_chars);
+  EXPECT_EQ(n_chars[0], (content.size() - n_lines) * 2);
+  remove_files(2);
+}
+
+TEST(DistTextStreamTest, MissingFile) {
+  EXPECT_THROW(blaze::DistTextStream("/tmp/blaze_missing_file_*.txt"), std::runtime_error);
+}
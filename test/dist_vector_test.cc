@@ -1,6 +1,7 @@
 #include "../src/dist_vector_mapreducer.h"
 
 #include <gtest/gtest.h>
+#include <omp.h>
 #include <functional>
 
 #include "../src/dist_range.h"
@@ -34,6 +35,205 @@ TEST(DistVectorTest, SumSquares) {
   EXPECT_EQ(res[0], expected);
 }
 
+TEST(DistVectorTest, AsyncSetAndSyncWithStreamingShuffle) {
+  const size_t LEN = 1000;
+  const size_t N_REPEATS = 50;
+  blaze::DistVector<size_t> vec(LEN, 0);
+  vec.enable_streaming_shuffle(16);
+  blaze::DistRange<size_t> range(0, LEN * N_REPEATS);
+  range.for_each(
+      [&](const size_t i) { vec.async_set(i % LEN, i / LEN, blaze::Reducer<size_t>::sum); });
+  vec.sync(blaze::Reducer<size_t>::sum);
+
+  std::vector<size_t> res(1, 0);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+  EXPECT_EQ(res[0], LEN * N_REPEATS * (N_REPEATS - 1) / 2);
+}
+
+TEST(DistVectorTest, AsyncSetAndSyncWithSpill) {
+  const size_t LEN = 1000;
+  const size_t N_REPEATS = 20;
+  blaze::DistVector<size_t> vec(LEN, 0);
+  vec.enable_spill(64);
+  blaze::DistRange<size_t> range(0, LEN * N_REPEATS);
+  // Keys by i / N_REPEATS, since i % LEN stays on the proc that owns it.
+  range.for_each(
+      [&](const size_t i) { vec.async_set(i / N_REPEATS, 1, blaze::Reducer<size_t>::sum); });
+  // Only remote keys spill.
+  if (blaze::internal::MpiUtil::get_n_procs() > 1) {
+    EXPECT_GT(vec.get_n_spilled_runs(), 0);
+  }
+  vec.sync(blaze::Reducer<size_t>::sum);
+  EXPECT_EQ(vec.get_n_spilled_runs(), 0);
+
+  std::vector<size_t> res(1, 0);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+  EXPECT_EQ(res[0], LEN * N_REPEATS);
+}
+
+TEST(DistVectorTest, AsyncSetAndSyncWithAppendShuffle) {
+  const size_t LEN = 1000;
+  const size_t N_REPEATS = 50;
+  blaze::DistRange<size_t> range(0, LEN * N_REPEATS);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  // With the default rate, threads go back to the hashed maps in the middle of the round.
+  for (const double max_repeat_rate : {0.5, 1.0}) {
+    blaze::DistVector<size_t> vec(LEN, 0);
+    vec.enable_append_shuffle(max_repeat_rate);
+    range.for_each(
+        [&](const size_t i) { vec.async_set(i % LEN, i / LEN, blaze::Reducer<size_t>::sum); });
+    vec.sync(blaze::Reducer<size_t>::sum);
+
+    std::vector<size_t> res(1, 0);
+    blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+    EXPECT_EQ(res[0], LEN * N_REPEATS * (N_REPEATS - 1) / 2);
+  }
+
+  blaze::DistVector<size_t> vec(LEN * N_REPEATS, 0);
+  vec.enable_append_shuffle();
+  range.for_each([&](const size_t i) { vec.async_set(i, i, blaze::Reducer<size_t>::sum); });
+  vec.sync(blaze::Reducer<size_t>::sum);
+  std::vector<size_t> res(1, 0);
+  blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+  EXPECT_EQ(res[0], LEN * N_REPEATS * (LEN * N_REPEATS - 1) / 2);
+}
+
+TEST(DistVectorTest, AsyncSetAndSyncWithShufflePlan) {
+  const size_t LEN = 1000;
+  const size_t N_PLANNED_KEYS = 500;
+  auto plan = std::make_shared<blaze::DistVector<size_t>::ShufflePlan>();
+  blaze::DistRange<size_t> range(0, LEN);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  for (size_t round = 1; round <= 3; round++) {
+    blaze::DistVector<size_t> vec(LEN, 0);
+    vec.set_shuffle_plan(plan);
+    // The last round also sets keys that are not on the plan.
+    const size_t n_keys = round == 3 ? LEN : N_PLANNED_KEYS;
+    range.for_each(
+        [&](const size_t i) { vec.async_set(i / 3 % n_keys, round, blaze::Reducer<size_t>::sum); });
+    vec.sync(blaze::Reducer<size_t>::sum);
+    EXPECT_TRUE(plan->is_recorded());
+
+    std::vector<size_t> res(1, 0);
+    blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+    EXPECT_EQ(res[0], LEN * round);
+  }
+}
+
+TEST(DistVectorTest, ShufflePlanReplayWithoutIdentity) {
+  const size_t LEN = 1000;
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  // Neither reducer takes the V() unset slots hold as its identity, and the replays leave the keys
+  // past n_keys unset.
+  for (const auto& reducer : {blaze::Reducer<size_t>::min, blaze::Reducer<size_t>::overwrite}) {
+    const bool is_min = reducer == blaze::Reducer<size_t>::min;
+    auto plan = std::make_shared<blaze::DistVector<size_t>::ShufflePlan>();
+    for (size_t round = 1; round <= 3; round++) {
+      blaze::DistVector<size_t> vec(LEN, LEN);
+      vec.set_shuffle_plan(plan);
+      const size_t n_keys = round == 1 ? LEN : LEN / 2;
+      // Min sees each key several times, overwrite once.
+      blaze::DistRange<size_t> range(0, is_min ? n_keys * 3 : n_keys);
+      range.for_each([&](const size_t i) { vec.async_set(i % n_keys, i, reducer); });
+      vec.sync(reducer);
+
+      std::vector<size_t> res(1, 0);
+      blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+      EXPECT_EQ(res[0], n_keys * (n_keys - 1) / 2 + (LEN - n_keys) * LEN);
+    }
+  }
+}
+
+TEST(DistVectorTest, ShufflePlanReplayOnMoreThreads) {
+  const size_t LEN = 1000;
+  auto plan = std::make_shared<blaze::DistVector<size_t>::ShufflePlan>();
+  blaze::DistRange<size_t> range(0, LEN);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  const int max_threads = omp_get_max_threads();
+  // Recorded on one thread, replayed on more threads than that, and then on as many as the plan
+  // resized itself to.
+  for (const int n_threads : {1, 4, 4}) {
+    omp_set_num_threads(n_threads);
+    blaze::DistVector<size_t> vec(LEN, 0);
+    vec.set_shuffle_plan(plan);
+    range.for_each([&](const size_t i) { vec.async_set(i / 3, 1, blaze::Reducer<size_t>::sum); });
+    vec.sync(blaze::Reducer<size_t>::sum);
+
+    std::vector<size_t> res(1, 0);
+    blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+    EXPECT_EQ(res[0], LEN);
+  }
+  omp_set_num_threads(max_threads);
+}
+
+TEST(DistVectorTest, SyncAsync) {
+  const size_t LEN = 1000;
+  const size_t N_REPEATS = 50;
+  blaze::DistRange<size_t> range(0, LEN * N_REPEATS);
+  const auto& mapper = [&](const size_t, const size_t& value, const auto& emit) { emit(0, value); };
+  blaze::DistVector<size_t> vec(LEN, 0);
+  range.for_each(
+      [&](const size_t i) { vec.async_set(i % LEN, i / LEN, blaze::Reducer<size_t>::sum); });
+  auto handle = vec.sync_async(blaze::Reducer<size_t>::sum);
+
+  // Another round runs while the first one is in flight.
+  blaze::DistVector<size_t> vec2(LEN, 0);
+  range.for_each([&](const size_t i) { vec2.async_set(i % LEN, 1, blaze::Reducer<size_t>::sum); });
+  vec2.sync(blaze::Reducer<size_t>::sum);
+  std::vector<size_t> res2(1, 0);
+  blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec2, mapper, "sum", res2);
+  EXPECT_EQ(res2[0], LEN * N_REPEATS);
+
+  handle.wait();
+  EXPECT_TRUE(handle.test());
+  std::vector<size_t> res(1, 0);
+  blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec, mapper, "sum", res);
+  EXPECT_EQ(res[0], LEN * N_REPEATS * (N_REPEATS - 1) / 2);
+}
+
+TEST(DistVectorTest, CoPartitionedMapreduce) {
+  const size_t LEN = 1000;
+  blaze::DistVector<size_t> vec(LEN, 1);
+  const auto& mapper = [&](const size_t key, const size_t& value, const auto& emit) {
+    emit(key, value + key);
+  };
+  std::vector<size_t> res(1, 0);
+  const auto& sum_mapper = [&](const size_t, const size_t& value, const auto& emit) {
+    emit(0, value);
+  };
+  for (const bool co_partitioned : {false, true}) {
+    blaze::DistVector<size_t> vec2(LEN, 0);
+    vec2.set_co_partitioned(co_partitioned);
+    blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(
+        vec, mapper, blaze::Reducer<size_t>::sum, vec2);
+    res[0] = 0;
+    blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(vec2, sum_mapper, "sum", res);
+    EXPECT_EQ(res[0], LEN + LEN * (LEN - 1) / 2);
+  }
+
+  if (blaze::internal::MpiUtil::get_n_procs() == 1) return;
+  blaze::DistVector<size_t> vec3(LEN, 0);
+  vec3.set_co_partitioned(true);
+  const auto& remote_mapper = [&](const size_t key, const size_t& value, const auto& emit) {
+    emit((key + 1) % LEN, value);
+  };
+  EXPECT_THROW(
+      blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(
+          vec, remote_mapper, blaze::Reducer<size_t>::sum, vec3),
+      std::runtime_error);
+
+  // A remote key on proc 0 only throws on all procs.
+  const auto& one_remote_mapper = [&](const size_t key, const size_t& value, const auto& emit) {
+    emit(key == 0 ? 1 : key, value);
+  };
+  EXPECT_THROW(
+      blaze::DistVectorMapreducer<size_t>::mapreduce<size_t>(
+          vec, one_remote_mapper, blaze::Reducer<size_t>::sum, vec3),
+      std::runtime_error);
+}
+
 TEST(DistVectorTest, TopK) {
   const size_t LEN = (1 << 10) + 15;
   blaze::DistVector<double> vec(LEN);
@@ -0,0 +1,55 @@
+#include "../src/internal/exchange_scheduler.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Plan = blaze::internal::ExchangeScheduler::Plan;
+
+std::string get_msg(const int src_proc_id, const int dest_proc_id, const size_t size) {
+  std::string msg(size, 0);
+  for (size_t i = 0; i < size; i++) msg[i] = static_cast<char>(src_proc_id * 7 + dest_proc_id + i);
+  return msg;
+}
+
+}  // namespace
+
+TEST(ExchangeSchedulerTest, GetPlan) {
+  const size_t MB = 1 << 20;
+  EXPECT_EQ(
+      blaze::internal::ExchangeScheduler::get_plan({0, 100, 100, 0, 0, 100, 5, 0, 0}),
+      Plan::ALLTOALLV);
+  EXPECT_EQ(
+      blaze::internal::ExchangeScheduler::get_plan({0, MB, MB, MB, 0, 2 * MB, MB, MB, 0}),
+      Plan::PAIRWISE);
+  EXPECT_EQ(
+      blaze::internal::ExchangeScheduler::get_plan({0, 100 * MB, MB, 10, 0, 10, 10, 10, 0}),
+      Plan::WINDOWED);
+}
+
+TEST(ExchangeSchedulerTest, AllToAll) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  // Messages of very different sizes, and none to the next proc.
+  const auto& get_size = [&](const int src_proc_id, const int dest_proc_id) -> size_t {
+    if (dest_proc_id == (src_proc_id + 1) % n_procs) return 0;
+    return (src_proc_id + dest_proc_id) % 3 == 0 ? 100000 : 10 * dest_proc_id;
+  };
+  std::vector<std::string> send_bufs(n_procs);
+  for (int i = 0; i < n_procs; i++) {
+    if (i != proc_id) send_bufs[i] = get_msg(proc_id, i, get_size(proc_id, i));
+  }
+  std::vector<size_t> size_matrix;
+  blaze::internal::ExchangeScheduler::gather_size_matrix(send_bufs, size_matrix);
+  for (const Plan plan : {Plan::ALLTOALLV, Plan::PAIRWISE, Plan::WINDOWED}) {
+    std::vector<std::string> recv_bufs;
+    blaze::internal::ExchangeScheduler::all_to_all(send_bufs, recv_bufs, plan, size_matrix);
+    ASSERT_EQ(recv_bufs.size(), n_procs);
+    for (int i = 0; i < n_procs; i++) {
+      if (i == proc_id) continue;
+      EXPECT_EQ(recv_bufs[i], get_msg(i, proc_id, get_size(i, proc_id)));
+    }
+  }
+}
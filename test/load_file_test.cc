@@ -1,6 +1,12 @@
 #include "../src/util.h"
 
 #include <gtest/gtest.h>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "../src/collect.h"
 #include "../src/mapreduce.h"
@@ -16,3 +22,75 @@ TEST(LoadFileTest, LoadAndSumNumbers) {
 
   EXPECT_EQ(result_vec[0], 255);
 }
+
+TEST(LoadFileTest, LineBoundaries) {
+  // Empty lines, a line across the ranges of several procs, and a last line without a newline.
+  const std::string long_line(1000, 'x');
+  const std::vector<std::vector<std::string>> files = {
+      {"a", "", "bc", long_line, "", "d", "efg"},
+      {long_line, "", ""},
+      {"", "h"},
+      {},
+  };
+  const std::string filename = "/tmp/blaze_load_file_test.txt";
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto& expected = files[i];
+    if (blaze::internal::MpiUtil::is_master()) {
+      std::ofstream file(filename);
+      for (size_t j = 0; j < expected.size(); j++) {
+        file << expected[j];
+        if (j + 1 < expected.size() || i % 2 == 1) file << '\n';
+      }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto lines = blaze::util::load_file(filename);
+    EXPECT_EQ(blaze::collect(lines), expected);
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  if (blaze::internal::MpiUtil::is_master()) std::remove(filename.c_str());
+}
+
+TEST(LoadFileTest, LoadNumbers) {
+  // Commas and whitespace, comments, blank lines, a CRLF line, extra fields, and a line across the
+  // ranges of several procs.
+  const std::string filename = "/tmp/blaze_load_numbers_test.txt";
+  std::vector<std::array<double, 3>> expected;
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream file(filename);
+    file << "# x, y, z\n1.5,-2,3e2\n\n  4\t5 6 7\r\n";
+    file << std::string(1000, ' ') << "-0.25, 1e-3 ,8\n";
+    for (int i = 0; i < 1000; i++) file << i << ' ' << i * 0.5 << ' ' << -i << '\n';
+    file << "9 10 11";
+  }
+  expected.push_back({{1.5, -2, 300}});
+  expected.push_back({{4, 5, 6}});
+  expected.push_back({{-0.25, 0.001, 8}});
+  for (int i = 0; i < 1000; i++) expected.push_back({{i * 1.0, i * 0.5, -i * 1.0}});
+  expected.push_back({{9, 10, 11}});
+  MPI_Barrier(MPI_COMM_WORLD);
+  auto points = blaze::util::load_numbers<double, 3>(filename);
+  EXPECT_EQ(points.size(), expected.size());
+  EXPECT_EQ(blaze::collect(points), expected);
+
+  // An edge list.
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (blaze::internal::MpiUtil::is_master()) {
+    std::ofstream(filename) << "0\t1\n0\t18446744073709551615\n# comment\n2\t0\n";
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  auto edges = blaze::util::load_numbers<size_t, 2>(filename);
+  const std::vector<std::array<size_t, 2>> expected_edges = {
+      {{0, 1}}, {{0, 18446744073709551615ULL}}, {{2, 0}}};
+  EXPECT_EQ(blaze::collect(edges), expected_edges);
+
+  // A line with too few fields, and a field that is not a number.
+  const std::string malformed_files[] = {"1 2\n3\n4 5\n", "1 2\n3 4x\n"};
+  for (const auto& malformed_file : malformed_files) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (blaze::internal::MpiUtil::is_master()) std::ofstream(filename) << malformed_file;
+    MPI_Barrier(MPI_COMM_WORLD);
+    EXPECT_THROW((blaze::util::load_numbers<int, 2>(filename)), std::runtime_error);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (blaze::internal::MpiUtil::is_master()) std::remove(filename.c_str());
+}
@@ -0,0 +1,113 @@
+#include "../src/internal/number_parser.h"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+using NumberParser = blaze::internal::NumberParser;
+
+// The parsed value and the number of chars parsed, or -1 on failure.
+template <class T>
+int parse(const std::string& str, T& value) {
+  const char* begin = str.data();
+  const char* end = NumberParser::parse(begin, begin + str.size(), value);
+  return end == begin ? -1 : end - begin;
+}
+
+}  // namespace
+
+TEST(NumberParserTest, Integers) {
+  int value;
+  EXPECT_EQ(parse("123", value), 3);
+  EXPECT_EQ(value, 123);
+  EXPECT_EQ(parse("-45,6", value), 3);
+  EXPECT_EQ(value, -45);
+  EXPECT_EQ(parse("+7 8", value), 2);
+  EXPECT_EQ(value, 7);
+  EXPECT_EQ(parse("2147483647", value), 10);
+  EXPECT_EQ(value, 2147483647);
+  EXPECT_EQ(parse("-2147483648", value), 11);
+  EXPECT_EQ(value, -2147483647 - 1);
+  EXPECT_EQ(parse("2147483648", value), -1);
+  EXPECT_EQ(parse("-", value), -1);
+  EXPECT_EQ(parse("x1", value), -1);
+  EXPECT_EQ(parse("", value), -1);
+
+  uint64_t u64;
+  EXPECT_EQ(parse("18446744073709551615", u64), 20);
+  EXPECT_EQ(u64, UINT64_MAX);
+  EXPECT_EQ(parse("18446744073709551616", u64), -1);
+  EXPECT_EQ(parse("-1", u64), -1);
+  int64_t i64;
+  EXPECT_EQ(parse("-9223372036854775808", i64), 20);
+  EXPECT_EQ(i64, INT64_MIN);
+  EXPECT_EQ(parse("9223372036854775808", i64), -1);
+}
+
+TEST(NumberParserTest, Doubles) {
+  const char* strs[] = {"0",
+                        "-0.0",
+                        "1.5",
+                        ".25",
+                        "7.",
+                        "-3.14159",
+                        "1e10",
+                        "2.5E-3",
+                        "1e+22",
+                        "1e23",
+                        "4.9e-324",
+                        "1.7976931348623157e308",
+                        "0.1",
+                        "0.000000000000000000000000000001",
+                        "123456789012345678901234567890",
+                        "9007199254740993",
+                        "2.2250738585072011e-308"};
+  for (const std::string str : strs) {
+    double value;
+    EXPECT_EQ(parse(str, value), static_cast<int>(str.size())) << str;
+    EXPECT_EQ(value, std::strtod(str.c_str(), nullptr)) << str;
+    EXPECT_EQ(std::signbit(value), str[0] == '-') << str;
+  }
+
+  // An exponent without digits is not part of the number.
+  double value;
+  EXPECT_EQ(parse("3e", value), 1);
+  EXPECT_EQ(value, 3.0);
+  EXPECT_EQ(parse("3e+x", value), 1);
+  EXPECT_EQ(parse(".", value), -1);
+  EXPECT_EQ(parse("-e5", value), -1);
+
+  float float_value;
+  EXPECT_EQ(parse("0.1", float_value), 3);
+  EXPECT_EQ(float_value, 0.1f);
+  EXPECT_EQ(parse("16777217", float_value), 8);
+  EXPECT_EQ(float_value, std::strtof("16777217", nullptr));
+}
+
+TEST(NumberParserTest, RandomDoubles) {
+  std::mt19937_64 generator(0);
+  std::uniform_int_distribution<uint64_t> bits;
+  char str[64];
+  for (int i = 0; i < 100000; i++) {
+    // Random bit patterns, and short decimals.
+    double expected;
+    if (i % 2 == 0) {
+      const uint64_t expected_bits = bits(generator);
+      std::memcpy(&expected, &expected_bits, sizeof(expected));
+      if (!std::isfinite(expected)) continue;
+      snprintf(str, sizeof(str), "%.17g", expected);
+    } else {
+      snprintf(str, sizeof(str), "%.*f", i % 9, (bits(generator) % 2000000) / 1000.0 - 1000.0);
+    }
+    double value;
+    ASSERT_EQ(parse(str, value), static_cast<int>(std::strlen(str))) << str;
+    ASSERT_EQ(value, std::strtod(str, nullptr)) << str;
+  }
+}
@@ -0,0 +1,96 @@
+#include "../src/internal/object_transport.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace {
+
+using blaze::internal::ObjectTransport;
+using blaze::internal::PodLayout;
+
+std::vector<std::array<int, 2>> get_pairs(const int proc_id) {
+  std::vector<std::array<int, 2>> pairs(10 * proc_id + 3);
+  for (size_t i = 0; i < pairs.size(); i++) pairs[i] = {{proc_id, static_cast<int>(i)}};
+  return pairs;
+}
+
+std::vector<std::string> get_words(const int proc_id) {
+  return std::vector<std::string>(proc_id + 1, "word" + std::to_string(proc_id));
+}
+
+}  // namespace
+
+TEST(ObjectTransportTest, PodLayout) {
+  EXPECT_TRUE(PodLayout<double>::IS_POD);
+  EXPECT_TRUE(PodLayout<std::vector<double>>::IS_POD);
+  EXPECT_TRUE((PodLayout<std::vector<std::array<int, 2>>>::IS_POD));
+  EXPECT_FALSE(PodLayout<std::vector<bool>>::IS_POD);
+  EXPECT_FALSE(PodLayout<std::vector<std::string>>::IS_POD);
+  EXPECT_FALSE(PodLayout<std::string>::IS_POD);
+}
+
+TEST(ObjectTransportTest, SendRecv) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const int next_proc_id = (proc_id + 1) % n_procs;
+  const int prev_proc_id = (proc_id + n_procs - 1) % n_procs;
+  std::vector<std::array<int, 2>> pairs;
+  ObjectTransport::send_recv(get_pairs(proc_id), next_proc_id, pairs, prev_proc_id);
+  EXPECT_EQ(pairs, get_pairs(prev_proc_id));
+  std::vector<std::string> words;
+  ObjectTransport::send_recv(get_words(proc_id), next_proc_id, words, prev_proc_id);
+  EXPECT_EQ(words, get_words(prev_proc_id));
+  if (n_procs == 1) return;
+
+  if (proc_id == 0) {
+    ObjectTransport::send(get_pairs(0), 1);
+    ObjectTransport::send(2.5, 1);
+  } else if (proc_id == 1) {
+    ObjectTransport::recv(pairs, 0);
+    EXPECT_EQ(pairs, get_pairs(0));
+    double value = 0.0;
+    ObjectTransport::recv(value, 0);
+    EXPECT_EQ(value, 2.5);
+  }
+}
+
+TEST(ObjectTransportTest, Broadcast) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const int root = n_procs - 1;
+  const blaze::internal::NodeComm nodes(2);
+  auto pairs = proc_id == root ? get_pairs(root) : get_pairs(0);
+  ObjectTransport::broadcast(pairs, root);
+  EXPECT_EQ(pairs, get_pairs(root));
+  std::vector<double> values(proc_id == root ? 5 : 0, 1.5);
+  ObjectTransport::broadcast(values, root, nodes);
+  EXPECT_EQ(values, std::vector<double>(5, 1.5));
+  auto words = proc_id == root ? get_words(root) : std::vector<std::string>();
+  ObjectTransport::broadcast(words, root, nodes);
+  EXPECT_EQ(words, get_words(root));
+}
+
+TEST(ObjectTransportTest, Allgather) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  // Flat, and across the leaders of nodes of 2 procs.
+  for (const int ranks_per_node : {n_procs, 2}) {
+    const blaze::internal::NodeComm nodes(ranks_per_node);
+    std::vector<std::vector<std::array<int, 2>>> pairs;
+    ObjectTransport::allgather(get_pairs(proc_id), pairs, nodes);
+    std::vector<int> ids;
+    ObjectTransport::allgather(proc_id * 3, ids, nodes);
+    std::vector<std::vector<std::string>> words;
+    ObjectTransport::allgather(get_words(proc_id), words, nodes);
+    ASSERT_EQ(pairs.size(), n_procs);
+    ASSERT_EQ(ids.size(), n_procs);
+    ASSERT_EQ(words.size(), n_procs);
+    for (int i = 0; i < n_procs; i++) {
+      EXPECT_EQ(pairs[i], get_pairs(i));
+      EXPECT_EQ(ids[i], i * 3);
+      EXPECT_EQ(words[i], get_words(i));
+    }
+  }
+}
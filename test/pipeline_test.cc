@@ -0,0 +1,72 @@
+#include "../src/pipeline.h"
+
+#include <gtest/gtest.h>
+#include <mpi.h>
+#include <vector>
+
+#include "../src/dist_range.h"
+#include "../src/reducer.h"
+
+TEST(PipelineTest, RangeFilterMapReduce) {
+  const size_t N = 1000;
+  blaze::DistRange<size_t> range(0, N);
+  std::vector<size_t> res(2, 0);
+  blaze::pipeline(range)
+      .filter([&](const size_t value) { return value % 3 == 0; })
+      .map([&](const size_t value, const auto& emit) { emit(value, value * value); })
+      .map([&](const size_t key, const size_t value, const auto& emit) { emit(key % 2, value); })
+      .reduce("sum", res);
+  size_t expected_even = 0;
+  size_t expected_odd = 0;
+  for (size_t i = 0; i < N; i += 3) {
+    if (i % 2 == 0) {
+      expected_even += i * i;
+    } else {
+      expected_odd += i * i;
+    }
+  }
+  EXPECT_EQ(res[0], expected_even);
+  EXPECT_EQ(res[1], expected_odd);
+}
+
+TEST(PipelineTest, VectorToHashMap) {
+  const size_t N = 1000;
+  blaze::DistVector<size_t> vec(N, 1);
+  blaze::DistHashMap<size_t, size_t> counts;
+  blaze::pipeline(vec)
+      .map([&](const size_t key, const size_t value, const auto& emit) {
+        emit(key % 10, value);
+        emit(key % 10 + 10, value * 2);
+      })
+      .reduce(blaze::Reducer<size_t>::sum, counts);
+  EXPECT_EQ(counts.get_n_keys(), 20);
+
+  std::vector<size_t> total(1, 0);
+  blaze::pipeline(counts)
+      .filter([&](const size_t key, const size_t) { return key >= 10; })
+      .map([&](const size_t, const size_t value, const auto& emit) { emit(0, value); })
+      .reduce("sum", total);
+  EXPECT_EQ(total[0], N * 2);
+}
+
+TEST(PipelineTest, ForEach) {
+  const size_t N = 1000;
+  blaze::DistRange<size_t> range(0, N);
+  std::vector<int> n_visits(N, 0);
+  blaze::pipeline(range)
+      .filter([&](const size_t value) { return value < N / 2; })
+      .for_each([&](const size_t value) {
+#pragma omp atomic
+        n_visits[value]++;
+      });
+  // Each record passing the filter is visited exactly once, on one of the procs.
+  MPI_Allreduce(MPI_IN_PLACE, n_visits.data(), N, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  for (size_t i = 0; i < N; i++) EXPECT_EQ(n_visits[i], i < N / 2 ? 1 : 0);
+
+  std::vector<size_t> n_total(1, 0);
+  blaze::pipeline(range)
+      .filter([&](const size_t value) { return value < N / 2; })
+      .map([&](const size_t, const auto& emit) { emit(0, 1); })
+      .reduce("sum", n_total);
+  EXPECT_EQ(n_total[0], N / 2);
+}
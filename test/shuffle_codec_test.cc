@@ -0,0 +1,137 @@
+#include "../src/internal/shuffle_codec.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string get_text(const size_t n_words) {
+  std::string text;
+  for (size_t i = 0; i < n_words; i++) text += "word" + std::to_string(i * 7 % 100) + " ";
+  return text;
+}
+
+void expect_round_trip(const std::string& data) {
+  std::string block;
+  blaze::internal::LzCodec::compress(data.data(), data.size(), block);
+  std::string res;
+  blaze::internal::LzCodec::decompress(block.data(), block.size(), res);
+  EXPECT_EQ(res, data);
+}
+
+}  // namespace
+
+TEST(ShuffleCodecTest, LzRoundTrip) {
+  expect_round_trip("");
+  expect_round_trip("abc");
+  expect_round_trip(std::string(100000, 'a'));
+  std::string random(10000, 0);
+  unsigned seed = 1;
+  for (auto& c : random) c = static_cast<char>((seed = seed * 1103515245 + 12345) >> 16);
+  expect_round_trip(random);
+
+  const std::string text = get_text(10000);
+  expect_round_trip(text);
+  std::string block;
+  blaze::internal::LzCodec::compress(text.data(), text.size(), block);
+  EXPECT_LT(block.size(), text.size() / 4);
+}
+
+TEST(ShuffleCodecTest, LzCorruptBlock) {
+  const std::string text = get_text(100);
+  std::string block;
+  blaze::internal::LzCodec::compress(text.data(), text.size(), block);
+  std::string res;
+  EXPECT_THROW(
+      blaze::internal::LzCodec::decompress(block.data(), block.size() / 2, res),
+      std::runtime_error);
+}
+
+TEST(ShuffleCodecTest, PairRoundTrip) {
+  std::vector<std::string> keys;
+  std::vector<double> values;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back("key" + std::to_string(i * 13 % 1000));
+    values.push_back(i % 3 == 0 ? 1.0 : i * 0.25);
+  }
+  std::vector<std::pair<const std::string*, const double*>> pairs;
+  for (int i = 0; i < 1000; i++) pairs.emplace_back(&keys[i], &values[i]);
+  std::string buf;
+  blaze::internal::PairCodec<std::string, double>::encode(pairs, buf);
+
+  int n_pairs = 0;
+  blaze::internal::PairCodec<std::string, double>::decode(
+      buf.data(), buf.size(), [&](const std::string& key, const double& value) {
+        const int i = std::find(keys.begin(), keys.end(), key) - keys.begin();
+        ASSERT_LT(i, 1000);
+        EXPECT_EQ(value, values[i]);
+        n_pairs++;
+      });
+  EXPECT_EQ(n_pairs, 1000);
+}
+
+TEST(ShuffleCodecTest, IntegralColumnRoundTrip) {
+  const int64_t min = std::numeric_limits<int64_t>::min();
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  const std::vector<int64_t> values = {0, -1, 1, min, max, -1000, 42};
+  std::vector<const int64_t*> column;
+  for (const auto& value : values) column.push_back(&value);
+  std::string buf;
+  blaze::internal::ColumnCodec<int64_t>::encode(column, buf);
+  const char* ptr = buf.data();
+  std::vector<int64_t> res(values.size());
+  blaze::internal::ColumnCodec<int64_t>::decode(ptr, buf.data() + buf.size(), res);
+  EXPECT_EQ(res, values);
+  EXPECT_EQ(ptr, buf.data() + buf.size());
+
+  const std::vector<uint32_t> unsigned_values = {std::numeric_limits<uint32_t>::max(), 0, 7};
+  std::vector<const uint32_t*> unsigned_column;
+  for (const auto& value : unsigned_values) unsigned_column.push_back(&value);
+  buf.clear();
+  blaze::internal::ColumnCodec<uint32_t>::encode(unsigned_column, buf);
+  ptr = buf.data();
+  std::vector<uint32_t> unsigned_res(unsigned_values.size());
+  blaze::internal::ColumnCodec<uint32_t>::decode(ptr, buf.data() + buf.size(), unsigned_res);
+  EXPECT_EQ(unsigned_res, unsigned_values);
+}
+
+TEST(ShuffleCodecTest, IntegerKeyedPairsShrink) {
+  std::unordered_map<size_t, int> counts;
+  for (size_t i = 0; i < 10000; i++) counts[i * 7] = static_cast<int>(i % 3);
+  std::vector<std::pair<const size_t*, const int*>> pairs;
+  for (const auto& pair : counts) pairs.emplace_back(&pair.first, &pair.second);
+  std::string buf;
+  blaze::internal::PairCodec<size_t, int>::encode(pairs, buf);
+  // Sorted keys 7 apart take a byte each, where hps takes up to 3.
+  EXPECT_LT(buf.size(), hps::to_string(counts).size() * 2 / 3);
+
+  std::unordered_map<size_t, int> res;
+  blaze::internal::PairCodec<size_t, int>::decode(
+      buf.data(), buf.size(), [&](const size_t& key, const int& value) { res[key] = value; });
+  EXPECT_EQ(res, counts);
+}
+
+TEST(ShuffleCodecTest, Compressor) {
+  const blaze::internal::ShuffleCompressor compressor(0);
+  const std::string text = get_text(10000);
+  std::string buf = text;
+  compressor.compress(buf);
+  EXPECT_TRUE(buf.back() == blaze::internal::ShuffleCompressor::COMPRESSED);
+  EXPECT_LT(buf.size(), text.size());
+  compressor.decompress(buf);
+  EXPECT_EQ(buf, text);
+
+  // Incompressible bufs are sent as they are.
+  buf = "abc";
+  compressor.compress(buf);
+  EXPECT_TRUE(buf.back() == blaze::internal::ShuffleCompressor::RAW);
+  compressor.decompress(buf);
+  EXPECT_EQ(buf, "abc");
+}
@@ -0,0 +1,43 @@
+#include "../src/internal/spill_buffer.h"
+
+#include <gtest/gtest.h>
+#include <functional>
+#include <map>
+
+#include "../src/reducer.h"
+
+TEST(SpillBufferTest, MergesRunsWithReducer) {
+  // Pairs to this proc itself under a budget of a few keys, so that every key lands in several
+  // runs, reduced within each run by the reducer and across runs by the merger.
+  const int N_KEYS = 10;
+  const int N_REPEATS = 20;
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  blaze::internal::SpillBuffer<int, int> spill_buffer(4, "/tmp");
+  std::hash<int> hasher;
+  for (int i = 0; i < N_KEYS * N_REPEATS; i++) {
+    const int key = (i / 2) % N_KEYS;
+    spill_buffer.async_set(proc_id, key, hasher(key), 1, blaze::Reducer<int>::sum);
+  }
+  EXPECT_GT(spill_buffer.get_n_spilled_runs(), static_cast<size_t>(N_KEYS));
+
+  std::map<int, int> res;
+  int n_merged_pairs = 0;
+  bool has_reduced_pairs = false;
+  spill_buffer.sync_spilled([&](const int key, const size_t, const int value) {
+#pragma omp critical
+    {
+      res[key] += value;
+      n_merged_pairs++;
+      has_reduced_pairs |= value > 1;
+    }
+  });
+  EXPECT_EQ(spill_buffer.get_n_spilled_runs(), 0);
+  EXPECT_GT(n_merged_pairs, N_KEYS);
+  EXPECT_TRUE(has_reduced_pairs);
+  spill_buffer.flush([&](const int dest_proc_id, const int key, const size_t, const int value) {
+    EXPECT_EQ(dest_proc_id, proc_id);
+    res[key] += value;
+  });
+  ASSERT_EQ(res.size(), static_cast<size_t>(N_KEYS));
+  for (const auto& key_value : res) EXPECT_EQ(key_value.second, N_REPEATS);
+}
@@ -0,0 +1,101 @@
+#include "../src/internal/transport.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Small chunks, so that messages take several of them.
+const size_t MAX_CHUNK_SIZE = 7;
+
+std::string get_msg(const int proc_id, const size_t size) {
+  std::string msg(size, 0);
+  for (size_t i = 0; i < size; i++) msg[i] = static_cast<char>(proc_id * 31 + i);
+  return msg;
+}
+
+}  // namespace
+
+TEST(TransportTest, SendRecv) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const int next_proc_id = (proc_id + 1) % n_procs;
+  const int prev_proc_id = (proc_id + n_procs - 1) % n_procs;
+  std::string recv_buf;
+  blaze::internal::Transport::send_recv(
+      get_msg(proc_id, 100 + proc_id),
+      next_proc_id,
+      recv_buf,
+      prev_proc_id,
+      MPI_COMM_WORLD,
+      MAX_CHUNK_SIZE);
+  EXPECT_EQ(recv_buf, get_msg(prev_proc_id, 100 + prev_proc_id));
+}
+
+TEST(TransportTest, Broadcast) {
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  std::string msg = proc_id == 0 ? get_msg(0, 100) : std::string();
+  blaze::internal::Transport::broadcast(msg, 0, MPI_COMM_WORLD, MAX_CHUNK_SIZE);
+  EXPECT_EQ(msg, get_msg(0, 100));
+}
+
+TEST(TransportTest, Allgather) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  // Gathered in one call, and in chunks broadcast by each proc.
+  for (const size_t max_chunk_size : {blaze::internal::Transport::MAX_CHUNK_SIZE, MAX_CHUNK_SIZE}) {
+    std::string recv_buf;
+    std::vector<size_t> displs;
+    blaze::internal::Transport::allgather(
+        get_msg(proc_id, 10 * proc_id), recv_buf, displs, MPI_COMM_WORLD, max_chunk_size);
+    ASSERT_EQ(displs.size(), n_procs + 1);
+    for (int i = 0; i < n_procs; i++) {
+      EXPECT_EQ(recv_buf.substr(displs[i], displs[i + 1] - displs[i]), get_msg(i, 10 * i));
+    }
+  }
+}
+
+TEST(TransportTest, Reduce) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const std::vector<long long> values(100, 1);
+  std::vector<long long> res(values.size());
+  blaze::internal::Transport::reduce(
+      values.data(),
+      res.data(),
+      values.size(),
+      MPI_LONG_LONG,
+      MPI_SUM,
+      -1,
+      MPI_COMM_WORLD,
+      MAX_CHUNK_SIZE);
+  for (const long long value : res) EXPECT_EQ(value, n_procs);
+}
+
+TEST(TransportTest, NodeBroadcast) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  // Two procs per node, so that several procs share the nodes as soon as there are three.
+  const blaze::internal::NodeComm nodes(2);
+  for (int root = 0; root < n_procs; root++) {
+    std::string msg = proc_id == root ? get_msg(root, 100) : std::string();
+    blaze::internal::Transport::broadcast(msg, root, nodes, MAX_CHUNK_SIZE);
+    EXPECT_EQ(msg, get_msg(root, 100));
+  }
+}
+
+TEST(TransportTest, NodeAllgather) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  for (const int ranks_per_node : {0, 2}) {
+    const blaze::internal::NodeComm nodes(ranks_per_node);
+    std::string recv_buf;
+    std::vector<size_t> displs;
+    blaze::internal::Transport::allgather(
+        get_msg(proc_id, 10 * proc_id), recv_buf, displs, nodes, MAX_CHUNK_SIZE);
+    ASSERT_EQ(displs.size(), n_procs + 1);
+    for (int i = 0; i < n_procs; i++) {
+      EXPECT_EQ(recv_buf.substr(displs[i], displs[i + 1] - displs[i]), get_msg(i, 10 * i));
+    }
+  }
+}
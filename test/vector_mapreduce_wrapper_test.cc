@@ -0,0 +1,46 @@
+#include "../src/internal/vector_mapreduce_wrapper.h"
+
+#include <gtest/gtest.h>
+#include <functional>
+#include <vector>
+
+#include "../src/reducer.h"
+
+TEST(VectorMapreduceWrapperTest, AllreduceNodes) {
+  const int n_procs = blaze::internal::MpiUtil::get_n_procs();
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const size_t n_keys = 1000;
+  const std::function<void(double&, const double&)> sum_lambda = [](double& t1, const double& t2) {
+    t1 += t2;
+  };
+  const std::function<void(double&, const double&)> sum_builtin = blaze::Reducer<double>::sum;
+  // Over the MPI op and over the tree, with two procs per node.
+  const blaze::internal::NodeComm nodes(2);
+  for (const auto& reducer : {sum_builtin, sum_lambda}) {
+    std::vector<double> dest(n_keys, 0.0);
+    blaze::internal::VectorMapreduceWrapper<double> dest_wrapper(dest);
+    for (size_t i = 0; i < n_keys; i++) dest_wrapper.async_set(i, proc_id + i, reducer);
+    dest_wrapper.sync_local(reducer);
+    dest_wrapper.allreduce_nodes(reducer, nodes);
+    const auto& res = dest_wrapper.get_res_local();
+    ASSERT_EQ(res.size(), n_keys);
+    for (size_t i = 0; i < n_keys; i++) {
+      EXPECT_EQ(res[i], n_procs * (n_procs - 1) / 2.0 + n_procs * i);
+    }
+  }
+}
+
+TEST(VectorMapreduceWrapperTest, NonCommutativeLambdaKeepsProcOrder) {
+  // A first writer wins reducer over a vector large enough for the ring, which would start each
+  // block of the vector at another proc.
+  const int proc_id = blaze::internal::MpiUtil::get_proc_id();
+  const size_t n_keys = 1 << 17;
+  const std::function<void(size_t&, const size_t&)> first = [](size_t& t1, const size_t& t2) {
+    if (t1 == 0) t1 = t2;
+  };
+  std::vector<size_t> dest(n_keys, 0);
+  blaze::internal::VectorMapreduceWrapper<size_t> dest_wrapper(dest);
+  for (size_t i = 0; i < n_keys; i++) dest_wrapper.async_set(i, proc_id + 1, first);
+  dest_wrapper.sync(first);
+  for (size_t i = 0; i < n_keys; i++) ASSERT_EQ(dest[i], 1);
+}